@@ -0,0 +1,132 @@
+#include "analysiscache.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Slots hold the transposition table's data word (packEntryData) without a generation.
+namespace {
+
+const size_t HEADER_BYTES = 64;
+const size_t BUCKET_SIZE = 4;
+
+struct CacheHeader {
+    char magic[8];
+    uint64_t slotCount;
+};
+
+} // namespace
+
+// The slots are shared with other processes through the mapping, which needs atomics that
+// are lock-free (and so keep no process-local state) and laid out as plain 64-bit words.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "cache slots need lock-free 64-bit atomics");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "cache slots must be plain 64-bit words");
+
+ANALYSIS_CACHE::ANALYSIS_CACHE() : mapping(nullptr), mappedBytes(0), slots(nullptr), bucketCount(0) {}
+
+ANALYSIS_CACHE::~ANALYSIS_CACHE() {
+    close();
+}
+
+bool ANALYSIS_CACHE::open(const std::string& path, size_t megabytes) {
+    close();
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+    // Creation is the only step that needs excluding other processes: the first one to
+    // take the lock sizes the file and writes the header, the others find it ready.
+    flock(fd, LOCK_EX);
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    if (ok && info.st_size == 0) {
+        // A power-of-two number of buckets, so a key maps to its bucket with a mask.
+        size_t bytes = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+        size_t buckets = 1;
+        while (buckets * 2 * BUCKET_SIZE * sizeof(Slot) <= bytes)
+            buckets *= 2;
+        CacheHeader header;
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.slotCount = buckets * BUCKET_SIZE;
+        char block[HEADER_BYTES] = {0};
+        std::memcpy(block, &header, sizeof(header));
+        // ftruncate zero-fills the slots, which reads as empty.
+        ok = ftruncate(fd, HEADER_BYTES + header.slotCount * sizeof(Slot)) == 0
+             && pwrite(fd, block, HEADER_BYTES, 0) == (ssize_t)HEADER_BYTES
+             && fstat(fd, &info) == 0;
+    }
+    flock(fd, LOCK_UN);
+
+    CacheHeader header;
+    ok = ok && (size_t)info.st_size >= HEADER_BYTES
+         && pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+         && std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+         && header.slotCount >= BUCKET_SIZE && (header.slotCount & (header.slotCount - 1)) == 0
+         && (size_t)info.st_size == HEADER_BYTES + header.slotCount * sizeof(Slot);
+    if (!ok) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    mapping = mapped;
+    mappedBytes = info.st_size;
+    slots = reinterpret_cast<Slot*>(static_cast<char*>(mapped) + HEADER_BYTES);
+    bucketCount = header.slotCount / BUCKET_SIZE;
+    return true;
+}
+
+void ANALYSIS_CACHE::close() {
+    if (mapping)
+        munmap(mapping, mappedBytes);
+    mapping = nullptr;
+    mappedBytes = 0;
+    slots = nullptr;
+    bucketCount = 0;
+}
+
+bool ANALYSIS_CACHE::probe(uint64_t key, TTEntry& entry) const {
+    if (!slots)
+        return false;
+    const Slot* bucket = slots + (key & (bucketCount - 1)) * BUCKET_SIZE;
+    for (size_t i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if (data == 0 || (check ^ data) != key)
+            continue;
+        unpackEntryData(data, entry);
+        return true;
+    }
+    return false;
+}
+
+void ANALYSIS_CACHE::store(uint64_t key, int depth, int score, int bound, std::pair<short, short> move) {
+    if (!slots)
+        return;
+    Slot* bucket = slots + (key & (bucketCount - 1)) * BUCKET_SIZE;
+    Slot* target = nullptr;
+    int shallowest = 256;
+    for (size_t i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t data = bucket[i].data.load(std::memory_order_relaxed);
+        uint64_t check = bucket[i].check.load(std::memory_order_relaxed);
+        if (data != 0 && (check ^ data) == key) {
+            // The same position: keep whichever was searched deeper.
+            if (entryDataDepth(data) > depth)
+                return;
+            target = &bucket[i];
+            break;
+        }
+        int slotDepth = (data == 0) ? -1 : entryDataDepth(data);
+        if (slotDepth < shallowest) {
+            shallowest = slotDepth;
+            target = &bucket[i];
+        }
+    }
+    uint64_t data = packEntryData(depth, score, bound, move);
+    target->data.store(data, std::memory_order_relaxed);
+    target->check.store(key ^ data, std::memory_order_relaxed);
+}
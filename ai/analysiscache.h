@@ -0,0 +1,57 @@
+// analysiscache.h
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include "transposition.h"
+
+// ------------------ Persistent Analysis Cache ------------------
+// Deep search results (depth, score, bound, best move) kept in a memory-mapped file keyed by
+// Zobrist hash, so they survive restarts and are shared by every engine and process that
+// maps the same file. Slots use the transposition table's lockless scheme (key XOR data,
+// both written atomically), which works the same between processes: a slot torn by a
+// concurrent writer fails the key check and reads as a miss. The file never grows; slots
+// are grouped in buckets of four and a full bucket gives up its shallowest entry.
+
+// File layout: a 64-byte header (magic, slot count), then the slots.
+const char CACHE_MAGIC[8] = {'T', 'C', 'C', 'A', 'C', 'H', 'E', '1'};
+// Size of a new cache file when the front end does not choose one.
+const int CACHE_DEFAULT_MEGABYTES = 64;
+
+class ANALYSIS_CACHE {
+public:
+    ANALYSIS_CACHE();
+    ~ANALYSIS_CACHE();
+    ANALYSIS_CACHE(const ANALYSIS_CACHE&) = delete;
+    ANALYSIS_CACHE& operator=(const ANALYSIS_CACHE&) = delete;
+
+    // Map a cache file, creating it with (at most) 'megabytes' of slots if it does not exist;
+    // an existing file keeps its size. Returns false if the file cannot be created or is not
+    // a cache file.
+    bool open(const std::string& path, size_t megabytes);
+    void close();
+    bool isOpen() const { return slots != nullptr; }
+
+    // Look up a key; the score is in storage form as in the transposition table.
+    bool probe(uint64_t key, TTEntry& entry) const;
+    // Record a result. An entry for the same position is only replaced by one searched at
+    // least as deep; otherwise the shallowest entry of the bucket makes room.
+    void store(uint64_t key, int depth, int score, int bound, std::pair<short, short> move);
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;  // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    void* mapping;
+    size_t mappedBytes;
+    Slot* slots;
+    size_t bucketCount;
+};
+
+#endif // ANALYSISCACHE_H
@@ -0,0 +1,134 @@
+#include "book.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t readBigEndian(const unsigned char* bytes, int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+void writeBigEndian(unsigned char* bytes, uint64_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        bytes[i] = (unsigned char)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+OPENING_BOOK::OPENING_BOOK()
+    : data(nullptr), size(0), rng(std::random_device()()) {}
+
+OPENING_BOOK::~OPENING_BOOK() {
+    close();
+}
+
+bool OPENING_BOOK::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)BOOK_ENTRY_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    data = static_cast<const unsigned char*>(mapped);
+    size = info.st_size;
+    return true;
+}
+
+void OPENING_BOOK::close() {
+    if (data)
+        munmap(const_cast<unsigned char*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+
+bool OPENING_BOOK::isOpen() const {
+    return data != nullptr;
+}
+
+size_t OPENING_BOOK::entryCount() const {
+    return size / BOOK_ENTRY_SIZE;
+}
+
+std::vector<BookMove> OPENING_BOOK::probe(uint64_t key) const {
+    std::vector<BookMove> moves;
+    // Binary search for the first entry with this key.
+    size_t low = 0, high = entryCount();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (readBigEndian(data + mid * BOOK_ENTRY_SIZE, 8) < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    for (size_t i = low; i < entryCount(); i++) {
+        const unsigned char* entry = data + i * BOOK_ENTRY_SIZE;
+        if (readBigEndian(entry, 8) != key)
+            break;
+        BookMove bookMove;
+        bookMove.move = decodeMove((uint16_t)readBigEndian(entry + 8, 2));
+        bookMove.weight = (int)readBigEndian(entry + 10, 2);
+        moves.push_back(bookMove);
+    }
+    std::stable_sort(moves.begin(), moves.end(), [](const BookMove& a, const BookMove& b) {
+        return a.weight > b.weight;
+    });
+    return moves;
+}
+
+bool OPENING_BOOK::pickMove(uint64_t key, bool bestOnly, std::pair<short, short>& move) {
+    std::vector<BookMove> moves = probe(key);
+    long long total = 0;
+    for (const BookMove& bookMove : moves)
+        total += bookMove.weight;
+    if (moves.empty() || total == 0)
+        return false;
+    if (bestOnly) {
+        move = moves.front().move;
+        return true;
+    }
+    long long pick;
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        pick = std::uniform_int_distribution<long long>(0, total - 1)(rng);
+    }
+    for (const BookMove& bookMove : moves) {
+        pick -= bookMove.weight;
+        if (pick < 0) {
+            move = bookMove.move;
+            return true;
+        }
+    }
+    move = moves.front().move;
+    return true;
+}
+
+uint16_t OPENING_BOOK::encodeMove(std::pair<short, short> move) {
+    return (uint16_t)((move.second & 63) | ((move.first & 63) << 6));
+}
+
+std::pair<short, short> OPENING_BOOK::decodeMove(uint16_t bits) {
+    return std::make_pair((short)((bits >> 6) & 63), (short)(bits & 63));
+}
+
+void OPENING_BOOK::writeEntry(unsigned char* out, uint64_t key, uint16_t move, uint16_t weight) {
+    writeBigEndian(out, key, 8);
+    writeBigEndian(out + 8, move, 2);
+    writeBigEndian(out + 10, weight, 2);
+    writeBigEndian(out + 12, 0, 4);
+}
@@ -0,0 +1,59 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ------------------ Book File Format ------------------
+// An opening book is a flat array of 16-byte entries sorted by key, laid out like a
+// Polyglot book: key (8 bytes), move (2), weight (2), learn (4), all big-endian. The key
+// is our own Zobrist hash of the position (see zobrist.h) and the move packs our board
+// indices as destination | source << 6, so the files are not interchangeable with
+// Polyglot books built from its random table.
+const size_t BOOK_ENTRY_SIZE = 16;
+
+// One book move of a position.
+struct BookMove {
+    std::pair<short, short> move;
+    int weight;
+};
+
+// OPENING_BOOK maps a book file into memory and looks positions up by binary search, so
+// an open book costs nothing beyond the pages the lookups touch.
+class OPENING_BOOK {
+public:
+    OPENING_BOOK();
+    ~OPENING_BOOK();
+    OPENING_BOOK(const OPENING_BOOK&) = delete;
+    OPENING_BOOK& operator=(const OPENING_BOOK&) = delete;
+
+    // Map a book file, replacing any open book; returns false if it cannot be used.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+    size_t entryCount() const;
+
+    // All book moves of a position, best (heaviest) first.
+    std::vector<BookMove> probe(uint64_t key) const;
+    // Pick a book move for the position, or return false if it is not in the book. With
+    // 'bestOnly' the heaviest move is played, otherwise one is drawn in proportion to weight.
+    bool pickMove(uint64_t key, bool bestOnly, std::pair<short, short>& move);
+
+    // Entry encoding shared with the book builder.
+    static uint16_t encodeMove(std::pair<short, short> move);
+    static std::pair<short, short> decodeMove(uint16_t bits);
+    static void writeEntry(unsigned char* out, uint64_t key, uint16_t move, uint16_t weight);
+
+private:
+    const unsigned char* data;
+    size_t size;
+    std::mt19937 rng;
+    std::mutex rngMutex;
+};
+
+#endif // BOOK_H
@@ -1,21 +1,48 @@
 #include "chessAI.h"
 #include "../logic/chesslogic.h"
-#include "../utils/globals.h"
-#include <sstream>
+#include "../logic/zobrist.h"
+#include "../logic/notation.h"
+#include "kpk.h"
 #include <cmath>
-#include <limits>
 #include <algorithm>
-#include <iostream>
+#include <thread>
+#include <cstdio>
+
+namespace {
+
+// Trace lines are handed to the log once a thread has gathered this much text.
+const size_t TRACE_CHUNK_SIZE = 1 << 16;
+
+const char* boundName(int bound) {
+    return bound == BOUND_EXACT ? "exact" : (bound == BOUND_LOWER ? "lower" : "upper");
+}
+
+long long microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Space-separated UCI moves played one after another from 'state'.
+std::string uciLine(std::vector<short> state, const std::vector<std::pair<short, short>>& moves) {
+    std::string text;
+    for (const auto& move : moves) {
+        text += (text.empty() ? "" : " ") + moveToUci(state, move);
+        CHESSLOGIC::applyMove(state, move);
+    }
+    return text;
+}
+
+} // namespace
 
 // -----------------------
 // NODE Implementation
 // -----------------------
 
 NODE::NODE()
-    : state(65, 0), parent(nullptr), depth(0), evaluation(0),
-      bestMove({0, 0}), stateString(""), moveFromParent({0, 0})
+    : state(STATE_SIZE, 0), parent(nullptr), depth(0), evaluation(0),
+      bestMove({0, 0}), hashKey(0), moveFromParent({0, 0})
 {
-    buildStateString();
+    computeHashKey();
 }
 
 // Returns the row (0–7) for a given board index.
@@ -28,182 +55,44 @@ short NODE::getRow(short index) {
 }
 
 NODE::NODE(NODE* parent, const std::vector<short>& parentState, int depth, std::pair<short, short> move)
-    : state(parentState), parent(parent), depth(depth + 1), evaluation(0.0),
+    : state(parentState), parent(parent), depth(depth + 1), evaluation(0),
       bestMove({0, 0}), moveFromParent(move)
 {
-    // Copy the parent's state.
-    state = parentState;
-
-    // Apply the move: move the piece from source to destination.
-    state[move.second] = state[move.first];
-    state[move.first] = 0;
-
-    // Toggle the turn indicator so the state now reflects the new turn.
-    state[64] *= -1;
-
-    // Handle pawn promotion.
-    // Assume that a pawn is represented by 1 (white) or -1 (black)
-    // and that the promotion ranks are row 0 for white and row 7 for black.
-    bool movingSideIsWhite = (parentState[64] > 0); // parent's turn indicates moving side.
-    int promotionRank = movingSideIsWhite ? 0 : 7;
-    if (getRow(move.second) == promotionRank && std::abs(state[move.second]) == 1) {
-        state[move.second] = movingSideIsWhite ? 9 : -9;
-    }
-
-    // Set an initial evaluation bonus if the move is by a king.
-    // For a king move:
-    //   - If the move covers more than one column (castle), set bonus to +3 (if white) or -3 (if black).
-    //   - Otherwise, set bonus to +1 (if white) or -1 (if black).
-    if (std::abs(parentState[move.first]) == 127) {
-        int colFrom = move.first % 8;
-        int colTo = move.second % 8;
-        int colDiff = std::abs(colTo - colFrom);
-        if (colDiff > 1) { // Castle move
-            evaluation = movingSideIsWhite ? 3.0 : -3.0;
-        } else {
-            evaluation = movingSideIsWhite ? 1.0 : -1.0;
-        }
-    }
+    // Apply the move (castling rook, promotion, castling rights and turn) to the copied state.
+    CHESSLOGIC::applyMove(state, move);
 
-    // Build a unique string representation of the new state
-    // (this helps when storing nodes in a closed set for search).
-    buildStateString();
+    // Hash the new state for transposition table lookups.
+    computeHashKey();
 }
 
 NODE::~NODE() {
     // Clean up if needed.
 }
 
-void NODE::buildStateString() {
-    std::ostringstream oss;
-    for (short s : state) {
-        oss << s << ",";
-    }
-    stateString = oss.str();
+void NODE::setChild(NODE* parentNode, std::pair<short, short> move) {
+    // Same size as before, so the copy reuses the existing buffer.
+    state = parentNode->state;
+    parent = parentNode;
+    depth = parentNode->depth + 1;
+    evaluation = 0;
+    bestMove = std::make_pair(0, 0);
+    moveFromParent = move;
+    CHESSLOGIC::applyMove(state, move);
+    computeHashKey();
 }
 
-void NODE::evaluateNode(const std::vector<std::pair<short, short>>& validMoves) {
-    double score = 0.0;
-
-    // (1) Count total pieces on the board (indices 0-63; ignore turn indicator at 64).
-    int pieceCount = 0;
-    for (int i = 0; i < 64; i++) {
-        if (state[i] != 0)
-            pieceCount++;
-    }
-
-    // (2) Iterate over board squares (0-63) and compute score for each piece.
-    for (int i = 0; i < 64; i++) {
-        short piece = state[i];
-        if (piece == 0)
-            continue;  // Skip empty squares.
-        if (std::abs(piece) == 127)
-            continue;  // Skip kings.
-
-        // (2a) Base value: half value for bishops, full raw value for others.
-        double pieceScore = (std::abs(piece) == 6) ? piece / 2.0 : piece;
-
-        // (2b) Conditional bonus: if >20 pieces, knights get ±0.3; else bishops get ±0.3.
-        if (std::abs(piece) == 3 && pieceCount > 20) {
-            pieceScore += (piece > 0) ? 0.3 : -0.3;
-        } else if (std::abs(piece) == 6 && pieceCount <= 20) {
-            pieceScore += (piece > 0) ? 0.3 : -0.3;
-        }
-
-        // (2c) Positional bonus: center and immediate perimeter of center.
-        int row = i / 8;
-        int col = i % 8;
-        bool inCenter4 = ((row == 3 || row == 4) && (col == 3 || col == 4));
-        bool inPerimeterOfCenter = (row >= 2 && row <= 5 && col >= 2 && col <= 5 && !inCenter4);
-        if (inCenter4) {
-            pieceScore += (piece > 0) ? 1.0 : -1.0;
-        } else if (inPerimeterOfCenter) {
-            pieceScore += (piece > 0) ? 0.5 : -0.5;
-        }
-
-        // (2d) Mobility and capture bonus:
-        // For every valid move originating from square i add 0.1; if the move is a capture, add an extra 0.1.
-        int mobilityCount = 0;
-        int captureCount = 0;
-        for (const auto &mv : validMoves) {
-            if (mv.first == i) {
-                mobilityCount++;
-                if (state[mv.second] != 0)
-                    captureCount++;
-            }
-        }
-        double mobilityBonus = (mobilityCount * 0.1) + (captureCount * 0.1);
-        if (piece < 0)
-            mobilityBonus = -mobilityBonus;
-        pieceScore += mobilityBonus;
-
-        // (2e) Major piece penalty: if a major piece (knight, rook, bishop, queen) is in its initial column, subtract 0.3.
-        short absP = std::abs(piece);
-        bool isMajor = (absP == 3 || absP == 5 || absP == 6 || absP == 9);
-        if (isMajor) {
-            bool inInitialCol = false;
-            // Define initial columns (these can be adjusted as needed).
-            if (absP == 5 && (col == 0 || col == 7)) inInitialCol = true;
-            else if (absP == 3 && (col == 1 || col == 6)) inInitialCol = true;
-            else if (absP == 6 && (col == 2 || col == 5)) inInitialCol = true;
-            else if (absP == 9 && col == 3) inInitialCol = true;
-
-            if (inInitialCol) {
-                double penalty = 0.3;
-                pieceScore += (piece > 0) ? -penalty : penalty;
-            }
-        }
-
-        // (2f) Mobility penalty: if the piece has fewer than 3 moves, apply an additional penalty of 0.3.
-        if (mobilityCount < 3) {
-            double penalty = 0.3;
-            pieceScore += (piece > 0) ? -penalty : penalty;
-        }
-
-        // Accumulate the piece's score.
-        score += pieceScore;
-    }
-
-    // (3) --- Permanent Castling Bonus ---
-    // If castling rights are still available, add a bonus.
-    // Assume a global pointer 'chessLogicPtr' of type CHESSLOGIC* is available.
-    if (chessLogicPtr != nullptr) {
-        if (chessLogicPtr->whiteCanCastle)
-            score += 5;  // White gets a +5 bonus.
-        if (chessLogicPtr->blackCanCastle)
-            score -= 5;  // Black gets a -5 bonus.
-    }
-
-    // Store the final computed score as the node's evaluation.
-    evaluation = score;
+void NODE::computeHashKey() {
+    hashKey = zobristHash(state);
 }
 
-void NODE::backUpEvaluation() {
-    // If this is the root node (no parent), nothing to do.
-    if (parent == nullptr)
-        return;
+void NODE::evaluateNode(const std::vector<std::pair<short, short>>& validMoves, const EvalWeights& weights) {
+    // The terms are counted from White's point of view (see evalweights.h).
+    int features[EVAL_TERM_COUNT];
+    evalFeatures(state, validMoves, features);
+    int score = weights.score(features);
 
-    // If the parent's evaluation hasn't been set yet (first time),
-    // assign the current evaluation and best move.
-    if (parent->evaluation == 0) {
-        parent->evaluation = evaluation;  // Set parent's evaluation to this node's evaluation.
-        parent->bestMove = moveFromParent;  // Record the move that led to this node.
-    } else {
-        // Determine whether we are maximizing or minimizing.
-        // For example, if parent's turn is white (turn > 0), we might maximize.
-        // (You can adjust this condition based on your specific evaluation convention.)
-        if (parent->state[64] > 0) { // White to move, maximize evaluation.
-            if (evaluation > parent->evaluation) {
-                parent->evaluation = evaluation;
-                parent->bestMove = moveFromParent;
-            }
-        } else { // Black to move, minimize evaluation.
-            if (evaluation < parent->evaluation) {
-                parent->evaluation = evaluation;
-                parent->bestMove = moveFromParent;
-            }
-        }
-    }
+    // Store the final score relative to the side to move, as negamax expects.
+    evaluation = (state[64] > 0) ? score : -score;
 }
 
 // -----------------------
@@ -211,34 +100,78 @@ void NODE::backUpEvaluation() {
 // -----------------------
 
 ALPHA_BETA::ALPHA_BETA()
-    : maxDepth(4), bestMove({0, 0}), root(nullptr), closedNodes(), chessLogic(new CHESSLOGIC()) {}
+    : maxDepth(4), startDepth(1), bestMove({-1, -1}), bestScore(0), completedDepth(0), multiPV(1), frames(SEARCH_STACK_SIZE),
+      chessLogic(new CHESSLOGIC()), tt(nullptr), tablebase(nullptr), network(nullptr), control(nullptr), nodes(0),
+      isMain(false), trace(nullptr), traceMaxPly(0), traceSearchId(0), threadIndex(0),
+      keyStack(SEARCH_STACK_SIZE), rootKeyIndex(0) {}
 
 ALPHA_BETA::~ALPHA_BETA() {
         delete chessLogic;
     }
 
 void ALPHA_BETA::clearSearch() {
-    closedNodes.clear();
+    nodes = 0;
+    stats.clear();
+    for (SearchFrame& frame : frames) {
+        frame.clearKillers();
+        frame.pv.clear();
+    }
+    bestMove = std::make_pair(-1, -1);
+    bestScore = 0;
+    completedDepth = 0;
+    startDepth = 1;
+    rootLines.clear();
+}
+
+void ALPHA_BETA::setGameHistory(const std::vector<uint64_t>& keys, const std::vector<short>& rootState) {
+    // The game's keys normally end with the root itself, which the search writes at ply 0.
+    int before = (int)keys.size();
+    if (before > 0 && keys.back() == zobristHash(rootState))
+        before--;
+    // Nothing played before the last capture or pawn move can occur again.
+    int reversible = std::min<int>(before, rootState[HALFMOVE_INDEX]);
+    keyStack.assign(keys.begin() + (before - reversible), keys.begin() + before);
+    rootKeyIndex = reversible;
+    keyStack.resize(rootKeyIndex + SEARCH_STACK_SIZE);
+}
+
+// Positions with the other side to move cannot match, and the last two plies cannot
+// restore the position, so the scan starts four plies back and steps by two. The halfmove
+// clock bounds it: every key before the last irreversible move differs.
+bool ALPHA_BETA::isRepetition(const NODE* node) const {
+    int index = rootKeyIndex + node->depth;
+    int reversible = std::min<int>(node->state[HALFMOVE_INDEX], index);
+    for (int back = 4; back <= reversible; back += 2) {
+        if (keyStack[index - back] == node->hashKey)
+            return true;
+    }
+    return false;
 }
 
 double ALPHA_BETA::heuristicMoveScore(const std::pair<short, short>& move, const std::vector<short>& state) {
+    return state[move.first] > 0 ? moveOrderScore<WHITE>(move, state) : moveOrderScore<BLACK>(move, state);
+}
+
+template <Color Us>
+double ALPHA_BETA::moveOrderScore(const std::pair<short, short>& move, const std::vector<short>& state) {
+    const short sign = colorSign(Us);
     double score = 0.0;
 
     // Capture bonus: if the destination square is occupied, add bonus proportional to the piece's value.
     if (state[move.second] != 0) {
-        score += std::abs(state[move.second]) * 0.5;
+        score += std::abs(state[move.second]) * weights.orderCapture;
     }
 
     // Central control bonus: if the move lands in the center (rows 2-5, cols 2-5), add bonus.
     int destRow = move.second / 8;
     int destCol = move.second % 8;
     if (destRow >= 2 && destRow <= 5 && destCol >= 2 && destCol <= 5) {
-        score += 0.2;
+        score += weights.orderCentre;
     }
 
     // Outer squares penalty: if the move lands on one of the outer files (columns 0, 1, 6, or 7), subtract a small penalty.
     if (destCol == 0 || destCol == 1 || destCol == 6 || destCol == 7) {
-        score -= 0.2;
+        score -= weights.orderEdge;
     }
 
     // Mobility bonus: add bonus based on the distance of the move.
@@ -246,172 +179,909 @@ double ALPHA_BETA::heuristicMoveScore(const std::pair<short, short>& move, const
     int srcCol = move.first % 8;
     double distance = std::sqrt((destRow - srcRow) * (destRow - srcRow) +
                                 (destCol - srcCol) * (destCol - srcCol));
-    score += distance * 0.05;
+    score += distance * weights.orderDistance;
 
-    // Development bonus for knights.
-    if (std::abs(state[move.first]) == 3) { // Knight.
-        int initialRank = (state[move.first] > 0) ? 7 : 0;
+    // Development bonus for knights and bishops.
+    const int initialRank = (Us == WHITE) ? 7 : 0;
+    short piece = state[move.first] * sign;
+    if (piece == 3 || piece == 6) { // Knight or bishop.
         if (srcRow == initialRank && destRow != initialRank) {
-            score += 0.2;
-        }
-    }
-    // Development bonus for bishops.
-    if (std::abs(state[move.first]) == 6) { // Bishop.
-        int initialRank = (state[move.first] > 0) ? 7 : 0;
-        if (srcRow == initialRank && destRow != initialRank) {
-            score += 0.2;
+            score += weights.orderDevelopment;
         }
     }
 
     // Castling bonus: if the move is a king move of two squares, add bonus.
     //BIG BONUS FOR CASTLE
     if (std::abs(move.second - move.first) == 2) {
-        score += 3;
+        score += weights.orderCastling;
     }
 
     // --- New Bonus: "After Your Half" Bonus ---
     // For white, if the move lands in rows 0-3 (opponent's half), add a bonus.
     // For black, if the move lands in rows 4-7 (opponent's half), add a bonus.
-    if (state[move.first] > 0) { // White piece.
-        if (destRow < 4) {
-            score += 0.15;
-        }
-    } else { // Black piece.
-        if (destRow >= 4) {
-            score += 0.15;
-        }
+    if ((Us == WHITE) ? destRow < 4 : destRow >= 4) {
+        score += weights.orderAdvance;
     }
 
     return score;
 }
 
-void ALPHA_BETA::search(NODE* current, double alpha, double beta) {
-    // Generate all valid moves for the current node's state.
-    std::vector<std::pair<short, short>> moves = chessLogic->generateAllValidMoves(current->state);
+void ALPHA_BETA::checkLimits() {
+    if (control->pondering.load(std::memory_order_relaxed))
+        return;
+    long long hardLimit = control->hardLimitMs.load(std::memory_order_relaxed);
+    if (hardLimit > 0 && control->elapsedMs() >= hardLimit)
+        control->stop = true;
+    if (control->nodeLimit > 0 && totalNodes && totalNodes() >= control->nodeLimit)
+        control->stop = true;
+}
 
-    // --- MOVE ORDERING ---
-    std::sort(moves.begin(), moves.end(), [&](const std::pair<short, short>& a, const std::pair<short, short>& b) {
-        return heuristicMoveScore(a, current->state) > heuristicMoveScore(b, current->state);
-    });
+void ALPHA_BETA::evaluate(NODE* current, const std::vector<std::pair<short, short>>& moves) {
+    if (!network) {
+        current->evaluateNode(moves, weights);
+        return;
+    }
+    // Accumulators are brought up to date only when a node is evaluated: each side's half
+    // from the nearest frame above that has it, ply by ply down to this one, so the frames
+    // on the way serve every sibling evaluated after this node.
+    int ply = current->depth;
+    NODE* path[SEARCH_STACK_SIZE];
+    NODE* node = current;
+    for (int i = ply; i >= 0; i--) {
+        path[i] = node;
+        node = node->parent;
+    }
+    for (int side = 0; side < 2; side++) {
+        int from = ply;
+        while (from > 0 && !frames[from].accumulator.computed[side])
+            from--;
+        if (!frames[from].accumulator.computed[side])
+            network->refresh(path[from]->state, side, frames[from].accumulator);
+        for (int i = from + 1; i <= ply; i++)
+            network->update(path[i - 1]->state, frames[i - 1].accumulator, path[i]->state, side, frames[i].accumulator);
+    }
+    current->evaluation = network->evaluate(current->state, frames[ply].accumulator);
+}
 
-    // Terminal condition: if no valid moves exist, this is a terminal node.
-    if (moves.empty()) {
-        if (current->state[64] > 0) { // White to move => White is checkmated.
-            current->evaluation = -9999;
-        } else { // Black to move => Black is checkmated.
-            current->evaluation = 9999;
+int ALPHA_BETA::search(NODE* current, int alpha, int beta) {
+    return current->state[TURN_INDEX] > 0 ? searchNode<WHITE>(current, alpha, beta)
+                                          : searchNode<BLACK>(current, alpha, beta);
+}
+
+// The search step for a known side to move: the colour is picked once at the root and
+// alternates through the template argument, so nodes never test it at run time.
+template <Color Us>
+int ALPHA_BETA::searchNode(NODE* current, int alpha, int beta) {
+    int ply = current->depth;
+    SearchFrame& frame = frames[ply];
+    frame.pv.clear();
+    long long visited = ++nodes;
+    if (isMain && (visited & 255) == 0)
+        checkLimits();
+    if (control->stop.load(std::memory_order_relaxed))
+        return 0;
+    SEARCH_STAT(stats.seldepth = std::max(stats.seldepth, ply));
+
+    // The root's accumulator belongs to the previous search's root until recomputed.
+    if (ply == 0 && network)
+        frame.accumulator.computed[0] = frame.accumulator.computed[1] = false;
+
+    // A repeated position is a draw: whichever side can improve on it has to deviate
+    // earlier, so one repetition is enough and the cycle is not searched again.
+    keyStack[rootKeyIndex + ply] = current->hashKey;
+    if (ply > 0 && isRepetition(current)) {
+        current->evaluation = 0;
+        return 0;
+    }
+
+    // Mate distance pruning: even mating right now cannot beat a shorter mate already found,
+    // and being mated next move cannot be worse than a quicker mate against us.
+    if (ply > 0) {
+        alpha = std::max(alpha, matedIn(ply));
+        beta = std::min(beta, mateIn(ply + 1));
+        if (alpha >= beta)
+            return alpha;
+    }
+
+    // Endgame bitbase: K+P v K has an exact result, so the subtree needs no search.
+    int bitbaseScore;
+    if (ply > 0 && kpkEvaluate(current->state, bitbaseScore)) {
+        current->evaluation = bitbaseScore;
+        return bitbaseScore;
+    }
+    // Endgame tablebases give the exact distance to mate of small endgames.
+    int tablebaseScore;
+    if (ply > 0 && tablebase && tablebase->probeScore(current->state, ply, tablebaseScore)) {
+        current->evaluation = tablebaseScore;
+        return tablebaseScore;
+    }
+
+    // Transposition table: reuse a result searched at least as deep as we need here.
+    int remainingDepth = maxDepth - ply;
+    int originalAlpha = alpha;
+    TTEntry entry;
+    bool hit = tt->probe(current->hashKey, entry);
+    SEARCH_STAT(stats.ttProbes++; stats.ttHits += hit);
+    if (hit && ply > 0 && entry.depth >= remainingDepth) {
+        int ttScore = scoreFromStorage(entry.score, ply);
+        if (entry.bound == BOUND_EXACT ||
+            (entry.bound == BOUND_LOWER && ttScore >= beta) ||
+            (entry.bound == BOUND_UPPER && ttScore <= alpha)) {
+            SEARCH_STAT(stats.ttCutoffs++);
+            return ttScore;
         }
-        current->backUpEvaluation();
-        return;
+    }
+
+    // Generate all valid moves for the current node's state into this ply's list.
+    std::vector<std::pair<short, short>>& moves = frame.moves;
+    chessLogic->generateLegalMoves<Us>(current->state, moves);
+
+    // Terminal condition: no valid moves means checkmate if in check, stalemate otherwise.
+    if (moves.empty()) {
+        current->evaluation = chessLogic->kingInCheck<Us>(current->state) ? matedIn(ply) : 0;
+        return current->evaluation;
+    }
+    // Fifty moves without a capture or pawn move (checkmate on the last one still counts).
+    if (ply > 0 && current->state[HALFMOVE_INDEX] >= 100) {
+        current->evaluation = 0;
+        return 0;
+    }
+    // MultiPV: root moves that already head a line of this iteration are not searched again.
+    if (ply == 0 && !excludedRootMoves.empty()) {
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [this](const std::pair<short, short>& move) {
+            return std::find(excludedRootMoves.begin(), excludedRootMoves.end(), move) != excludedRootMoves.end();
+        }), moves.end());
+        if (moves.empty())
+            return -INFINITE_SCORE;
     }
 
     // Terminal condition: maximum search depth reached.
-    if (current->depth == maxDepth /* || additional game-over conditions */) {
-        current->evaluateNode(moves);
-        current->backUpEvaluation();
-        return;
+    if (ply >= maxDepth /* || additional game-over conditions */) {
+        SEARCH_STAT(stats.qnodes++);
+        evaluate(current, moves);
+        frame.staticEval = current->evaluation;
+        return current->evaluation;
     }
 
-    // --- (Optional Aggressive Pruning) ---
-    // The following block can be used to prune branches that appear very weak
-    // compared to the parent's evaluation. Tune the threshold as needed.
-    /*
-    double currentBestHeuristic = -std::numeric_limits<double>::infinity();
-    for (const auto &move : moves) {
-        double hScore = heuristicMoveScore(move, current->state);
-        if (hScore > currentBestHeuristic) {
-            currentBestHeuristic = hScore;
+    // --- MOVE ORDERING ---
+    std::sort(moves.begin(), moves.end(), [&](const std::pair<short, short>& a, const std::pair<short, short>& b) {
+        return moveOrderScore<Us>(a, current->state) > moveOrderScore<Us>(b, current->state);
+    });
+    // The stored best move (the previous iteration's choice at the root) is tried first.
+    auto ordered = moves.begin();
+    if (hit) {
+        auto ttMove = std::find(moves.begin(), moves.end(), entry.move);
+        if (ttMove != moves.end()) {
+            std::rotate(moves.begin(), ttMove, ttMove + 1);
+            ++ordered;
         }
     }
-    if (current->parent != nullptr) {
-        double parentEval = current->parent->evaluation;
-        if (current->state[64] > 0 && currentBestHeuristic < parentEval - 0.5) {
-            current->evaluation = currentBestHeuristic;
-            current->backUpEvaluation();
-            return;
+    // At the root, the lines ranked by the previous iteration follow in their order.
+    if (ply == 0) {
+        for (const RootLine& line : rootLines) {
+            auto found = std::find(ordered, moves.end(), line.pv.front());
+            if (found != moves.end()) {
+                std::rotate(ordered, found, found + 1);
+                ++ordered;
+            }
         }
-        if (current->state[64] < 0 && currentBestHeuristic > parentEval + 0.5) {
-            current->evaluation = currentBestHeuristic;
-            current->backUpEvaluation();
-            return;
+    }
+    // Then the killer moves: quiet moves that refuted a sibling position at this ply.
+    for (const auto& killer : frame.killers) {
+        auto found = std::find(ordered, moves.end(), killer);
+        if (found != moves.end() && current->state[killer.second] == 0) {
+            std::rotate(ordered, found, found + 1);
+            ++ordered;
         }
     }
-    */
-
-    // Recursive minimax with alpha–beta pruning.
-    if (current->state[64] > 0) { // White to move (maximizing)
-        double value = std::numeric_limits<double>::lowest();
-        for (auto move : moves) {
-            NODE child(current, current->state, current->depth, move);
-            search(&child, alpha, beta);
-            if (child.evaluation > value) {
-                value = child.evaluation;
-                current->bestMove = move;
+
+    // Tracing: the main thread records each root move, every thread the interior nodes
+    // down to traceMaxPly. Other nodes only pay for the two tests.
+    bool traceRoot = trace && ply == 0 && isMain;
+    bool traceInterior = trace && ply > 0 && ply <= traceMaxPly;
+    long long nodesBefore = (traceRoot || traceInterior) ? nodes.load(std::memory_order_relaxed) : 0;
+    std::chrono::steady_clock::time_point traceStart;
+    if (traceInterior)
+        traceStart = std::chrono::steady_clock::now();
+
+    // Recursive negamax with alpha–beta pruning: every child score is negated back into
+    // the point of view of the side to move here, so one branch serves both colours.
+    int bestScore = -INFINITE_SCORE;
+    std::pair<short, short> bestLocalMove = moves.front();
+    int moveIndex = 0, bestIndex = 0;
+    SEARCH_STAT(stats.expanded++);
+    for (auto move : moves) {
+        long long moveNodes = nodesBefore;
+        std::chrono::steady_clock::time_point moveStart;
+        if (traceRoot) {
+            moveNodes = nodes.load(std::memory_order_relaxed);
+            moveStart = std::chrono::steady_clock::now();
+        }
+        NODE& child = frames[ply + 1].node;
+        child.setChild(current, move);
+        if (network)
+            frames[ply + 1].accumulator.computed[0] = frames[ply + 1].accumulator.computed[1] = false;
+        int score = -searchNode<~Us>(&child, -beta, -alpha);
+        // An interrupted child returns garbage; only fully searched moves may be recorded.
+        if (control->stop.load(std::memory_order_relaxed))
+            return 0;
+        if (traceRoot)
+            traceRootMove(child, moveIndex, score, alpha, beta,
+                          nodes.load(std::memory_order_relaxed) - moveNodes, microsSince(moveStart));
+        if (score > bestScore) {
+            bestScore = score;
+            bestLocalMove = move;
+            bestIndex = moveIndex;
+            current->bestMove = move;
+            current->evaluation = score;
+        }
+        // A move inside the window becomes the start of this ply's line.
+        if (score > alpha) {
+            const std::vector<std::pair<short, short>>& childLine = frames[ply + 1].pv;
+            frame.pv.clear();
+            frame.pv.push_back(move);
+            frame.pv.insert(frame.pv.end(), childLine.begin(), childLine.end());
+        }
+        moveIndex++;
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) { // Beta cutoff.
+            SEARCH_STAT(stats.betaCutoffs++; stats.firstMoveCutoffs += (move == moves.front()));
+            if (current->state[move.second] == 0 && frame.killers[0] != move) {
+                frame.killers[1] = frame.killers[0];
+                frame.killers[0] = move;
             }
-            alpha = std::max(alpha, value);
-            if (alpha >= beta) { // Beta cutoff.
+            break;
+        }
+    }
+    current->evaluation = bestScore;
+
+    // Cache the result for transpositions and later iterations. A root searched without
+    // some of its moves (MultiPV) has no result that is valid for the position.
+    int bound = (bestScore >= beta) ? BOUND_LOWER : (bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    if (ply > 0 || excludedRootMoves.empty())
+        tt->store(current->hashKey, remainingDepth, scoreToStorage(bestScore, ply), bound, bestLocalMove);
+
+    if (traceInterior)
+        traceNode(current, originalAlpha, beta, bestScore, moves.size(), bestIndex,
+                  nodes.load(std::memory_order_relaxed) - nodesBefore, microsSince(traceStart));
+    return bestScore;
+}
+
+void ALPHA_BETA::iterate(const std::vector<short>& rootState, int depthOffset) {
+    NODE* root = &frames[0].node;
+    std::vector<RootLine> lines;
+    for (int depth = std::max(1, startDepth); depth <= MAX_SEARCH_DEPTH; depth++) {
+        // While pondering keep deepening; the depth limit applies once the move is played.
+        if (depth > control->depthLimit && !control->pondering)
+            break;
+        // Helpers skip ahead so they fill the table for the main thread's next iteration.
+        maxDepth = std::min(depth + depthOffset, MAX_SEARCH_DEPTH);
+        root->state = rootState;
+        root->computeHashKey();
+        long long iterationStart = control->elapsedMs();
+
+        // MultiPV: the root is searched once per line, each pass without the moves heading
+        // the lines already found. The passes share the table, so everything below the root
+        // that an earlier pass searched is a table hit for the later ones.
+        lines.clear();
+        bool interrupted = false;
+        for (int line = 0; line < multiPV; line++) {
+            root->bestMove = std::make_pair(-1, -1);
+            int score = search(root, -INFINITE_SCORE, INFINITE_SCORE);
+            interrupted = control->stop.load(std::memory_order_relaxed);
+            // Stopped before a move completed, or every root move already heads a line.
+            if (root->bestMove.first < 0)
                 break;
+            // A stopped iteration still counts if it completed at least one root move: the
+            // previous best move is searched first, so anything recorded is no worse.
+            if (line == 0) {
+                bestMove = root->bestMove;
+                bestScore = interrupted ? root->evaluation : score;
             }
+            if (interrupted)
+                break;
+            RootLine found;
+            found.score = score;
+            found.pv = lineFromStack(rootState, root->bestMove, maxDepth);
+            lines.push_back(found);
+            excludedRootMoves.push_back(root->bestMove);
         }
-        current->evaluation = value;
-    } else { // Black to move (minimizing)
-        double value = std::numeric_limits<double>::max();
-        for (auto move : moves) {
-            NODE child(current, current->state, current->depth, move);
-            search(&child, alpha, beta);
-            if (child.evaluation < value) {
-                value = child.evaluation;
-                current->bestMove = move;
-            }
-            beta = std::min(beta, value);
-            if (beta <= alpha) { // Alpha cutoff.
+        excludedRootMoves.clear();
+        // Lines ranked at this depth go first; after a stop the others keep their old rank.
+        for (const RootLine& previous : rootLines) {
+            if ((int)lines.size() >= multiPV)
                 break;
-            }
+            bool ranked = false;
+            for (const RootLine& line : lines)
+                ranked = ranked || line.pv.front() == previous.pv.front();
+            if (!ranked)
+                lines.push_back(previous);
         }
-        current->evaluation = value;
+        rootLines.swap(lines);
+        if (trace && isMain)
+            traceIteration(rootState, !interrupted, control->elapsedMs() - iterationStart);
+        if (interrupted)
+            break;
+        completedDepth = maxDepth;
+        SEARCH_STAT(stats.iterationMs.push_back(control->elapsedMs() - iterationStart));
+
+        if (isMain && onIteration) {
+            SearchInfo info;
+            info.depth = maxDepth;
+            info.seldepth = stats.seldepth;
+            info.score = bestScore;
+            info.nodes = totalNodes ? totalNodes() : nodes.load();
+            info.timeMs = control->elapsedMs();
+            info.hashfull = tt->hashfull();
+            info.pv = extractPV(rootState, maxDepth);
+            info.lines = rootLines;
+            onIteration(info);
+        }
+        // A forced mate within the searched depth will not change with more depth (the
+        // other lines of a MultiPV search still might).
+        if (multiPV == 1 && isMateScore(bestScore) && MATE_SCORE - std::abs(bestScore) <= maxDepth)
+            break;
+        // Do not start an iteration that is unlikely to finish in the remaining time.
+        long long softLimit = control->softLimitMs.load(std::memory_order_relaxed);
+        if (isMain && !control->pondering && softLimit > 0 && control->elapsedMs() > softLimit)
+            break;
     }
+    flushTrace();
+}
 
-    // Cache the current node.
-    closedNodes[current->stateString] = current;
+std::vector<std::pair<short, short>> ALPHA_BETA::extractPV(const std::vector<short>& rootState, int maxLength) {
+    // A MultiPV search leaves its last line on the stack; the best one was saved when found.
+    if (!rootLines.empty() && rootLines.front().pv.front() == bestMove) {
+        const std::vector<std::pair<short, short>>& line = rootLines.front().pv;
+        return std::vector<std::pair<short, short>>(line.begin(), line.begin() + std::min((int)line.size(), maxLength));
+    }
+    return lineFromStack(rootState, bestMove, maxLength);
+}
 
-    if (current->parent != nullptr)
-        current->backUpEvaluation();
+std::vector<std::pair<short, short>> ALPHA_BETA::lineFromStack(const std::vector<short>& rootState,
+                                                               std::pair<short, short> rootMove, int maxLength) {
+    // The line collected on the search stack is exact; the table can extend it where the
+    // search stopped early at a table hit.
+    const SearchFrame& top = frames[0];
+    if (top.node.state == rootState && !top.pv.empty() && top.pv.front() == rootMove) {
+        std::vector<std::pair<short, short>> pv(top.pv.begin(),
+                                                top.pv.begin() + std::min((int)top.pv.size(), maxLength));
+        std::vector<short> state = rootState;
+        for (const auto& move : pv)
+            CHESSLOGIC::applyMove(state, move);
+        std::vector<std::pair<short, short>> rest = followTable(state, maxLength - (int)pv.size());
+        pv.insert(pv.end(), rest.begin(), rest.end());
+        return pv;
+    }
+    std::vector<std::pair<short, short>> pv = followTable(rootState, maxLength);
+    // The root move of the PV must be the move actually chosen.
+    if (!pv.empty() && pv.front() != rootMove)
+        pv.assign(1, rootMove);
+    return pv;
+}
+
+std::vector<std::pair<short, short>> ALPHA_BETA::followTable(const std::vector<short>& startState, int maxLength) {
+    std::vector<std::pair<short, short>> pv;
+    std::vector<short> state = startState;
+    std::vector<uint64_t> seen;
+    TTEntry entry;
+    while ((int)pv.size() < maxLength) {
+        uint64_t key = zobristHash(state);
+        if (std::find(seen.begin(), seen.end(), key) != seen.end() || !tt->probe(key, entry))
+            break;
+        std::vector<std::pair<short, short>> legal = chessLogic->generateAllValidMoves(state);
+        if (std::find(legal.begin(), legal.end(), entry.move) == legal.end())
+            break;
+        seen.push_back(key);
+        pv.push_back(entry.move);
+        CHESSLOGIC::applyMove(state, entry.move);
+    }
+    return pv;
 }
 
 std::pair<short, short> ALPHA_BETA::getBestMove() const {
     return bestMove; // Typically, bestMove would be set on the root node.
 }
 
+// ---- Tracing ----
+// One JSON object per line. Scores are side-to-move relative like everywhere in the search;
+// "bound" says whether a score is exact or only a lower/upper limit because it fell outside
+// the window; "best_index" is the position of the best move in the searched order, so a
+// high value at a node that failed high points to a move-ordering failure.
+
+void ALPHA_BETA::traceLine(const std::string& line) {
+    traceBuffer += line;
+    traceBuffer += '\n';
+    if (traceBuffer.size() >= TRACE_CHUNK_SIZE)
+        trace->write(traceBuffer);
+}
+
+void ALPHA_BETA::flushTrace() {
+    if (trace)
+        trace->write(traceBuffer);
+}
+
+std::string ALPHA_BETA::traceHeader(const char* type) const {
+    char text[128];
+    std::snprintf(text, sizeof(text), "{\"type\":\"%s\",\"search\":%lld,\"thread\":%d,\"depth\":%d",
+                  type, traceSearchId, threadIndex, maxDepth);
+    return text;
+}
+
+void ALPHA_BETA::traceIteration(const std::vector<short>& rootState, bool complete, long long iterationMs) {
+    char text[192];
+    std::snprintf(text, sizeof(text),
+                  ",\"complete\":%s,\"score\":%d,\"nodes\":%lld,\"thread_nodes\":%lld,"
+                  "\"time_ms\":%lld,\"iteration_ms\":%lld,\"hashfull\":%d,\"pv\":\"",
+                  complete ? "true" : "false", bestScore, totalNodes ? totalNodes() : nodes.load(),
+                  nodes.load(), control->elapsedMs(), iterationMs, tt->hashfull());
+    traceLine(traceHeader("iteration") + text + uciLine(rootState, extractPV(rootState, maxDepth)) + "\"}");
+}
+
+void ALPHA_BETA::traceRootMove(NODE& child, int index, int score, int alpha, int beta,
+                               long long nodesSpent, long long micros) {
+    int bound = score >= beta ? BOUND_LOWER : (score > alpha ? BOUND_EXACT : BOUND_UPPER);
+    // The child's entry holds the reply that proved the score (the refutation if it failed low).
+    std::vector<std::pair<short, short>> line(1, child.moveFromParent);
+    std::vector<std::pair<short, short>> rest = followTable(child.state, maxDepth - 1);
+    line.insert(line.end(), rest.begin(), rest.end());
+    char text[160];
+    std::snprintf(text, sizeof(text),
+                  ",\"index\":%d,\"score\":%d,\"bound\":\"%s\",\"nodes\":%lld,\"time_us\":%lld,\"pv\":\"",
+                  index, score, boundName(bound), nodesSpent, micros);
+    const std::vector<short>& rootState = child.parent->state;
+    traceLine(traceHeader("root") + ",\"move\":\"" + moveToUci(rootState, child.moveFromParent) + "\""
+              + text + uciLine(rootState, line) + "\"}");
+}
+
+void ALPHA_BETA::traceNode(const NODE* node, int alpha, int beta, int score, size_t moveCount, int bestIndex,
+                           long long nodesSpent, long long micros) {
+    // The path is rebuilt from the parent links, which the recursion keeps alive.
+    std::vector<std::string> path;
+    for (const NODE* step = node; step->parent != nullptr; step = step->parent)
+        path.push_back(moveToUci(step->parent->state, step->moveFromParent));
+    std::string pathText;
+    for (auto it = path.rbegin(); it != path.rend(); ++it)
+        pathText += (pathText.empty() ? "" : " ") + *it;
+
+    int bound = score >= beta ? BOUND_LOWER : (score > alpha ? BOUND_EXACT : BOUND_UPPER);
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  ",\"ply\":%d,\"alpha\":%d,\"beta\":%d,\"score\":%d,\"bound\":\"%s\",\"moves\":%zu,"
+                  "\"best\":\"%s\",\"best_index\":%d,\"nodes\":%lld,\"time_us\":%lld}",
+                  node->depth, alpha, beta, score, boundName(bound), moveCount,
+                  moveToUci(node->state, node->bestMove).c_str(), bestIndex, nodesSpent, micros);
+    traceLine(traceHeader("node") + ",\"path\":\"" + pathText + "\"" + text);
+}
+
 // -----------------------
 // ChessAI Implementation
 // -----------------------
 
-ChessAI::ChessAI() {
-    // The ALPHA_BETA object 'ab' is initialized by its constructor.
+ChessAI::ChessAI()
+    : defaultDepth(4), multiPV(1), useNetwork(true), bookBestOnly(false), tracePly(2), tt(16), table(&tt),
+      network(&ownNetwork), budgetMs(0), lastRootScore(0),
+      lastSearchMs(0), searchCount(0)
+{
+    // Build the endgame bitbase now rather than in the middle of a timed search.
+    kpkInit();
+    setThreads(1);
+}
+
+ChessAI::~ChessAI() {
+    if (worker.joinable()) {
+        stop();
+        worker.join();
+    }
+    for (ALPHA_BETA* searcher : searchers)
+        delete searcher;
+}
+
+void ChessAI::setHashSize(int megabytes) {
+    tt.resize(megabytes > 0 ? megabytes : 1);
+}
+
+void ChessAI::setThreads(int count) {
+    count = std::max(1, count);
+    while ((int)searchers.size() > count) {
+        delete searchers.back();
+        searchers.pop_back();
+    }
+    while ((int)searchers.size() < count) {
+        ALPHA_BETA* searcher = new ALPHA_BETA();
+        searcher->tt = table;
+        searcher->tablebase = &tablebase;
+        searcher->control = &control;
+        searchers.push_back(searcher);
+    }
+}
+
+void ChessAI::clearHash() {
+    tt.clear();
+}
+
+void ChessAI::shareTable(TRANSPOSITION_TABLE* shared) {
+    table = shared ? shared : &tt;
+    for (ALPHA_BETA* searcher : searchers)
+        searcher->tt = table;
+}
+
+int ChessAI::setTablebasePath(const std::string& directory) {
+    if (directory.empty()) {
+        tablebase.close();
+        return 0;
+    }
+    return tablebase.open(directory);
+}
+
+bool ChessAI::setBook(const std::string& path) {
+    if (path.empty()) {
+        book.close();
+        return true;
+    }
+    return book.open(path);
+}
+
+bool ChessAI::setAnalysisCache(const std::string& path, int megabytes) {
+    if (path.empty()) {
+        cache.close();
+        return true;
+    }
+    return cache.open(path, (size_t)std::max(1, megabytes));
+}
+
+bool ChessAI::setEvalFile(const std::string& path) {
+    if (path.empty()) {
+        ownNetwork.clear();
+        return true;
+    }
+    return ownNetwork.load(path);
+}
+
+bool ChessAI::setEvalWeights(const std::string& path) {
+    if (path.empty()) {
+        evalWeights = EvalWeights();
+        return true;
+    }
+    return loadEvalWeights(path, evalWeights);
+}
+
+void ChessAI::shareNetwork(const NNUE_NETWORK* shared) {
+    network = shared ? shared : &ownNetwork;
+}
+
+bool ChessAI::setTraceFile(const std::string& path) {
+    if (path.empty()) {
+        traceLog.close();
+        return true;
+    }
+    return traceLog.open(path);
+}
+
+void ChessAI::stop() {
+    control.stop = true;
 }
 
-std::pair<short, short> ChessAI::getBestMove(CHESSLOGIC& game) {
-    // Set the root node's state to the current game state.
-    if (ab.root != nullptr) {
-        delete ab.root;
+void ChessAI::ponderHit() {
+    long long elapsed = control.elapsedMs();
+    if (budgetMs > 0) {
+        control.softLimitMs = elapsed + budgetMs / 2;
+        control.hardLimitMs = elapsed + budgetMs;
+    } else if (control.depthLimit <= searchers[0]->completedDepth) {
+        // A depth-limited search that already went deep enough can answer at once.
+        control.stop = true;
+    }
+    control.pondering = false;
+}
+
+void ChessAI::startSearch(const std::vector<short>& rootState, const SearchLimits& limits,
+                          std::function<void()> onFinished) {
+    if (worker.joinable())
+        waitForResult();
+    control.stop = false;
+    worker = std::thread([this, rootState, limits, onFinished]() {
+        workerResult = runSearch(rootState, limits);
+        if (onFinished)
+            onFinished();
+    });
+}
+
+bool ChessAI::isSearching() const {
+    return worker.joinable();
+}
+
+std::pair<short, short> ChessAI::waitForResult() {
+    if (worker.joinable())
+        worker.join();
+    return workerResult;
+}
+
+std::pair<short, short> ChessAI::getBestMove(const CHESSLOGIC& game) {
+    SearchLimits limits;
+    limits.history = game.getPositionKeys();
+    return search(game.getState(), limits);
+}
+
+std::pair<short, short> ChessAI::search(const std::vector<short>& rootState, const SearchLimits& limits) {
+    control.stop = false;
+    return runSearch(rootState, limits);
+}
+
+std::pair<short, short> ChessAI::runSearch(const std::vector<short>& rootState, const SearchLimits& limits) {
+    control.startTime = std::chrono::steady_clock::now();
+    table->newSearch();
+
+    // Work out the depth and time budget for this move.
+    bool timed = limits.movetime > 0 || limits.wtime > 0 || limits.btime > 0;
+    int depthLimit = limits.depth > 0 ? std::min(limits.depth, MAX_SEARCH_DEPTH) : defaultDepth;
+    if (limits.depth == 0 && (timed || limits.infinite || limits.nodes > 0))
+        depthLimit = MAX_SEARCH_DEPTH;
+    budgetMs = 0;
+    if (!limits.infinite) {
+        if (limits.movetime > 0) {
+            budgetMs = limits.movetime;
+        } else if (timed) {
+            bool white = rootState[TURN_INDEX] > 0;
+            long long remaining = white ? limits.wtime : limits.btime;
+            long long increment = white ? limits.winc : limits.binc;
+            int movesToGo = limits.movestogo > 0 ? limits.movestogo : 30;
+            budgetMs = remaining / movesToGo + increment * 3 / 4;
+            budgetMs = std::max(1LL, std::min(budgetMs, remaining - 50));
+        }
+    }
+    control.depthLimit = depthLimit;
+    control.nodeLimit = limits.nodes;
+    control.pondering = limits.ponder;
+    control.softLimitMs = (budgetMs > 0 && !limits.ponder) ? budgetMs / 2 : 0;
+    control.hardLimitMs = (budgetMs > 0 && !limits.ponder) ? budgetMs : 0;
+
+    std::function<long long()> totalNodes = [this]() {
+        long long total = 0;
+        for (ALPHA_BETA* searcher : searchers)
+            total += searcher->nodes.load(std::memory_order_relaxed);
+        return total;
+    };
+    searchCount++;
+    for (size_t i = 0; i < searchers.size(); i++) {
+        ALPHA_BETA* searcher = searchers[i];
+        searcher->clearSearch();
+        searcher->isMain = (i == 0);
+        searcher->totalNodes = totalNodes;
+        searcher->onIteration = onIteration;
+        searcher->trace = traceLog.isOpen() ? &traceLog : nullptr;
+        searcher->traceMaxPly = tracePly;
+        searcher->traceSearchId = searchCount;
+        searcher->threadIndex = (int)i;
+        searcher->setGameHistory(limits.history, rootState);
+        searcher->multiPV = std::max(1, multiPV);
+        searcher->network = (useNetwork && network->isLoaded()) ? network : nullptr;
+        searcher->weights = evalWeights;
+    }
+
+    // Book positions are answered at once, except when analysing or pondering. The move is
+    // checked against the legal moves in case of a key collision.
+    std::pair<short, short> bookMove;
+    if (book.isOpen() && !limits.infinite && !limits.ponder
+        && book.pickMove(zobristHash(rootState), bookBestOnly, bookMove)) {
+        std::vector<std::pair<short, short>> moves = searchers[0]->chessLogic->generateAllValidMoves(rootState);
+        if (std::find(moves.begin(), moves.end(), bookMove) != moves.end()) {
+            lastRootState = rootState;
+            lastRootScore = 0;
+            lastPV.assign(1, bookMove);
+            lastLines.assign(1, RootLine());
+            lastLines[0].score = 0;
+            lastLines[0].pv = lastPV;
+            lastSearchMs = control.elapsedMs();
+            return bookMove;
+        }
+    }
+
+    // Analysis cache: a result at least as deep as this search would go is the answer; a
+    // shallower one seeds the table with its line and the search resumes after its depth.
+    // A move that is not legal here means a key collision, and the entry is ignored.
+    // Cached results know nothing of this game, so when a root move repeats one of its
+    // positions the entry only seeds the table, the search runs in full and its result is
+    // not written back.
+    TTEntry cached;
+    int cachedDepth = 0;
+    ALPHA_BETA* mainSearcher = searchers[0];
+    bool historyMatters = cache.isOpen() && rootRepeatsHistory(rootState, limits.history);
+    if (cache.isOpen() && cache.probe(zobristHash(rootState), cached) && cached.bound == BOUND_EXACT
+        && cached.move.first >= 0) {
+        std::vector<std::pair<short, short>> moves = mainSearcher->chessLogic->generateAllValidMoves(rootState);
+        if (std::find(moves.begin(), moves.end(), cached.move) != moves.end()) {
+            cachedDepth = std::min(cached.depth, MAX_SEARCH_DEPTH);
+            std::vector<std::pair<short, short>> line = seedFromCache(rootState);
+            if (onIteration) {
+                SearchInfo info;
+                info.depth = cachedDepth;
+                info.seldepth = 0;
+                info.score = cached.score;
+                info.nodes = 0;
+                info.timeMs = control.elapsedMs();
+                info.hashfull = table->hashfull();
+                info.pv = line;
+                info.lines.assign(1, RootLine());
+                info.lines[0].score = cached.score;
+                info.lines[0].pv = line;
+                onIteration(info);
+            }
+            // Lines beyond the first are not cached, so a MultiPV search always runs (on the
+            // seeded table) from the first iteration.
+            if (multiPV <= 1 && !historyMatters && !limits.infinite && !limits.ponder && cachedDepth >= depthLimit) {
+                lastRootState = rootState;
+                lastRootScore = cached.score;
+                lastPV = line;
+                lastLines.assign(1, RootLine());
+                lastLines[0].score = cached.score;
+                lastLines[0].pv = line;
+                lastSearchMs = control.elapsedMs();
+                return cached.move;
+            }
+            if (multiPV <= 1 && !historyMatters) {
+                // Should the search be stopped before an iteration completes, the cached
+                // result is still the best known.
+                for (ALPHA_BETA* searcher : searchers)
+                    searcher->startDepth = cachedDepth + 1;
+                mainSearcher->bestMove = cached.move;
+                mainSearcher->bestScore = cached.score;
+                mainSearcher->completedDepth = cachedDepth;
+            } else {
+                cachedDepth = 0;
+            }
+        }
+    }
+
+    std::string traceText;
+    if (traceLog.isOpen()) {
+        char text[160];
+        std::snprintf(text, sizeof(text),
+                      "\",\"threads\":%zu,\"depth_limit\":%d,\"nodes_limit\":%lld,\"time_limit_ms\":%lld}\n",
+                      searchers.size(), depthLimit, limits.nodes, budgetMs);
+        traceText = "{\"type\":\"search\",\"search\":" + std::to_string(searchCount)
+                    + ",\"fen\":\"" + stateToFen(rootState, 1) + text;
+        traceLog.write(traceText);
     }
-    ab.root = new NODE();
-    ab.root->state = game.getState();
-    ab.root->buildStateString();
 
-    // Clear previous search data.
-    ab.clearSearch();
+    // Lazy SMP: helpers search the same root on the shared table at staggered depths.
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < searchers.size(); i++) {
+        ALPHA_BETA* helper = searchers[i];
+        int offset = (int)(i % 2);
+        helpers.push_back(std::thread([helper, &rootState, offset]() {
+            helper->iterate(rootState, offset);
+        }));
+    }
+    mainSearcher->iterate(rootState, 0);
+    // In infinite and ponder mode the best move may only be reported once the GUI says so.
+    while ((limits.infinite || control.pondering) && !control.stop)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    control.stop = true;
+    for (std::thread& helper : helpers)
+        helper.join();
 
-    // Run the alpha–beta search from the root node.
-    ab.search(ab.root, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    lastSearchMs = control.elapsedMs();
+    lastRootState = rootState;
+    lastRootScore = mainSearcher->bestScore;
+    lastPV = mainSearcher->extractPV(rootState, std::max(1, mainSearcher->completedDepth.load()));
+    std::pair<short, short> best = mainSearcher->getBestMove();
+    if (best.first < 0) {
+        // No iteration finished (immediate stop): fall back to the first legal move.
+        std::vector<std::pair<short, short>> moves = mainSearcher->chessLogic->generateAllValidMoves(rootState);
+        best = moves.empty() ? std::make_pair((short)0, (short)0) : moves.front();
+    }
+    if (lastPV.empty() || lastPV.front() != best)
+        lastPV.assign(1, best);
+    // The move played heads the lines even when a stop left the ranking one iteration behind.
+    lastLines = mainSearcher->rootLines;
+    if (lastLines.empty() || lastLines.front().pv.front() != best) {
+        for (size_t i = 0; i < lastLines.size(); i++) {
+            if (lastLines[i].pv.front() == best) {
+                lastLines.erase(lastLines.begin() + i);
+                break;
+            }
+        }
+        RootLine played;
+        played.score = lastRootScore;
+        played.pv = lastPV;
+        lastLines.insert(lastLines.begin(), played);
+        if ((int)lastLines.size() > std::max(1, multiPV))
+            lastLines.pop_back();
+    }
+    if (cache.isOpen() && !historyMatters && mainSearcher->completedDepth > cachedDepth)
+        saveToCache(rootState, lastPV, mainSearcher->completedDepth, lastRootScore);
+    if (traceLog.isOpen()) {
+        char text[160];
+        std::snprintf(text, sizeof(text), "\",\"score\":%d,\"nodes\":%lld,\"time_ms\":%lld}\n",
+                      lastRootScore, getNodes(), lastSearchMs);
+        traceText = "{\"type\":\"result\",\"search\":" + std::to_string(searchCount)
+                    + ",\"move\":\"" + moveToUci(rootState, best) + text;
+        traceLog.write(traceText);
+    }
+    return best;
+}
+
+std::vector<std::pair<short, short>> ChessAI::seedFromCache(const std::vector<short>& rootState) {
+    std::vector<std::pair<short, short>> line;
+    std::vector<uint64_t> seen;
+    std::vector<short> state = rootState;
+    CHESSLOGIC* logic = searchers[0]->chessLogic;
+    while ((int)line.size() < MAX_SEARCH_DEPTH) {
+        uint64_t key = zobristHash(state);
+        TTEntry entry;
+        if (std::find(seen.begin(), seen.end(), key) != seen.end() || !cache.probe(key, entry))
+            break;
+        seen.push_back(key);
+        table->store(key, entry.depth, entry.score, entry.bound, entry.move);
+        if (entry.move.first < 0)
+            break;
+        std::vector<std::pair<short, short>> moves = logic->generateAllValidMoves(state);
+        if (std::find(moves.begin(), moves.end(), entry.move) == moves.end())
+            break;
+        line.push_back(entry.move);
+        CHESSLOGIC::applyMove(state, entry.move);
+    }
+    return line;
+}
 
-    // Return the best move stored in the root node.
-    return ab.root->bestMove;
+bool ChessAI::rootRepeatsHistory(const std::vector<short>& rootState, const std::vector<uint64_t>& history) {
+    if (history.empty())
+        return false;
+    std::vector<std::pair<short, short>> moves = searchers[0]->chessLogic->generateAllValidMoves(rootState);
+    std::vector<short> child;
+    for (const auto& move : moves) {
+        child = rootState;
+        CHESSLOGIC::applyMove(child, move);
+        if (std::find(history.begin(), history.end(), zobristHash(child)) != history.end())
+            return true;
+    }
+    return false;
 }
 
-double ChessAI::getRootEvaluation() const {
-    if (ab.root != nullptr) {
-        return ab.root->evaluation;
+void ChessAI::saveToCache(const std::vector<short>& rootState, const std::vector<std::pair<short, short>>& pv,
+                          int depth, int score) {
+    if (pv.empty())
+        return;
+    std::vector<short> state = rootState;
+    cache.store(zobristHash(state), depth, score, BOUND_EXACT, pv.front());
+    // The positions further down the line keep the table's own entries (scores already in
+    // storage form), so a later session can follow the whole line.
+    for (size_t i = 0; i + 1 < pv.size(); i++) {
+        CHESSLOGIC::applyMove(state, pv[i]);
+        uint64_t key = zobristHash(state);
+        TTEntry entry;
+        if (!table->probe(key, entry) || entry.move != pv[i + 1])
+            break;
+        cache.store(key, entry.depth, entry.score, entry.bound, entry.move);
     }
-    return 0; // or some default value if no root exists.
+}
+
+int ChessAI::getRootEvaluation() const {
+    if (lastRootState.empty())
+        return 0;
+    return (lastRootState[TURN_INDEX] > 0) ? lastRootScore : -lastRootScore;
+}
+
+std::vector<std::pair<short, short>> ChessAI::getPrincipalVariation() const {
+    return lastPV;
+}
+
+std::vector<RootLine> ChessAI::getRootLines() const {
+    return lastLines;
+}
+
+long long ChessAI::getNodes() const {
+    long long total = 0;
+    for (ALPHA_BETA* searcher : searchers)
+        total += searcher->nodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+SearchStats ChessAI::getSearchStats() const {
+    SearchStats total = searchers[0]->stats;
+    for (size_t i = 1; i < searchers.size(); i++)
+        total.merge(searchers[i]->stats);
+    total.nodes = getNodes();
+    total.timeMs = lastSearchMs;
+    return total;
 }
@@ -4,24 +4,38 @@
 #include <vector>
 #include <utility>
 #include <string>
-#include <unordered_map>
-#include <stack>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
 #include "../logic/chesslogic.h"
+#include "../utils/score.h"
+#include "../utils/searchstats.h"
+#include "../utils/tracelog.h"
+#include "transposition.h"
+#include "book.h"
+#include "tablebase.h"
+#include "analysiscache.h"
+#include "nnue.h"
+#include "evalweights.h"
 
 // NODE represents a node in the minimax search tree.
 struct NODE {
-    // The chess state: indices 0–63 represent board squares, index 64 is the turn indicator.
+    // The chess state: indices 0–63 represent board squares, index 64 is the turn indicator,
+    // followed by the castling rights, en passant square and halfmove clock (see the State
+    // Layout in chesslogic.h).
     std::vector<short> state;
     // Pointer to the parent node.
     NODE* parent;
     // Depth of this node in the tree.
     int depth;
-    // Evaluation value
-    double evaluation;
+    // Evaluation in centipawns from the point of view of the side to move (see score.h).
+    int evaluation;
     // Best move from this node (represented as a pair: {source, destination}).
     std::pair<short, short> bestMove;
-    // A unique string representation of the state for duplicate detection.
-    std::string stateString;
+    // Zobrist key of the state, used for transposition table lookups.
+    uint64_t hashKey;
     // The move that was applied to the parent's state to reach this node.
     std::pair<short, short> moveFromParent;
 
@@ -34,49 +48,341 @@ struct NODE {
     // Destructor.
     ~NODE();
 
-    // Build the unique string representation of the state.
-    void buildStateString();
-    // Evaluate the node
-    void evaluateNode(const std::vector<std::pair<short, short>>& validMoves);
-    // Back up the evaluation value to the parent node.
-    void backUpEvaluation();
+    // Turn this node into the child reached by 'move' from 'parent'. The state buffer is
+    // reused, so search frames can be rebuilt without allocating.
+    void setChild(NODE* parent, std::pair<short, short> move);
+    // Recompute the Zobrist key after the state has been set directly.
+    void computeHashKey();
+    // Evaluate the node statically with the classical terms and store the side-to-move
+    // relative score in 'evaluation'.
+    void evaluateNode(const std::vector<std::pair<short, short>>& validMoves, const EvalWeights& weights);
 };
 
-// ALPHA_BETA implements a minimax search with alpha–beta pruning.
+// Deepest iteration the search will attempt.
+const int MAX_SEARCH_DEPTH = 64;
+// Frames in a search stack: one per ply up to the deepest iteration, plus the root.
+const int SEARCH_STACK_SIZE = MAX_SEARCH_DEPTH + 1;
+// Room reserved for the moves of one position (no legal position has more than 218).
+const int MAX_MOVES = 256;
+
+// One ply of the search stack. Every ALPHA_BETA preallocates a frame per ply and reuses them
+// in every search, so searching a node never touches the heap.
+struct SearchFrame {
+    NODE node;                                      // Position at this ply; its parent is the frame above.
+    std::vector<std::pair<short, short>> moves;     // Legal moves, in the order they are searched.
+    std::pair<short, short> killers[2];             // Quiet moves that recently failed high at this ply.
+    int staticEval;                                 // Static evaluation, when the node was evaluated.
+    std::vector<std::pair<short, short>> pv;        // Best line found from this ply on.
+    NnueAccumulator accumulator;                    // Network accumulator of the position, filled lazily.
+
+    SearchFrame() : staticEval(0) {
+        moves.reserve(MAX_MOVES);
+        pv.reserve(SEARCH_STACK_SIZE);
+        clearKillers();
+    }
+    void clearKillers() { killers[0] = killers[1] = std::make_pair((short)-1, (short)-1); }
+};
+
+// Limits for one search. A zero field means "no limit" for that field; with no limit at
+// all the engine searches to its default depth. 'history' carries the game that led to the
+// root, so the search can recognise repetitions of positions played before it.
+struct SearchLimits {
+    int depth;            // Maximum iteration depth.
+    long long nodes;      // Node budget summed over all threads.
+    int movetime;         // Fixed time for this move, in milliseconds.
+    int wtime, btime;     // Remaining clock time, in milliseconds.
+    int winc, binc;       // Increment per move, in milliseconds.
+    int movestogo;        // Moves until the next time control.
+    bool infinite;        // Search until stop() is called.
+    bool ponder;          // Search the opponent's expected reply; limits apply after ponderHit().
+    std::vector<uint64_t> history;  // Zobrist keys of the game's positions, oldest first, up to
+                                    // the root (see CHESSLOGIC::getPositionKeys); may be empty.
+
+    SearchLimits()
+        : depth(0), nodes(0), movetime(0), wtime(0), btime(0), winc(0), binc(0),
+          movestogo(0), infinite(false), ponder(false) {}
+};
+
+// Signals and limits shared by all threads of one search. Times are milliseconds since
+// 'startTime'; zero means "no limit". While 'pondering' is set no limit applies at all.
+struct SearchControl {
+    std::atomic<bool> stop;
+    std::atomic<bool> pondering;
+    std::atomic<int> depthLimit;
+    std::atomic<long long> softLimitMs;   // Do not start another iteration after this.
+    std::atomic<long long> hardLimitMs;   // Abort the search at this point.
+    long long nodeLimit;
+    std::chrono::steady_clock::time_point startTime;
+
+    SearchControl()
+        : stop(false), pondering(false), depthLimit(0), softLimitMs(0), hardLimitMs(0), nodeLimit(0) {}
+
+    long long elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+};
+
+// One ranked root move of a MultiPV search and the line it starts.
+struct RootLine {
+    int score;                                    // Side-to-move relative (see score.h).
+    std::vector<std::pair<short, short>> pv;      // Starts with the root move.
+};
+
+// Progress report emitted by the main search thread after every completed iteration.
+struct SearchInfo {
+    int depth;
+    int seldepth;                                 // Deepest ply of the main thread (0 without SEARCH_STATS).
+    int score;                                    // Side-to-move relative (see score.h).
+    long long nodes;
+    long long timeMs;
+    int hashfull;
+    std::vector<std::pair<short, short>> pv;      // Principal variation from the root.
+    std::vector<RootLine> lines;                  // The best 'multiPV' root moves, best first.
+};
+
+// ALPHA_BETA implements a negamax search with alpha–beta pruning and mate-distance pruning.
+// It is the per-thread search context: it owns its move generator and all data the search
+// touches, so separate instances never share mutable state except the transposition table
+// and the stop flag handed to them by their ChessAI.
 class ALPHA_BETA {
 public:
     ALPHA_BETA();
     ~ALPHA_BETA();
+    ALPHA_BETA(const ALPHA_BETA&) = delete;
+    ALPHA_BETA& operator=(const ALPHA_BETA&) = delete;
 
-    // Perform the search starting from the root node.
-    void search(NODE* current, double alpha, double beta);
+    // Search the subtree below 'current' and return its score for the side to move.
+    int search(NODE* current, int alpha, int beta);
+    // Iterative deepening from the root state up to the control's depth limit. Helper threads
+    // pass a non-zero 'depthOffset' so they work ahead of the main thread on a shared table.
+    void iterate(const std::vector<short>& rootState, int depthOffset);
     // Return the best move found from the root node.
     std::pair<short, short> getBestMove() const;
     // Clear any stored search data.
     void clearSearch();
+    // Seed repetition detection with the game positions before 'rootState' (see
+    // SearchLimits::history); without it only repetitions inside the search are seen.
+    void setGameHistory(const std::vector<uint64_t>& keys, const std::vector<short>& rootState);
     double heuristicMoveScore(const std::pair<short, short>& move, const std::vector<short>& state);
+    // The principal variation: the line collected by the last search from 'rootState',
+    // continued through the transposition table.
+    std::vector<std::pair<short, short>> extractPV(const std::vector<short>& rootState, int maxLength);
     // Maximum depth for the search.
     int maxDepth;
+    // First iteration searched; a warm start from the analysis cache skips the depths it holds.
+    int startDepth;
     // The best move found at the root.
     std::pair<short, short> bestMove;
+    // Score and depth of the last completed iteration.
+    int bestScore;
+    std::atomic<int> completedDepth;
+    // Number of root moves ranked per iteration (MultiPV), and the lines of the last
+    // completed iteration, best first. rootLines[0] starts with bestMove once the
+    // iteration that chose it has completed.
+    int multiPV;
+    std::vector<RootLine> rootLines;
 
-    // Root node pointer.
-    NODE* root;
-    // A hash map for closed nodes (using stateString as the key).
-    std::unordered_map<std::string, NODE*> closedNodes;
+    // The search stack, indexed by ply; frames[0] holds the root. Allocated once and reused.
+    std::vector<SearchFrame> frames;
+    // Move generator private to this search context (never the game's own instance).
     CHESSLOGIC* chessLogic;
+
+    // Shared with the other threads of the same engine.
+    TRANSPOSITION_TABLE* tt;
+    const TABLEBASE* tablebase;
+    // Evaluation network, or null for the classical evaluation (NODE::evaluateNode).
+    const NNUE_NETWORK* network;
+    // Weights of the classical evaluation and of the move ordering heuristic (a copy per thread).
+    EvalWeights weights;
+    SearchControl* control;
+    // Nodes visited by this thread (read by the main thread for node limits and reports).
+    std::atomic<long long> nodes;
+    // Counters of this thread (see searchstats.h); only read once the search has finished.
+    SearchStats stats;
+
+    // Limits are enforced by the main thread only; helpers just watch the stop flag.
+    bool isMain;
+    std::function<long long()> totalNodes;
+    std::function<void(const SearchInfo&)> onIteration;
+
+    // Trace log of the engine, or null when tracing is off (see ChessAI::setTraceFile). The main
+    // thread records every iteration and root move; all threads record the interior nodes
+    // they expand down to 'traceMaxPly'. Lines are tagged with the search and thread number.
+    TRACE_LOG* trace;
+    int traceMaxPly;
+    long long traceSearchId;
+    int threadIndex;
+
+private:
+    // search() and heuristicMoveScore() for a side to move known at compile time.
+    template <Color Us>
+    int searchNode(NODE* current, int alpha, int beta);
+    template <Color Us>
+    double moveOrderScore(const std::pair<short, short>& move, const std::vector<short>& state);
+    // Called periodically by the main thread; raises the stop flag when a limit is hit.
+    void checkLimits();
+    // Static evaluation of a frontier node into its 'evaluation': the network when there is
+    // one, otherwise the classical terms.
+    void evaluate(NODE* current, const std::vector<std::pair<short, short>>& moves);
+    // ---- Repetitions ----
+    // Zobrist keys of the game since its last irreversible move followed by one key per ply
+    // of the current search path; the root's key lives at 'rootKeyIndex'.
+    std::vector<uint64_t> keyStack;
+    int rootKeyIndex;
+    // True if 'node' repeats a position of the game or the search path.
+    bool isRepetition(const NODE* node) const;
+    // ---- MultiPV ----
+    // Root moves heading the lines already found in the current iteration; the root skips them.
+    std::vector<std::pair<short, short>> excludedRootMoves;
+    // The line of 'rootMove' from the search stack, continued through the table.
+    std::vector<std::pair<short, short>> lineFromStack(const std::vector<short>& rootState,
+                                                       std::pair<short, short> rootMove, int maxLength);
+    // Best moves stored in the table from 'state' on, without the root move check of extractPV.
+    std::vector<std::pair<short, short>> followTable(const std::vector<short>& state, int maxLength);
+
+    // ---- Tracing ----
+    // Lines are gathered here and handed to the log in large chunks.
+    std::string traceBuffer;
+    void traceLine(const std::string& line);
+    void flushTrace();
+    // Common fields of a line: {"type":..., "search":..., "thread":..., "depth":...
+    std::string traceHeader(const char* type) const;
+    void traceIteration(const std::vector<short>& rootState, bool complete, long long iterationMs);
+    void traceRootMove(NODE& child, int index, int score, int alpha, int beta,
+                       long long nodesSpent, long long micros);
+    void traceNode(const NODE* node, int alpha, int beta, int score, size_t moveCount, int bestIndex,
+                   long long nodesSpent, long long micros);
 };
 
 // ChessAI provides a high-level interface to get the best move based on the current CHESSLOGIC state.
+// Each ChessAI is an independent engine instance; it only reads the game it is given.
 class ChessAI {
 public:
     ChessAI();
+    ~ChessAI();
+    ChessAI(const ChessAI&) = delete;
+    ChessAI& operator=(const ChessAI&) = delete;
+
     // Given a CHESSLOGIC instance, return the best move as a {source, destination} pair.
-    std::pair<short, short> getBestMove(CHESSLOGIC& game);
-    double getRootEvaluation() const;
+    // The other ranked moves of a MultiPV search are available from getRootLines().
+    std::pair<short, short> getBestMove(const CHESSLOGIC& game);
+    // Search a state within the given limits and return the best move found. Blocks until
+    // the search finishes; stop() may be called from another thread to end it early.
+    std::pair<short, short> search(const std::vector<short>& rootState, const SearchLimits& limits);
+    // Ask a running search to finish as soon as possible; it returns the best move found so far.
+    void stop();
+
+    // Run search() on a background thread so the caller stays responsive. 'onFinished' is
+    // invoked on that thread once the move is ready; collect it with waitForResult().
+    void startSearch(const std::vector<short>& rootState, const SearchLimits& limits,
+                     std::function<void()> onFinished);
+    // True while a background search is running (or finished but not yet collected).
+    bool isSearching() const;
+    // Join the background search and return its move. Call stop() first to cut it short.
+    std::pair<short, short> waitForResult();
+    // The opponent played the expected move: a ponder search turns into a normal search,
+    // keeping everything it has searched so far, and its limits start counting now.
+    void ponderHit();
+
+    // Root score in centipawns from White's point of view (mate scores as in score.h).
+    int getRootEvaluation() const;
+    // Principal variation of the last search.
+    std::vector<std::pair<short, short>> getPrincipalVariation() const;
+    // The best 'multiPV' root moves of the last search with their scores and lines, best
+    // first; the first one is the move returned.
+    std::vector<RootLine> getRootLines() const;
+    // Nodes searched by all threads in the last search.
+    long long getNodes() const;
+    // Counters of the last search summed over all threads; only the node count and time
+    // are filled in builds without SEARCH_STATS.
+    SearchStats getSearchStats() const;
+
+    // Engine configuration.
+    void setHashSize(int megabytes);
+    void setThreads(int count);
+    void clearHash();
+    // Search with a table owned by the caller instead of the engine's own, so a pool of
+    // engines can share what they learn; null returns to the own table. The caller sizes
+    // and clears a shared table (setHashSize and clearHash act on the own one).
+    void shareTable(TRANSPOSITION_TABLE* shared);
+    // Open an opening book file (see book.h); an empty path closes the current one.
+    // Returns false if the file could not be opened.
+    bool setBook(const std::string& path);
+    // Map the endgame tables of a directory (see tablebase.h); returns how many were found.
+    int setTablebasePath(const std::string& directory);
+    // Record a JSON-lines trace of every following search in 'path': iterations, root moves
+    // and the interior nodes expanded down to 'tracePly'. The file is written by a background
+    // thread; an empty path ends tracing. Returns false if the file could not be created.
+    bool setTraceFile(const std::string& path);
+    // Load an evaluation network (see nnue.h); an empty path unloads it. Returns false if
+    // the file is missing or malformed. Searches use the network while 'useNetwork' is set.
+    bool setEvalFile(const std::string& path);
+    // Read classical evaluation and move ordering weights (see evalweights.h), e.g. as written
+    // by chess_tune; an empty path restores the defaults. Returns false if the file is
+    // missing or malformed, keeping the current weights.
+    bool setEvalWeights(const std::string& path);
+    // Evaluate with a network owned by the caller, so a pool of engines loads the weights
+    // once; null returns to the own network.
+    void shareNetwork(const NNUE_NETWORK* shared);
+    // Map a persistent analysis cache (see analysiscache.h), created with 'megabytes' of
+    // slots if the file is new. Searches answer from it when it already holds the depth asked
+    // for, otherwise resume after the depth it holds, and write their results back. An empty
+    // path closes the cache. Returns false if the file could not be mapped.
+    bool setAnalysisCache(const std::string& path, int megabytes);
+    // Depth used when a search is started without any limit.
+    int defaultDepth;
+    // Number of best root moves to rank and report (1: the best move only).
+    int multiPV;
+    // Evaluate with the loaded network instead of the classical evaluation.
+    bool useNetwork;
+    // Play the heaviest book move instead of a weighted random one.
+    bool bookBestOnly;
+    // Deepest ply whose interior nodes are traced (0: iterations and root moves only).
+    int tracePly;
+    // Called on the searching thread after every completed iteration.
+    std::function<void(const SearchInfo&)> onIteration;
 
 private:
-    ALPHA_BETA ab; // The alpha–beta search object.
+    // search() without resetting the stop flag, so a stop() racing a background start is kept.
+    std::pair<short, short> runSearch(const std::vector<short>& rootState, const SearchLimits& limits);
+    // ---- Analysis cache ----
+    // Follow the best moves stored in the cache from 'rootState', copying each entry into the
+    // table so the search starts from what earlier sessions found; returns the line.
+    std::vector<std::pair<short, short>> seedFromCache(const std::vector<short>& rootState);
+    // True if a legal move from 'rootState' leads to a position in the game 'history', where
+    // a cached result (which ignores the game) could walk into a repetition.
+    bool rootRepeatsHistory(const std::vector<short>& rootState, const std::vector<uint64_t>& history);
+    // Write the root result and the table's entries along 'pv' back to the cache.
+    void saveToCache(const std::vector<short>& rootState, const std::vector<std::pair<short, short>>& pv,
+                     int depth, int score);
+
+    TRANSPOSITION_TABLE tt;
+    // The table searches use: 'tt' unless shareTable() supplied another one.
+    TRANSPOSITION_TABLE* table;
+    OPENING_BOOK book;
+    TABLEBASE tablebase;
+    ANALYSIS_CACHE cache;
+    NNUE_NETWORK ownNetwork;
+    // The network searches use: 'ownNetwork' unless shareNetwork() supplied another one.
+    const NNUE_NETWORK* network;
+    EvalWeights evalWeights;
+    SearchControl control;
+    // Time budget of the current search, applied from the start or from ponderHit().
+    long long budgetMs;
+    // searchers[0] runs on the calling thread, the others are helper threads.
+    std::vector<ALPHA_BETA*> searchers;
+    std::vector<short> lastRootState;
+    int lastRootScore;
+    std::vector<std::pair<short, short>> lastPV;
+    std::vector<RootLine> lastLines;
+    long long lastSearchMs;
+    // Search trace (see setTraceFile).
+    TRACE_LOG traceLog;
+    long long searchCount;
+    // Background search started by startSearch().
+    std::thread worker;
+    std::pair<short, short> workerResult;
 };
 
-#endif // CHESS_AI_H
\ No newline at end of file
+#endif // CHESS_AI_H
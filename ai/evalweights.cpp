@@ -0,0 +1,158 @@
+#include "evalweights.h"
+#include "../logic/chesslogic.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char* const TERM_NAMES[EVAL_TERM_COUNT] = {
+    "pawn", "knight", "bishop", "rook", "queen", "knight_crowded", "bishop_open", "centre",
+    "centre_ring", "mobility", "capture", "home_file", "low_mobility", "castling_rights",
+};
+
+// The move ordering weights by file name.
+struct OrderWeight {
+    const char* name;
+    double EvalWeights::* field;
+};
+
+const OrderWeight ORDER_WEIGHTS[] = {
+    { "order_capture",     &EvalWeights::orderCapture },
+    { "order_centre",      &EvalWeights::orderCentre },
+    { "order_edge",        &EvalWeights::orderEdge },
+    { "order_distance",    &EvalWeights::orderDistance },
+    { "order_development", &EvalWeights::orderDevelopment },
+    { "order_castling",    &EvalWeights::orderCastling },
+    { "order_advance",     &EvalWeights::orderAdvance },
+};
+
+} // namespace
+
+EvalWeights::EvalWeights()
+    : orderCapture(0.5), orderCentre(0.2), orderEdge(0.2), orderDistance(0.05), orderDevelopment(0.2),
+      orderCastling(3), orderAdvance(0.15)
+{
+    const int defaults[EVAL_TERM_COUNT] = { 100, 300, 300, 500, 900, 30, 30, 100, 50, 10, 10, -30, -30, 500 };
+    for (int i = 0; i < EVAL_TERM_COUNT; i++)
+        terms[i] = defaults[i];
+}
+
+const char* evalTermName(int term) {
+    return (term >= 0 && term < EVAL_TERM_COUNT) ? TERM_NAMES[term] : "";
+}
+
+void evalFeatures(const std::vector<short>& state, const std::vector<std::pair<short, short>>& validMoves,
+                  int features[EVAL_TERM_COUNT]) {
+    for (int i = 0; i < EVAL_TERM_COUNT; i++)
+        features[i] = 0;
+
+    // Moves and captures per origin square, gathered in one pass over the move list.
+    int mobility[64] = {0};
+    int captures[64] = {0};
+    for (const auto& move : validMoves) {
+        mobility[move.first]++;
+        if (state[move.second] != 0)
+            captures[move.first]++;
+    }
+
+    int pieceCount = 0;
+    for (int i = 0; i < 64; i++) {
+        if (state[i] != 0)
+            pieceCount++;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        short piece = state[i];
+        short kind = std::abs(piece);
+        if (piece == 0 || kind == 127)
+            continue;
+        int sign = (piece > 0) ? 1 : -1;
+        int col = i % 8;
+
+        switch (kind) {
+            case 1: features[TERM_PAWN] += sign; break;
+            case 3: features[TERM_KNIGHT] += sign; break;
+            case 6: features[TERM_BISHOP] += sign; break;
+            case 5: features[TERM_ROOK] += sign; break;
+            case 9: features[TERM_QUEEN] += sign; break;
+        }
+        if (kind == 3 && pieceCount > EVAL_CROWDED_PIECES)
+            features[TERM_KNIGHT_CROWDED] += sign;
+        else if (kind == 6 && pieceCount <= EVAL_CROWDED_PIECES)
+            features[TERM_BISHOP_OPEN] += sign;
+
+        int row = i / 8;
+        bool inCentre = (row == 3 || row == 4) && (col == 3 || col == 4);
+        if (inCentre)
+            features[TERM_CENTRE] += sign;
+        else if (row >= 2 && row <= 5 && col >= 2 && col <= 5)
+            features[TERM_CENTRE_RING] += sign;
+
+        features[TERM_MOBILITY] += sign * mobility[i];
+        features[TERM_CAPTURE] += sign * captures[i];
+        if (mobility[i] < EVAL_LOW_MOBILITY)
+            features[TERM_LOW_MOBILITY] += sign;
+
+        bool onHomeFile = (kind == 5 && (col == 0 || col == 7)) || (kind == 3 && (col == 1 || col == 6))
+                       || (kind == 6 && (col == 2 || col == 5)) || (kind == 9 && col == 3);
+        if (onHomeFile)
+            features[TERM_HOME_FILE] += sign;
+    }
+
+    if (state[CASTLE_INDEX] & CASTLE_WHITE)
+        features[TERM_CASTLING_RIGHTS]++;
+    if (state[CASTLE_INDEX] & CASTLE_BLACK)
+        features[TERM_CASTLING_RIGHTS]--;
+}
+
+bool loadEvalWeights(const std::string& path, EvalWeights& weights) {
+    std::ifstream in(path.c_str());
+    if (!in)
+        return false;
+    EvalWeights loaded = weights;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string name;
+        double value;
+        if (!(fields >> name))
+            continue;
+        if (!(fields >> value))
+            return false;
+        bool known = false;
+        for (int i = 0; i < EVAL_TERM_COUNT && !known; i++) {
+            if (name == TERM_NAMES[i]) {
+                loaded.terms[i] = (int)std::lround(value);
+                known = true;
+            }
+        }
+        for (const OrderWeight& order : ORDER_WEIGHTS) {
+            if (!known && name == order.name) {
+                loaded.*order.field = value;
+                known = true;
+            }
+        }
+        if (!known)
+            return false;
+    }
+    weights = loaded;
+    return true;
+}
+
+bool saveEvalWeights(const std::string& path, const EvalWeights& weights) {
+    std::ofstream out(path.c_str());
+    out << "# Evaluation terms, centipawns per unit (see evalweights.h)\n";
+    for (int i = 0; i < EVAL_TERM_COUNT; i++)
+        out << TERM_NAMES[i] << " " << weights.terms[i] << "\n";
+    out << "# Move ordering\n";
+    for (const OrderWeight& order : ORDER_WEIGHTS) {
+        char value[32];
+        std::snprintf(value, sizeof(value), "%g", weights.*order.field);
+        out << order.name << " " << value << "\n";
+    }
+    return (bool)out;
+}
@@ -0,0 +1,72 @@
+// evalweights.h
+#ifndef EVALWEIGHTS_H
+#define EVALWEIGHTS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// ------------------ Evaluation Weights ------------------
+// The classical evaluation is a weighted sum of terms: each term is a count of White's
+// pieces (or moves) with some property minus the same count for Black, so the score is the
+// dot product of the weights with the term counts of a position. The counts are computed by
+// evalFeatures(); NODE::evaluateNode and the tuner (chess_tune) both score positions through
+// it, so tuned weights mean the same thing in the search.
+
+enum EvalTerm {
+    TERM_PAWN,               // Material, per piece.
+    TERM_KNIGHT,
+    TERM_BISHOP,
+    TERM_ROOK,
+    TERM_QUEEN,
+    TERM_KNIGHT_CROWDED,     // Knights while more than EVAL_CROWDED_PIECES pieces remain.
+    TERM_BISHOP_OPEN,        // Bishops once EVAL_CROWDED_PIECES or fewer remain.
+    TERM_CENTRE,             // Non-king pieces on d4, e4, d5, e5.
+    TERM_CENTRE_RING,        // Non-king pieces on the ring c3-f3-f6-c6 around the centre.
+    TERM_MOBILITY,           // Legal moves of non-king pieces (side to move only).
+    TERM_CAPTURE,            // Legal captures of non-king pieces (side to move only).
+    TERM_HOME_FILE,          // Knights, bishops, rooks and queens on a file they start on.
+    TERM_LOW_MOBILITY,       // Non-king pieces with fewer than EVAL_LOW_MOBILITY moves.
+    TERM_CASTLING_RIGHTS,    // Any castling right left.
+    EVAL_TERM_COUNT
+};
+
+const int EVAL_CROWDED_PIECES = 20;
+const int EVAL_LOW_MOBILITY = 3;
+
+// Weights of the evaluation terms in centipawns, and of the move ordering heuristic
+// (ALPHA_BETA::heuristicMoveScore). The defaults are the hand-picked values the engine has
+// always used. Ordering weights do not change any score, so chess_tune leaves them alone.
+struct EvalWeights {
+    int terms[EVAL_TERM_COUNT];
+    double orderCapture;       // Per unit of the captured piece's code.
+    double orderCentre;        // Landing on c3-f6.
+    double orderEdge;          // Penalty for landing on the a, b, g or h file.
+    double orderDistance;      // Per square travelled.
+    double orderDevelopment;   // Knight or bishop leaving its back rank.
+    double orderCastling;
+    double orderAdvance;       // Landing in the opponent's half.
+
+    EvalWeights();
+    // Score in centipawns from White's point of view for the term counts of a position.
+    int score(const int features[EVAL_TERM_COUNT]) const {
+        int total = 0;
+        for (int i = 0; i < EVAL_TERM_COUNT; i++)
+            total += terms[i] * features[i];
+        return total;
+    }
+};
+
+// Name of a term in weight files ("pawn", "knight_crowded", ...).
+const char* evalTermName(int term);
+// Term counts of a state, White minus Black. 'validMoves' are the legal moves of the side
+// to move, as given to NODE::evaluateNode.
+void evalFeatures(const std::vector<short>& state, const std::vector<std::pair<short, short>>& validMoves,
+                  int features[EVAL_TERM_COUNT]);
+
+// Weight files hold one "name value" pair per line; '#' starts a comment. Names that are
+// missing keep their current value. Loading fails on an unknown name or a malformed value.
+bool loadEvalWeights(const std::string& path, EvalWeights& weights);
+bool saveEvalWeights(const std::string& path, const EvalWeights& weights);
+
+#endif // EVALWEIGHTS_H
@@ -0,0 +1,201 @@
+#include "kpk.h"
+#include "../logic/chesslogic.h"
+#include "../utils/score.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+// Positions are indexed by white king (6 bits), black king (6 bits), side to move (1 bit),
+// pawn file a-d (2 bits) and pawn row 1-6 (3 bits); pawns on files e-h are mirrored.
+const int KPK_SIZE = 1 << 18;
+
+// Classification during generation; results are OR-ed together, so they are bit flags.
+const uint8_t KPK_INVALID = 0;
+const uint8_t KPK_UNKNOWN = 1;
+const uint8_t KPK_DRAW    = 2;
+const uint8_t KPK_WIN     = 4;
+
+int kpkIndex(int whiteKing, int blackKing, bool whiteToMove, int pawn) {
+    return whiteKing | (blackKing << 6) | ((whiteToMove ? 0 : 1) << 12)
+         | ((pawn % 8) << 13) | ((pawn / 8 - 1) << 15);
+}
+
+int distance(int a, int b) {
+    return std::max(std::abs(a / 8 - b / 8), std::abs(a % 8 - b % 8));
+}
+
+// True if a white pawn on 'pawn' attacks 'square'.
+bool pawnAttacks(int pawn, int square) {
+    return (square == pawn - 9 && pawn % 8 > 0) || (square == pawn - 7 && pawn % 8 < 7);
+}
+
+// Squares a king on 'square' can step to.
+int kingSteps(int square, int steps[8]) {
+    int count = 0;
+    for (int dr = -1; dr <= 1; dr++) {
+        for (int dc = -1; dc <= 1; dc++) {
+            int row = square / 8 + dr, col = square % 8 + dc;
+            if ((dr != 0 || dc != 0) && row >= 0 && row < 8 && col >= 0 && col < 8)
+                steps[count++] = row * 8 + col;
+        }
+    }
+    return count;
+}
+
+struct KpkBitbase {
+    std::vector<uint32_t> wins;
+
+    KpkBitbase() : wins(KPK_SIZE / 32, 0) {
+        std::vector<uint8_t> db(KPK_SIZE, KPK_INVALID);
+        for (int index = 0; index < KPK_SIZE; index++) {
+            // Row codes 6 and 7 are unused (pawns never stand on rows 0 or 7).
+            if (((index >> 15) & 7) > 5)
+                continue;
+            int whiteKing = index & 63, blackKing = (index >> 6) & 63;
+            bool whiteToMove = ((index >> 12) & 1) == 0;
+            int pawn = (((index >> 15) & 7) + 1) * 8 + ((index >> 13) & 3);
+            db[index] = classifyStatic(whiteKing, blackKing, whiteToMove, pawn);
+        }
+
+        // Retrograde iteration: settle positions from their successors until nothing changes.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int index = 0; index < KPK_SIZE; index++) {
+                if (db[index] != KPK_UNKNOWN)
+                    continue;
+                int whiteKing = index & 63, blackKing = (index >> 6) & 63;
+                bool whiteToMove = ((index >> 12) & 1) == 0;
+                int pawn = (((index >> 15) & 7) + 1) * 8 + ((index >> 13) & 3);
+                uint8_t result = classifyFromSuccessors(db, whiteKing, blackKing, whiteToMove, pawn);
+                if (result != KPK_UNKNOWN) {
+                    db[index] = result;
+                    changed = true;
+                }
+            }
+        }
+
+        // Whatever is still unknown cannot be forced: a draw.
+        for (int index = 0; index < KPK_SIZE; index++) {
+            if (db[index] == KPK_WIN)
+                wins[index / 32] |= 1u << (index % 32);
+        }
+    }
+
+    static uint8_t classifyStatic(int whiteKing, int blackKing, bool whiteToMove, int pawn) {
+        if (whiteKing == blackKing || whiteKing == pawn || blackKing == pawn || distance(whiteKing, blackKing) <= 1)
+            return KPK_INVALID;
+        // The side not to move cannot be in check.
+        if (whiteToMove && pawnAttacks(pawn, blackKing))
+            return KPK_INVALID;
+
+        // The pawn promotes and the new queen cannot be taken.
+        int promotion = pawn - 8;
+        if (whiteToMove && pawn / 8 == 1 && whiteKing != promotion &&
+            (distance(blackKing, promotion) > 1 || distance(whiteKing, promotion) == 1))
+            return KPK_WIN;
+
+        if (!whiteToMove) {
+            // Black is stalemated, or takes an undefended pawn.
+            int steps[8];
+            int count = kingSteps(blackKing, steps);
+            bool canMove = false;
+            for (int i = 0; i < count; i++) {
+                if (distance(steps[i], whiteKing) > 1 && !pawnAttacks(pawn, steps[i]))
+                    canMove = true;
+            }
+            if (!canMove || (distance(blackKing, pawn) == 1 && distance(whiteKing, pawn) > 1))
+                return KPK_DRAW;
+        }
+        return KPK_UNKNOWN;
+    }
+
+    static uint8_t classifyFromSuccessors(const std::vector<uint8_t>& db, int whiteKing, int blackKing,
+                                          bool whiteToMove, int pawn) {
+        // Illegal successors index KPK_INVALID entries and add nothing.
+        uint8_t successors = 0;
+        int steps[8];
+        if (whiteToMove) {
+            int count = kingSteps(whiteKing, steps);
+            for (int i = 0; i < count; i++)
+                successors |= db[kpkIndex(steps[i], blackKing, false, pawn)];
+            int push = pawn - 8;
+            if (pawn / 8 > 1 && push != blackKing && push != whiteKing) {
+                successors |= db[kpkIndex(whiteKing, blackKing, false, push)];
+                int doublePush = pawn - 16;
+                if (pawn / 8 == 6 && doublePush != blackKing && doublePush != whiteKing)
+                    successors |= db[kpkIndex(whiteKing, blackKing, false, doublePush)];
+            }
+            if (successors & KPK_WIN)
+                return KPK_WIN;
+            return (successors & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+        }
+        int count = kingSteps(blackKing, steps);
+        for (int i = 0; i < count; i++)
+            successors |= db[kpkIndex(whiteKing, steps[i], true, pawn)];
+        if (successors & KPK_DRAW)
+            return KPK_DRAW;
+        return (successors & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+    }
+};
+
+const KpkBitbase& bitbase() {
+    static const KpkBitbase table;
+    return table;
+}
+
+} // namespace
+
+void kpkInit() {
+    bitbase();
+}
+
+bool kpkProbe(short strongKing, short strongPawn, short weakKing, bool strongToMove) {
+    // Mirror pawns on files e-h onto files a-d.
+    if (strongPawn % 8 > 3) {
+        strongKing ^= 7;
+        strongPawn ^= 7;
+        weakKing ^= 7;
+    }
+    int index = kpkIndex(strongKing, weakKing, strongToMove, strongPawn);
+    return (bitbase().wins[index / 32] >> (index % 32)) & 1;
+}
+
+bool kpkEvaluate(const std::vector<short>& state, int& score) {
+    short whiteKing = -1, blackKing = -1, pawn = -1;
+    for (short sq = 0; sq < 64; sq++) {
+        short piece = state[sq];
+        if (piece == 0)
+            continue;
+        if (piece == 127)
+            whiteKing = sq;
+        else if (piece == -127)
+            blackKing = sq;
+        else if (std::abs(piece) == 1 && pawn < 0)
+            pawn = sq;
+        else
+            return false;
+    }
+    if (pawn < 0 || whiteKing < 0 || blackKing < 0)
+        return false;
+
+    // Look at the position from the pawn's side, with the pawn moving up the board.
+    bool pawnIsWhite = state[pawn] > 0;
+    short strongKing = pawnIsWhite ? whiteKing : blackKing ^ 56;
+    short weakKing = pawnIsWhite ? blackKing : whiteKing ^ 56;
+    short strongPawn = pawnIsWhite ? pawn : pawn ^ 56;
+    bool sideToMoveIsStrong = (state[TURN_INDEX] > 0) == pawnIsWhite;
+    if (strongPawn / 8 < 1 || strongPawn / 8 > 6)
+        return false;
+
+    if (!kpkProbe(strongKing, strongPawn, weakKing, sideToMoveIsStrong)) {
+        score = 0;
+        return true;
+    }
+    // Prefer wins with the pawn further up, so the search keeps making progress.
+    int winScore = KNOWN_WIN + (6 - strongPawn / 8) * 100;
+    score = sideToMoveIsStrong ? winScore : -winScore;
+    return true;
+}
@@ -0,0 +1,23 @@
+// kpk.h
+#ifndef KPK_H
+#define KPK_H
+
+#include <vector>
+
+// King and pawn versus king bitbase: one win/draw bit for every placement of the three
+// pieces and side to move. It is computed by retrograde analysis the first time it is
+// used (or by kpkInit()), which takes a few milliseconds.
+
+// Build the bitbase now instead of on the first probe.
+void kpkInit();
+
+// Returns true if the side with the pawn wins. Squares use the board indices
+// (0 = a8 ... 63 = h1) with the strong side playing White, i.e. the pawn moves towards
+// row 0; the pawn must be on rows 1-6.
+bool kpkProbe(short strongKing, short strongPawn, short weakKing, bool strongToMove);
+
+// If 'state' is K+P v K, store its exact score for the side to move in 'score' (0 for a
+// draw, KNOWN_WIN plus a bonus for pawn progress for a win) and return true.
+bool kpkEvaluate(const std::vector<short>& state, int& score);
+
+#endif // KPK_H
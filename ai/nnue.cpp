@@ -0,0 +1,348 @@
+#include "nnue.h"
+#include "../logic/chesslogic.h"
+#include "../utils/score.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+// The SIMD kernels are compiled for their instruction set function by function, so the
+// binary runs on any x86 CPU and picks them at run time.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NNUE_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(NNUE_HIDDEN % 32 == 0 && NNUE_L2 % 32 == 0, "layer sizes must fill whole SIMD registers");
+
+namespace {
+
+// Feature kind of a piece code (0 pawn ... 4 queen), or -1 for empty squares and kings.
+int pieceKind(short piece) {
+    switch (std::abs(piece)) {
+        case 1:  return 0;
+        case 3:  return 1;
+        case 6:  return 2;
+        case 5:  return 3;
+        case 9:  return 4;
+        default: return -1;
+    }
+}
+
+// Squares as seen by 'side': Black's view is flipped vertically.
+inline int orient(int square, int side) { return side == 0 ? square : square ^ 56; }
+
+inline int featureIndex(int side, int kingSquare, short piece, int square) {
+    bool ours = (piece > 0) == (side == 0);
+    return orient(kingSquare, side) * NNUE_FEATURES_PER_KING
+         + (pieceKind(piece) * 2 + (ours ? 0 : 1)) * 64 + orient(square, side);
+}
+
+// ---------------- Scalar kernels ----------------
+
+// to = from - rows(removed) + rows(added), on NNUE_HIDDEN lanes of int16.
+void updateScalar(const int16_t* from, int16_t* to, const int16_t* weights,
+                  const int* added, int addedCount, const int* removed, int removedCount) {
+    if (from != to)
+        std::memcpy(to, from, NNUE_HIDDEN * sizeof(int16_t));
+    for (int i = 0; i < removedCount; i++) {
+        const int16_t* row = weights + (size_t)removed[i] * NNUE_HIDDEN;
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            to[j] = (int16_t)(to[j] - row[j]);
+    }
+    for (int i = 0; i < addedCount; i++) {
+        const int16_t* row = weights + (size_t)added[i] * NNUE_HIDDEN;
+        for (int j = 0; j < NNUE_HIDDEN; j++)
+            to[j] = (int16_t)(to[j] + row[j]);
+    }
+}
+
+// Clipped ReLU of the accumulator: int16 to 0..127.
+void clipScalar(const int16_t* in, uint8_t* out, int count) {
+    for (int i = 0; i < count; i++)
+        out[i] = (uint8_t)std::max(0, std::min((int)in[i], 127));
+}
+
+// out[j] = biases[j] + row j of 'weights' . in
+void affineScalar(const uint8_t* in, int inCount, const int8_t* weights, const int32_t* biases,
+                  int32_t* out, int outCount) {
+    for (int j = 0; j < outCount; j++) {
+        const int8_t* row = weights + (size_t)j * inCount;
+        int32_t sum = biases[j];
+        for (int i = 0; i < inCount; i++)
+            sum += (int32_t)in[i] * row[i];
+        out[j] = sum;
+    }
+}
+
+#ifdef NNUE_X86
+// ---------------- SSSE3 kernels ----------------
+
+__attribute__((target("ssse3")))
+void updateSsse3(const int16_t* from, int16_t* to, const int16_t* weights,
+                 const int* added, int addedCount, const int* removed, int removedCount) {
+    for (int offset = 0; offset < NNUE_HIDDEN; offset += 8) {
+        __m128i sum = _mm_loadu_si128((const __m128i*)(from + offset));
+        for (int i = 0; i < removedCount; i++)
+            sum = _mm_sub_epi16(sum, _mm_loadu_si128((const __m128i*)(weights + (size_t)removed[i] * NNUE_HIDDEN + offset)));
+        for (int i = 0; i < addedCount; i++)
+            sum = _mm_add_epi16(sum, _mm_loadu_si128((const __m128i*)(weights + (size_t)added[i] * NNUE_HIDDEN + offset)));
+        _mm_storeu_si128((__m128i*)(to + offset), sum);
+    }
+}
+
+__attribute__((target("ssse3")))
+void clipSsse3(const int16_t* in, uint8_t* out, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < count; i += 16) {
+        // Negative values go to zero first; the signed pack then saturates at 127.
+        __m128i low = _mm_max_epi16(_mm_loadu_si128((const __m128i*)(in + i)), zero);
+        __m128i high = _mm_max_epi16(_mm_loadu_si128((const __m128i*)(in + i + 8)), zero);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi16(low, high));
+    }
+}
+
+__attribute__((target("ssse3")))
+void affineSsse3(const uint8_t* in, int inCount, const int8_t* weights, const int32_t* biases,
+                 int32_t* out, int outCount) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (int j = 0; j < outCount; j++) {
+        const int8_t* row = weights + (size_t)j * inCount;
+        __m128i sum = _mm_setzero_si128();
+        for (int i = 0; i < inCount; i += 16) {
+            // Inputs are at most 127, so the pairwise int16 products cannot saturate.
+            __m128i products = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(in + i)),
+                                                 _mm_loadu_si128((const __m128i*)(row + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        out[j] = biases[j] + _mm_cvtsi128_si32(sum);
+    }
+}
+
+// ---------------- AVX2 kernels ----------------
+
+__attribute__((target("avx2")))
+void updateAvx2(const int16_t* from, int16_t* to, const int16_t* weights,
+                const int* added, int addedCount, const int* removed, int removedCount) {
+    for (int offset = 0; offset < NNUE_HIDDEN; offset += 16) {
+        __m256i sum = _mm256_loadu_si256((const __m256i*)(from + offset));
+        for (int i = 0; i < removedCount; i++)
+            sum = _mm256_sub_epi16(sum, _mm256_loadu_si256((const __m256i*)(weights + (size_t)removed[i] * NNUE_HIDDEN + offset)));
+        for (int i = 0; i < addedCount; i++)
+            sum = _mm256_add_epi16(sum, _mm256_loadu_si256((const __m256i*)(weights + (size_t)added[i] * NNUE_HIDDEN + offset)));
+        _mm256_storeu_si256((__m256i*)(to + offset), sum);
+    }
+}
+
+__attribute__((target("avx2")))
+void clipAvx2(const int16_t* in, uint8_t* out, int count) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < count; i += 32) {
+        __m256i low = _mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(in + i)), zero);
+        __m256i high = _mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(in + i + 16)), zero);
+        // The pack works within 128-bit lanes; the permute puts the quarters back in order.
+        __m256i packed = _mm256_packs_epi16(low, high);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+}
+
+__attribute__((target("avx2")))
+void affineAvx2(const uint8_t* in, int inCount, const int8_t* weights, const int32_t* biases,
+                int32_t* out, int outCount) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int j = 0; j < outCount; j++) {
+        const int8_t* row = weights + (size_t)j * inCount;
+        __m256i sum = _mm256_setzero_si256();
+        for (int i = 0; i < inCount; i += 32) {
+            __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(in + i)),
+                                                    _mm256_loadu_si256((const __m256i*)(row + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        out[j] = biases[j] + _mm_cvtsi128_si32(half);
+    }
+}
+#endif // NNUE_X86
+
+struct KernelSet {
+    void (*update)(const int16_t*, int16_t*, const int16_t*, const int*, int, const int*, int);
+    void (*clip)(const int16_t*, uint8_t*, int);
+    void (*affine)(const uint8_t*, int, const int8_t*, const int32_t*, int32_t*, int);
+};
+
+// Indexed by NnueKernel; without x86 every entry is the scalar set (never selected).
+const KernelSet KERNELS[] = {
+    { updateScalar, clipScalar, affineScalar },
+#ifdef NNUE_X86
+    { updateSsse3, clipSsse3, affineSsse3 },
+    { updateAvx2, clipAvx2, affineAvx2 },
+#else
+    { updateScalar, clipScalar, affineScalar },
+    { updateScalar, clipScalar, affineScalar },
+#endif
+};
+
+template <typename T>
+bool readArray(std::istream& in, std::vector<T>& values, size_t count) {
+    values.assign(count, 0);
+    return (bool)in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+} // namespace
+
+NNUE_NETWORK::NNUE_NETWORK() : loaded(false), activeKernel(bestKernel()), outBias(0) {}
+
+bool NNUE_NETWORK::kernelSupported(NnueKernel requested) {
+#ifdef NNUE_X86
+    __builtin_cpu_init();
+    if (requested == KERNEL_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (requested == KERNEL_SSSE3)
+        return __builtin_cpu_supports("ssse3");
+#endif
+    return requested == KERNEL_SCALAR;
+}
+
+NnueKernel NNUE_NETWORK::bestKernel() {
+    if (kernelSupported(KERNEL_AVX2))
+        return KERNEL_AVX2;
+    if (kernelSupported(KERNEL_SSSE3))
+        return KERNEL_SSSE3;
+    return KERNEL_SCALAR;
+}
+
+const char* NNUE_NETWORK::kernelName(NnueKernel requested) {
+    return requested == KERNEL_AVX2 ? "avx2" : (requested == KERNEL_SSSE3 ? "ssse3" : "scalar");
+}
+
+bool NNUE_NETWORK::setKernel(NnueKernel requested) {
+    if (!kernelSupported(requested))
+        return false;
+    activeKernel = requested;
+    return true;
+}
+
+bool NNUE_NETWORK::load(const std::string& path) {
+    clear();
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char magic[8];
+    uint32_t dimensions[5];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, NNUE_MAGIC, sizeof(magic)) != 0
+        || !in.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions)))
+        return false;
+    if (dimensions[0] != (uint32_t)NNUE_INPUTS || dimensions[1] != (uint32_t)NNUE_HIDDEN
+        || dimensions[2] != (uint32_t)NNUE_L2 || dimensions[3] != (uint32_t)NNUE_L3
+        || dimensions[4] != (uint32_t)NNUE_FEATURES_PER_KING)
+        return false;
+    bool ok = readArray(in, ftBiases, NNUE_HIDDEN)
+           && readArray(in, ftWeights, (size_t)NNUE_INPUTS * NNUE_HIDDEN)
+           && readArray(in, l1Biases, NNUE_L2)
+           && readArray(in, l1Weights, (size_t)NNUE_L2 * 2 * NNUE_HIDDEN)
+           && readArray(in, l2Biases, NNUE_L3)
+           && readArray(in, l2Weights, (size_t)NNUE_L3 * NNUE_L2)
+           && in.read(reinterpret_cast<char*>(&outBias), sizeof(outBias))
+           && readArray(in, outWeights, NNUE_L3);
+    // Trailing bytes mean the file was written for another layout.
+    if (!ok || in.peek() != std::char_traits<char>::eof()) {
+        clear();
+        return false;
+    }
+    loaded = true;
+    return true;
+}
+
+void NNUE_NETWORK::clear() {
+    loaded = false;
+    ftBiases.clear();
+    ftWeights.clear();
+    l1Biases.clear();
+    l1Weights.clear();
+    l2Biases.clear();
+    l2Weights.clear();
+    outBias = 0;
+    outWeights.clear();
+}
+
+void NNUE_NETWORK::refresh(const std::vector<short>& state, int side, NnueAccumulator& accumulator) const {
+    short king = (side == 0) ? 127 : -127;
+    int kingSquare = 0;
+    for (int square = 0; square < 64; square++) {
+        if (state[square] == king) {
+            kingSquare = square;
+            break;
+        }
+    }
+    int active[64];
+    int count = 0;
+    for (int square = 0; square < 64; square++) {
+        if (pieceKind(state[square]) >= 0)
+            active[count++] = featureIndex(side, kingSquare, state[square], square);
+    }
+    KERNELS[activeKernel].update(ftBiases.data(), accumulator.values[side], ftWeights.data(), active, count, nullptr, 0);
+    accumulator.kingSquare[side] = (short)kingSquare;
+    accumulator.computed[side] = true;
+}
+
+void NNUE_NETWORK::update(const std::vector<short>& parentState, const NnueAccumulator& parent,
+                          const std::vector<short>& childState, int side, NnueAccumulator& child) const {
+    int kingSquare = parent.kingSquare[side];
+    if (childState[kingSquare] != parentState[kingSquare]) {
+        // Every feature depends on the own king's square.
+        refresh(childState, side, child);
+        return;
+    }
+    // A move changes at most four squares (castling); the pieces leaving or reaching them
+    // are the features that change.
+    int added[4], removed[4];
+    int addedCount = 0, removedCount = 0;
+    for (int square = 0; square < 64; square++) {
+        short before = parentState[square], after = childState[square];
+        if (before == after)
+            continue;
+        if (pieceKind(before) >= 0)
+            removed[removedCount++] = featureIndex(side, kingSquare, before, square);
+        if (pieceKind(after) >= 0)
+            added[addedCount++] = featureIndex(side, kingSquare, after, square);
+    }
+    KERNELS[activeKernel].update(parent.values[side], child.values[side], ftWeights.data(),
+                                 added, addedCount, removed, removedCount);
+    child.kingSquare[side] = (short)kingSquare;
+    child.computed[side] = true;
+}
+
+int NNUE_NETWORK::evaluate(const std::vector<short>& state, const NnueAccumulator& accumulator) const {
+    const KernelSet& kernels = KERNELS[activeKernel];
+    int us = state[TURN_INDEX] > 0 ? 0 : 1;
+    uint8_t input[2 * NNUE_HIDDEN];
+    kernels.clip(accumulator.values[us], input, NNUE_HIDDEN);
+    kernels.clip(accumulator.values[1 - us], input + NNUE_HIDDEN, NNUE_HIDDEN);
+
+    // Shared by both hidden layers, so it holds the wider one.
+    int32_t sums[NNUE_L2 > NNUE_L3 ? NNUE_L2 : NNUE_L3];
+    uint8_t hidden1[NNUE_L2];
+    kernels.affine(input, 2 * NNUE_HIDDEN, l1Weights.data(), l1Biases.data(), sums, NNUE_L2);
+    for (int i = 0; i < NNUE_L2; i++)
+        hidden1[i] = (uint8_t)std::max(0, std::min(sums[i] >> NNUE_WEIGHT_SHIFT, 127));
+
+    uint8_t hidden2[NNUE_L3];
+    kernels.affine(hidden1, NNUE_L2, l2Weights.data(), l2Biases.data(), sums, NNUE_L3);
+    for (int i = 0; i < NNUE_L3; i++)
+        hidden2[i] = (uint8_t)std::max(0, std::min(sums[i] >> NNUE_WEIGHT_SHIFT, 127));
+
+    int32_t output = outBias;
+    for (int i = 0; i < NNUE_L3; i++)
+        output += (int32_t)hidden2[i] * outWeights[i];
+    // Keep network scores below the range of known wins and mates.
+    return std::max(-(KNOWN_WIN - 1), std::min(output / NNUE_OUTPUT_SCALE, KNOWN_WIN - 1));
+}
+
+int NNUE_NETWORK::evaluate(const std::vector<short>& state) const {
+    NnueAccumulator accumulator;
+    refresh(state, 0, accumulator);
+    refresh(state, 1, accumulator);
+    return evaluate(state, accumulator);
+}
@@ -0,0 +1,107 @@
+// nnue.h
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ------------------ Neural Network Evaluation (NNUE) ------------------
+// An efficiently updatable network in the HalfKP style. Every input feature is one
+// (own king square, piece, square) triple seen from one side: the kings themselves are not
+// features, and only the pieces that moved change the active set, so the first layer's
+// output (the accumulator) is updated from the parent position's with a few row additions
+// and subtractions instead of being recomputed. Only a move of that side's own king forces a
+// refresh of its half.
+//
+// Layers (quantised integers, as stored in the file):
+//   feature transformer  NNUE_INPUTS -> NNUE_HIDDEN per side      int16 weights and biases
+//   hidden layer 1       2 * NNUE_HIDDEN -> NNUE_L2               int8 weights, int32 biases
+//   hidden layer 2       NNUE_L2 -> NNUE_L3                       int8 weights, int32 biases
+//   output               NNUE_L3 -> 1                             int8 weights, int32 bias
+// The side to move's half of the accumulator comes first in the input of layer 1. Between
+// layers values are clipped to 0..127 (after a right shift by NNUE_WEIGHT_SHIFT for the
+// hidden layers); the output divided by NNUE_OUTPUT_SCALE is in centipawns for the side to
+// move.
+//
+// Feature index, for the side 'us' (squares as in the state, 0 = a8; Black's are flipped
+// vertically so both sides see their own pieces from the bottom):
+//   king * 640 + (kind * 2 + (piece is ours ? 0 : 1)) * 64 + square
+// where kind is 0 pawn, 1 knight, 2 bishop, 3 rook, 4 queen.
+//
+// Weight file (little-endian): the 8-byte magic, five uint32 (inputs, hidden, l2, l3 and
+// the feature count per king, which must match the constants below), then
+//   int16 ftBiases[NNUE_HIDDEN]    int16 ftWeights[NNUE_INPUTS][NNUE_HIDDEN]
+//   int32 l1Biases[NNUE_L2]        int8  l1Weights[NNUE_L2][2 * NNUE_HIDDEN]
+//   int32 l2Biases[NNUE_L3]        int8  l2Weights[NNUE_L3][NNUE_L2]
+//   int32 outBias                  int8  outWeights[NNUE_L3]
+
+const int NNUE_FEATURES_PER_KING = 10 * 64;
+const int NNUE_INPUTS = 64 * NNUE_FEATURES_PER_KING;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L2 = 32;
+const int NNUE_L3 = 32;
+const int NNUE_WEIGHT_SHIFT = 6;
+const int NNUE_OUTPUT_SCALE = 16;
+const char NNUE_MAGIC[8] = {'T', 'C', 'N', 'N', 'U', 'E', '0', '1'};
+
+// Kernels for the accumulator updates and the dense layers. The best one the CPU supports is
+// chosen when a network is loaded; the others remain available for testing and benchmarks.
+enum NnueKernel { KERNEL_SCALAR, KERNEL_SSSE3, KERNEL_AVX2 };
+
+// First-layer output of one position for both sides (index 0 White, 1 Black), with the king
+// squares it was computed for. A half is only valid while 'computed' is set.
+struct NnueAccumulator {
+    int16_t values[2][NNUE_HIDDEN];
+    short kingSquare[2];
+    bool computed[2];
+
+    NnueAccumulator() { computed[0] = computed[1] = false; kingSquare[0] = kingSquare[1] = -1; }
+};
+
+// NNUE_NETWORK holds the weights of a loaded network. It is read-only once loaded, so all
+// search threads share it without locking.
+class NNUE_NETWORK {
+public:
+    NNUE_NETWORK();
+    NNUE_NETWORK(const NNUE_NETWORK&) = delete;
+    NNUE_NETWORK& operator=(const NNUE_NETWORK&) = delete;
+
+    // Read a weight file; returns false (keeping no network) if it is missing or malformed.
+    bool load(const std::string& path);
+    void clear();
+    bool isLoaded() const { return loaded; }
+
+    // The kernel in use; setKernel() returns false if the CPU does not support the one asked for.
+    NnueKernel kernel() const { return activeKernel; }
+    bool setKernel(NnueKernel requested);
+    static bool kernelSupported(NnueKernel requested);
+    static NnueKernel bestKernel();
+    static const char* kernelName(NnueKernel requested);
+
+    // Compute one side's half of 'accumulator' from scratch.
+    void refresh(const std::vector<short>& state, int side, NnueAccumulator& accumulator) const;
+    // Bring one side's half of 'child' up to date from the computed half of 'parent', the
+    // accumulator of the position the move was played in.
+    void update(const std::vector<short>& parentState, const NnueAccumulator& parent,
+                const std::vector<short>& childState, int side, NnueAccumulator& child) const;
+    // Score in centipawns for the side to move, from an accumulator with both halves computed.
+    int evaluate(const std::vector<short>& state, const NnueAccumulator& accumulator) const;
+    // Refresh and evaluate in one call, for callers outside the search.
+    int evaluate(const std::vector<short>& state) const;
+
+private:
+    bool loaded;
+    NnueKernel activeKernel;
+    std::vector<int16_t> ftBiases;
+    std::vector<int16_t> ftWeights;
+    std::vector<int32_t> l1Biases;
+    std::vector<int8_t> l1Weights;
+    std::vector<int32_t> l2Biases;
+    std::vector<int8_t> l2Weights;
+    int32_t outBias;
+    std::vector<int8_t> outWeights;
+};
+
+#endif // NNUE_H
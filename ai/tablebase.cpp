@@ -0,0 +1,374 @@
+#include "tablebase.h"
+#include "../logic/chesslogic.h"
+#include "../utils/score.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Index layout: the white king's square reduced by symmetry (10 squares of the a1-d1-d4
+// triangle without pawns, 32 squares of files a-d with pawns), then 6 bits per other
+// piece in table order, then the side to move.
+namespace {
+
+char pieceLetter(short code) {
+    switch (std::abs(code)) {
+        case 127: return 'K';
+        case 9:   return 'Q';
+        case 5:   return 'R';
+        case 6:   return 'B';
+        case 3:   return 'N';
+        default:  return 'P';
+    }
+}
+
+short letterCode(char letter) {
+    switch (letter) {
+        case 'K': return 127;
+        case 'Q': return 9;
+        case 'R': return 5;
+        case 'B': return 6;
+        case 'N': return 3;
+        case 'P': return 1;
+        default:  return 0;
+    }
+}
+
+// Order of pieces within one side of a table name.
+int letterRank(short code) {
+    switch (std::abs(code)) {
+        case 127: return 0;
+        case 9:   return 1;
+        case 5:   return 2;
+        case 6:   return 3;
+        case 3:   return 4;
+        default:  return 5;
+    }
+}
+
+int materialValue(short code) {
+    switch (std::abs(code)) {
+        case 9: return 9;
+        case 5: return 5;
+        case 6: case 3: return 3;
+        case 1: return 1;
+        default: return 0;
+    }
+}
+
+// Group used to order pieces: white king, black king, other white pieces, other black pieces.
+int pieceGroup(short code) {
+    if (code == 127) return 0;
+    if (code == -127) return 1;
+    return (code > 0) ? 2 : 3;
+}
+
+// The 10 king squares of the a1-d1-d4 triangle, in index order.
+struct TriangleSquares {
+    short square[10];
+    short index[64];
+
+    TriangleSquares() {
+        int count = 0;
+        for (int sq = 0; sq < 64; sq++) {
+            int x = sq % 8, y = 7 - sq / 8;
+            index[sq] = -1;
+            if (x <= 3 && y <= x) {
+                index[sq] = count;
+                square[count++] = sq;
+            }
+        }
+    }
+};
+
+const TriangleSquares& triangle() {
+    static const TriangleSquares squares;
+    return squares;
+}
+
+// Mirror transform that brings the white king into the indexed region.
+struct Symmetry {
+    bool flipCol, flipRow, transpose;
+    // The king is on the a1-h8 diagonal, where transposing leaves it in the triangle.
+    bool kingOnDiagonal;
+
+    Symmetry(short whiteKing, bool pawns)
+        : flipCol(false), flipRow(false), transpose(false), kingOnDiagonal(false) {
+        int row = whiteKing / 8, col = whiteKing % 8;
+        flipCol = col > 3;
+        if (flipCol)
+            col = 7 - col;
+        if (!pawns) {
+            flipRow = row < 4;
+            if (flipRow)
+                row = 7 - row;
+            transpose = (7 - row) > col;
+            kingOnDiagonal = (7 - row) == col;
+        }
+    }
+
+    short apply(short square) const {
+        int row = square / 8, col = square % 8;
+        if (flipCol)
+            col = 7 - col;
+        if (flipRow)
+            row = 7 - row;
+        if (transpose) {
+            int newRow = 7 - col;
+            col = 7 - row;
+            row = newRow;
+        }
+        return (short)(row * 8 + col);
+    }
+};
+
+// Index of a position whose pieces are listed in table order, under one symmetry.
+// Identical pieces are ordered by square, so every placement has a single index.
+size_t indexUnder(const TbPosition& pos, const int order[], const Symmetry& symmetry, bool pawns) {
+    short squares[TB_MAX_PIECES];
+    for (int i = 0; i < pos.count; i++)
+        squares[i] = symmetry.apply(pos.square[order[i]]);
+    for (int i = 2; i < pos.count; i++) {
+        for (int j = i; j > 2 && pos.piece[order[j]] == pos.piece[order[j - 1]] && squares[j] < squares[j - 1]; j--)
+            std::swap(squares[j], squares[j - 1]);
+    }
+    short whiteKing = squares[0];
+    size_t index = pawns ? (size_t)((whiteKing / 8) * 4 + whiteKing % 8) : (size_t)triangle().index[whiteKing];
+    for (int i = 1; i < pos.count; i++)
+        index = index * 64 + squares[i];
+    return index * 2 + (pos.whiteToMove ? 0 : 1);
+}
+
+bool tableHasPawns(const std::string& table) {
+    return table.find('P') != std::string::npos;
+}
+
+// Insertion sort of the first 'count' items; the piece lists hold at most TB_MAX_PIECES.
+template <typename T, typename Less>
+void sortPieces(T* items, int count, Less less) {
+    for (int i = 1; i < count; i++) {
+        T item = items[i];
+        int j = i;
+        for (; j > 0 && less(item, items[j - 1]); j--)
+            items[j] = items[j - 1];
+        items[j] = item;
+    }
+}
+
+} // namespace
+
+bool tbLocate(const TbPosition& position, std::string& table, size_t& index) {
+    if (position.count > TB_MAX_PIECES || position.count < 2)
+        return false;
+    TbPosition pos = position;
+
+    // The side with more material (or the alphabetically later name) plays White.
+    short whitePieces[TB_MAX_PIECES], blackPieces[TB_MAX_PIECES];
+    int whiteCount = 0, blackCount = 0, whiteValue = 0, blackValue = 0;
+    for (int i = 0; i < pos.count; i++) {
+        if (pos.piece[i] > 0) {
+            whiteValue += materialValue(pos.piece[i]);
+            whitePieces[whiteCount++] = pos.piece[i];
+        } else {
+            blackValue += materialValue(pos.piece[i]);
+            blackPieces[blackCount++] = pos.piece[i];
+        }
+    }
+    auto byRank = [](short a, short b) { return letterRank(a) < letterRank(b); };
+    sortPieces(whitePieces, whiteCount, byRank);
+    sortPieces(blackPieces, blackCount, byRank);
+    std::string white, black;
+    for (int i = 0; i < whiteCount; i++) white += pieceLetter(whitePieces[i]);
+    for (int i = 0; i < blackCount; i++) black += pieceLetter(blackPieces[i]);
+    if (blackValue > whiteValue || (blackValue == whiteValue && black > white)) {
+        for (int i = 0; i < pos.count; i++) {
+            pos.square[i] ^= 56;
+            pos.piece[i] = -pos.piece[i];
+        }
+        pos.whiteToMove = !pos.whiteToMove;
+        std::swap(white, black);
+    }
+    table = white + black;
+
+    // Table order: kings first, then each side's pieces in name order.
+    int order[TB_MAX_PIECES];
+    for (int i = 0; i < pos.count; i++)
+        order[i] = i;
+    sortPieces(order, pos.count, [&pos](int a, int b) {
+        int groupA = pieceGroup(pos.piece[a]), groupB = pieceGroup(pos.piece[b]);
+        if (groupA != groupB)
+            return groupA < groupB;
+        return letterRank(pos.piece[a]) < letterRank(pos.piece[b]);
+    });
+    if (pos.piece[order[0]] != 127 || pos.piece[order[1]] != -127)
+        return false;
+
+    bool pawns = tableHasPawns(table);
+    Symmetry symmetry(pos.square[order[0]], pawns);
+    index = indexUnder(pos, order, symmetry, pawns);
+    if (symmetry.kingOnDiagonal) {
+        // Both reflections keep the king in the triangle; use the smaller index.
+        symmetry.transpose = !symmetry.transpose;
+        index = std::min(index, indexUnder(pos, order, symmetry, pawns));
+    }
+    return true;
+}
+
+size_t tbTableSize(const std::string& table) {
+    size_t size = tableHasPawns(table) ? 32 : 10;
+    for (size_t i = 1; i < table.size(); i++)
+        size *= 64;
+    return size * 2;
+}
+
+bool tbDecode(const std::string& table, size_t index, TbPosition& position) {
+    if (table.size() > (size_t)TB_MAX_PIECES || table.size() < 2 || index >= tbTableSize(table))
+        return false;
+    // Piece codes in table order: white king, black king, white pieces, black pieces.
+    size_t blackStart = table.find('K', 1);
+    if (table[0] != 'K' || blackStart == std::string::npos)
+        return false;
+    std::vector<short> codes;
+    codes.push_back(127);
+    codes.push_back(-127);
+    for (size_t i = 1; i < blackStart; i++)
+        codes.push_back(letterCode(table[i]));
+    for (size_t i = blackStart + 1; i < table.size(); i++)
+        codes.push_back(-letterCode(table[i]));
+
+    position.count = (int)codes.size();
+    position.whiteToMove = (index % 2) == 0;
+    index /= 2;
+    for (int i = position.count - 1; i >= 1; i--) {
+        position.square[i] = (short)(index % 64);
+        index /= 64;
+    }
+    position.square[0] = tableHasPawns(table) ? (short)((index / 4) * 8 + index % 4) : triangle().square[index];
+    for (int i = 0; i < position.count; i++) {
+        position.piece[i] = codes[i];
+        if (std::abs(codes[i]) == 1 && (position.square[i] < 8 || position.square[i] >= 56))
+            return false;
+        for (int j = 0; j < i; j++) {
+            if (position.square[i] == position.square[j])
+                return false;
+        }
+    }
+    return true;
+}
+
+bool tbFromState(const std::vector<short>& state, TbPosition& position) {
+    position.count = 0;
+    for (short sq = 0; sq < 64; sq++) {
+        if (state[sq] == 0)
+            continue;
+        if (position.count == TB_MAX_PIECES)
+            return false;
+        position.square[position.count] = sq;
+        position.piece[position.count] = state[sq];
+        position.count++;
+    }
+    position.whiteToMove = state[TURN_INDEX] > 0;
+    return true;
+}
+
+// -----------------------
+// TABLEBASE Implementation
+// -----------------------
+
+TABLEBASE::TABLEBASE() : largestTable(0) {}
+
+TABLEBASE::~TABLEBASE() {
+    close();
+}
+
+int TABLEBASE::open(const std::string& directory) {
+    close();
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+        return 0;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string file = entry->d_name;
+        if (file.size() <= 3 || file.compare(file.size() - 3, 3, ".tb") != 0)
+            continue;
+        std::string table = file.substr(0, file.size() - 3);
+        std::string path = directory + "/" + file;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        struct stat info;
+        size_t expected = sizeof(TB_MAGIC) + tbTableSize(table);
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size != expected) {
+            ::close(fd);
+            continue;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            continue;
+        Mapping mapping;
+        mapping.data = static_cast<const unsigned char*>(mapped);
+        mapping.size = info.st_size;
+        if (std::memcmp(mapping.data, TB_MAGIC, sizeof(TB_MAGIC)) != 0) {
+            munmap(mapped, mapping.size);
+            continue;
+        }
+        tables[table] = mapping;
+        largestTable = std::max(largestTable, (int)table.size());
+    }
+    closedir(dir);
+    return (int)tables.size();
+}
+
+void TABLEBASE::close() {
+    for (auto& entry : tables)
+        munmap(const_cast<unsigned char*>(entry.second.data), entry.second.size);
+    tables.clear();
+    largestTable = 0;
+}
+
+int TABLEBASE::tableCount() const {
+    return (int)tables.size();
+}
+
+int TABLEBASE::maxPieces() const {
+    return largestTable;
+}
+
+bool TABLEBASE::probe(const std::vector<short>& state, uint8_t& value) const {
+    // Tables have no castling rights and no en passant captures.
+    if (tables.empty() || state[CASTLE_INDEX] != 0 || state[EP_INDEX] != NO_SQUARE)
+        return false;
+    TbPosition position;
+    if (!tbFromState(state, position) || position.count > largestTable)
+        return false;
+    std::string table;
+    size_t index;
+    if (!tbLocate(position, table, index))
+        return false;
+    auto found = tables.find(table);
+    if (found == tables.end())
+        return false;
+    value = found->second.data[sizeof(TB_MAGIC) + index];
+    return true;
+}
+
+bool TABLEBASE::probeScore(const std::vector<short>& state, int ply, int& score) const {
+    uint8_t value;
+    if (!probe(state, value))
+        return false;
+    if (tbIsWin(value)) {
+        int plies = ply + 2 * value - 1;
+        score = (plies < MAX_PLY) ? mateIn(plies) : KNOWN_WIN + 1000 - value;
+    } else if (tbIsLoss(value)) {
+        int moves = value - 128;
+        int plies = ply + 2 * moves;
+        score = (plies < MAX_PLY) ? matedIn(plies) : -(KNOWN_WIN + 1000) + moves;
+    } else {
+        score = 0;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+// tablebase.h
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ------------------ Endgame Tablebases ------------------
+// A table holds one result byte for every placement of a material signature ("KRKP":
+// white king and rook against black king and pawn) and side to move. The bytes encode
+// distance to mate, so they give both the win/draw/loss result and the fastest way to it:
+//   0          draw
+//   1..127     the side to move mates in that many moves
+//   128..255   the side to move is mated after (value - 128) moves
+// Tables are written by chess_tbgen and follow the engine's rules: pawns promote to queens,
+// there is no castling and no en passant.
+
+// Largest number of pieces (kings included) covered by the tables.
+const int TB_MAX_PIECES = 4;
+// Table file layout: magic, then the result bytes.
+const char TB_MAGIC[4] = {'T', 'B', 'D', '1'};
+const uint8_t TB_DRAW = 0;
+
+inline bool tbIsWin(uint8_t value)  { return value > 0 && value < 128; }
+inline bool tbIsLoss(uint8_t value) { return value >= 128; }
+
+// The pieces of a small position.
+struct TbPosition {
+    int count;
+    short square[TB_MAX_PIECES];   // Board indices (0 = a8 ... 63 = h1).
+    short piece[TB_MAX_PIECES];    // Piece codes as in the state vector.
+    bool whiteToMove;
+};
+
+// Locate a position: the table it belongs to and its index there. Colours are swapped if
+// the table lists the other side first, and the board is mirrored into the indexed half or
+// triangle. Every placement has exactly one index. Returns false if the position has
+// more than TB_MAX_PIECES pieces.
+bool tbLocate(const TbPosition& position, std::string& table, size_t& index);
+// Number of entries in a table, and the position stored at an index (false if the index
+// does not describe a placement, e.g. a pawn on the first or last row).
+size_t tbTableSize(const std::string& table);
+bool tbDecode(const std::string& table, size_t index, TbPosition& position);
+// Gather the pieces of a state; false if it has more than TB_MAX_PIECES pieces.
+bool tbFromState(const std::vector<short>& state, TbPosition& position);
+
+// TABLEBASE maps every table file of a directory into memory and answers probes from the
+// search. It is read-only once opened, so all search threads share it without locking.
+class TABLEBASE {
+public:
+    TABLEBASE();
+    ~TABLEBASE();
+    TABLEBASE(const TABLEBASE&) = delete;
+    TABLEBASE& operator=(const TABLEBASE&) = delete;
+
+    // Map all "*.tb" files in 'directory'; returns the number of tables found.
+    int open(const std::string& directory);
+    void close();
+    int tableCount() const;
+    // Largest piece count of any mapped table (0 if none).
+    int maxPieces() const;
+
+    // Result byte of a state, or false if no mapped table covers it.
+    bool probe(const std::vector<short>& state, uint8_t& value) const;
+    // Search score of a state at the given ply (mate scores as in score.h), or false if
+    // no table covers it.
+    bool probeScore(const std::vector<short>& state, int ply, int& score) const;
+
+private:
+    struct Mapping {
+        const unsigned char* data;
+        size_t size;
+    };
+    std::unordered_map<std::string, Mapping> tables;
+    int largestTable;
+};
+
+#endif // TABLEBASE_H
@@ -0,0 +1,112 @@
+#include "transposition.h"
+#include <algorithm>
+
+// The generation sits above the fields packEntryData fills, in bits 42-47.
+namespace {
+
+uint64_t withGeneration(uint64_t data, uint8_t generation) {
+    return data | ((uint64_t)(generation & 63) << 42);
+}
+
+uint8_t unpackGeneration(uint64_t data) { return (uint8_t)((data >> 42) & 63); }
+
+} // namespace
+
+uint64_t packEntryData(int depth, int score, int bound, std::pair<short, short> move) {
+    uint64_t moveBits = 0;
+    if (move.first >= 0 && move.second >= 0)
+        moveBits = (uint64_t)(move.first & 63) | ((uint64_t)(move.second & 63) << 6) | (1ULL << 12);
+    return moveBits
+         | ((uint64_t)(uint16_t)(int16_t)score << 16)
+         | ((uint64_t)(uint8_t)std::max(0, std::min(depth, 255)) << 32)
+         | ((uint64_t)(bound & 3) << 40);
+}
+
+void unpackEntryData(uint64_t data, TTEntry& entry) {
+    if (data & (1ULL << 12))
+        entry.move = std::make_pair((short)(data & 63), (short)((data >> 6) & 63));
+    else
+        entry.move = std::make_pair((short)-1, (short)-1);
+    entry.score = (int16_t)(uint16_t)((data >> 16) & 0xFFFF);
+    entry.depth = entryDataDepth(data);
+    entry.bound = (int)((data >> 40) & 3);
+}
+
+TRANSPOSITION_TABLE::TRANSPOSITION_TABLE(size_t megabytes)
+    : slotCount(0), generation(0)
+{
+    resize(megabytes);
+}
+
+void TRANSPOSITION_TABLE::resize(size_t megabytes) {
+    // Round down to a power of two so a key maps to a slot with a mask.
+    size_t bytes = std::max<size_t>(megabytes, 1) * 1024 * 1024;
+    size_t count = 1;
+    while (count * 2 * sizeof(Slot) <= bytes)
+        count *= 2;
+    slots.reset(new Slot[count]);
+    slotCount = count;
+    clear();
+}
+
+void TRANSPOSITION_TABLE::clear() {
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+    generation.store(0, std::memory_order_relaxed);
+}
+
+void TRANSPOSITION_TABLE::newSearch() {
+    // Only the low six bits are stored, so the counter may simply wrap.
+    generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool TRANSPOSITION_TABLE::probe(uint64_t key, TTEntry& entry) const {
+    const Slot& slot = slots[key & (slotCount - 1)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (data == 0 || (check ^ data) != key)
+        return false;
+    unpackEntryData(data, entry);
+    return true;
+}
+
+void TRANSPOSITION_TABLE::store(uint64_t key, int depth, int score, int bound, std::pair<short, short> move) {
+    Slot& slot = slots[key & (slotCount - 1)];
+    uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+    uint64_t oldKey = slot.check.load(std::memory_order_relaxed) ^ oldData;
+    uint8_t current = generation.load(std::memory_order_relaxed) & 63;
+
+    // Keep a deeper entry of the current search for a different position.
+    if (oldData != 0 && oldKey != key && unpackGeneration(oldData) == current &&
+        entryDataDepth(oldData) > depth + 2)
+        return;
+    // Keep the previous best move when re-storing the same position without one.
+    if (oldKey == key && (move.first < 0 || move.second < 0)) {
+        TTEntry old;
+        unpackEntryData(oldData, old);
+        if (old.move.first >= 0)
+            move = old.move;
+    }
+
+    uint64_t data = withGeneration(packEntryData(depth, score, bound, move), current);
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TRANSPOSITION_TABLE::hashfull() const {
+    size_t sample = std::min<size_t>(1000, slotCount);
+    uint8_t current = generation.load(std::memory_order_relaxed) & 63;
+    int used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        uint64_t data = slots[i].data.load(std::memory_order_relaxed);
+        if (data != 0 && unpackGeneration(data) == current)
+            used++;
+    }
+    return (int)(used * 1000 / sample);
+}
+
+size_t TRANSPOSITION_TABLE::sizeInMegabytes() const {
+    return slotCount * sizeof(Slot) / (1024 * 1024);
+}
@@ -0,0 +1,69 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bound type of a stored score relative to the window it was searched with.
+const int BOUND_NONE  = 0;
+const int BOUND_UPPER = 1;  // Fail-low: the true score is at most 'score'.
+const int BOUND_LOWER = 2;  // Fail-high: the true score is at least 'score'.
+const int BOUND_EXACT = 3;
+
+// Decoded transposition table entry.
+struct TTEntry {
+    std::pair<short, short> move;  // Best move, or {-1, -1} if none was stored.
+    int score;                     // Score in storage form (see scoreToStorage in score.h).
+    int depth;                     // Remaining depth the score was searched to.
+    int bound;                     // One of the BOUND_* values.
+};
+
+// An entry packed into one 64-bit data word, as both TRANSPOSITION_TABLE and ANALYSIS_CACHE
+// store it (in the cache it is part of the file format). The layout (low to high bits):
+//   0-5   move source square      6-11  move destination square   12  move present
+//   16-31 score (int16)           32-39 depth                      40-41 bound
+// Bits 42-63 are zero here; the transposition table keeps its generation in 42-47.
+uint64_t packEntryData(int depth, int score, int bound, std::pair<short, short> move);
+void unpackEntryData(uint64_t data, TTEntry& entry);
+inline int entryDataDepth(uint64_t data) { return (int)((data >> 32) & 0xFF); }
+
+// TRANSPOSITION_TABLE caches search results by Zobrist key. It is shared by all search
+// threads of an engine (or of several engines, see ChessAI::shareTable) without locks:
+// each slot holds the packed data word and the key XOR-ed with it, so a slot torn by a
+// concurrent write simply fails the key check.
+class TRANSPOSITION_TABLE {
+public:
+    explicit TRANSPOSITION_TABLE(size_t megabytes = 16);
+
+    // Reallocate to (at most) the given size in megabytes; clears all entries.
+    void resize(size_t megabytes);
+    // Remove all entries.
+    void clear();
+    // Start a new search: older entries become preferred for replacement.
+    void newSearch();
+
+    // Look up a key; returns false if the position is not stored.
+    bool probe(uint64_t key, TTEntry& entry) const;
+    // Store a search result, replacing the slot's entry if it is stale or shallower.
+    void store(uint64_t key, int depth, int score, int bound, std::pair<short, short> move);
+
+    // Permille of sampled slots filled during the current search (UCI "hashfull").
+    int hashfull() const;
+    size_t sizeInMegabytes() const;
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check;  // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t slotCount;
+    // Atomic because several engines may share one table and start searches concurrently.
+    std::atomic<uint8_t> generation;
+};
+
+#endif // TRANSPOSITION_H
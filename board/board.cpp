@@ -1,4 +1,5 @@
 #include "board.h"
+#include "../logic/chesslogic.h"
 #include <ncurses.h>
 #include <sstream>
 #include <cctype>
@@ -19,11 +20,15 @@ BOARD::BOARD() {
     };
 
     PIECES pieces;
-    width = pieces.colSize * 8;
-    heigth = pieces.rowSize * 8;
-
-    // Initialize ncurses.
-    initscr();
+    squareRows = pieces.rowSize;
+    squareCols = pieces.colSize;
+    width = squareCols * 8;
+    heigth = squareRows * 8;
+    undoButtonArt = pieces.undoButton;
+
+    // Initialize ncurses, unless the caller already did so to create its windows.
+    if (stdscr == NULL)
+        initscr();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
@@ -46,6 +51,7 @@ BOARD::BOARD() {
         init_pair(4, 4, 2);
         init_pair(5, 6, COLOR_BLACK);
         init_pair(6, 7, 3);
+        init_pair(7, COLOR_BLACK, 6);
     } else {
 
         init_pair(1, COLOR_WHITE, COLOR_BLACK);
@@ -54,6 +60,7 @@ BOARD::BOARD() {
         init_pair(4, COLOR_YELLOW, COLOR_BLUE);
         init_pair(5, COLOR_GREEN, COLOR_BLACK);
         init_pair(6, COLOR_RED, COLOR_BLACK);
+        init_pair(7, COLOR_BLACK, COLOR_GREEN);
     }
 
     // Set up the art dictionary.
@@ -66,6 +73,21 @@ BOARD::BOARD() {
         {9,   pieces.queenArt},
         {127, pieces.kingArt}
     };
+
+    // Pre-render every piece in every colour pair, so drawing a square is a plain copy.
+    for (const auto& entry : artDict) {
+        for (short pair = 1; pair < COLOR_PAIR_COUNT; pair++) {
+            std::vector<std::vector<chtype>>& block = glyphCache[entry.first * 8 + pair];
+            for (const std::string& line : entry.second) {
+                std::vector<chtype> cells;
+                for (char c : line)
+                    cells.push_back(static_cast<unsigned char>(c) | COLOR_PAIR(pair));
+                block.push_back(cells);
+            }
+        }
+    }
+
+    invalidate();
 }
 
 BOARD::~BOARD() {
@@ -121,57 +143,84 @@ short BOARD::chooseColorPair(short pieceValue, bool isLightSquare) {
         return (pieceValue > 0) ? 3 : 4;
 }
 
-// Draw the board to the specified window.
-void BOARD::draw(const std::vector<short>& state, WINDOW* win) {
-    PIECES piece;
-    for (short i = 0; i < state.size() - 1; i++) {
-        int colorPair = chooseColorPair(state[i], squareColor[i]);
-        short key = std::abs(state[i]);
-        const std::vector<std::string>& art = artDict[key];
-        int row = getRow(i) * piece.rowSize;
-        int col = getCol(i) * piece.colSize;
-        drawPieceAt(row, col, art, colorPair, win);
-    }
-    wrefresh(win);
+void BOARD::invalidate() {
+    drawnPiece.assign(64, 0);
+    drawnColorPair.assign(64, 0);
+    drawnInfoLines.clear();
+    undoButtonDrawn = false;
+}
+
+const std::vector<std::vector<chtype>>& BOARD::glyph(short pieceValue, short colorPair) {
+    return glyphCache[std::abs(pieceValue) * 8 + colorPair];
 }
 
-void BOARD::drawPieceAt(int startRow, int startCol, const std::vector<std::string>& art, int colorPair, WINDOW* win) {
-    wattron(win, COLOR_PAIR(colorPair));
-    for (size_t i = 0; i < art.size(); i++) {
-        mvwprintw(win, startRow + i, startCol, "%s", art[i].c_str());
+void BOARD::paintSquare(short index, short pieceValue, short colorPair, WINDOW* win) {
+    // Both colours of a piece share one art block, but they use different pairs, so the
+    // pair tells the two apart.
+    if (drawnColorPair[index] == colorPair && std::abs(drawnPiece[index]) == std::abs(pieceValue))
+        return;
+    const std::vector<std::vector<chtype>>& block = glyph(pieceValue, colorPair);
+    int startRow = getRow(index) * squareRows;
+    int startCol = getCol(index) * squareCols;
+    for (size_t i = 0; i < block.size(); i++)
+        mvwaddchnstr(win, startRow + i, startCol, block[i].data(), block[i].size());
+    drawnPiece[index] = pieceValue;
+    drawnColorPair[index] = colorPair;
+}
+
+// Draw the board to the specified window, repainting only the squares that changed.
+void BOARD::draw(const std::vector<short>& state, short highlighted, uint64_t targets, WINDOW* win) {
+    for (short i = 0; i < 64; i++) {
+        short colorPair = (i == highlighted) ? HIGHLIGHT_PAIR
+                        : ((targets >> i) & 1) ? TARGET_PAIR
+                        : chooseColorPair(state[i], squareColor[i]);
+        paintSquare(i, state[i], colorPair, win);
     }
-    wattroff(win, COLOR_PAIR(colorPair));
 }
 
 void BOARD::drawUndoButton(WINDOW* win) {
-    PIECES piece;
-    std::vector<std::string> undoButton = piece.undoButton;
-    int buttonHeight = undoButton.size();
+    if (undoButtonDrawn)
+        return;
+    int buttonHeight = undoButtonArt.size();
     int startRow = heigth - buttonHeight;
     int startCol = width + 1;
     wattron(win, COLOR_PAIR(6));
-    for (size_t i = 0; i < undoButton.size(); i++) {
-        mvwprintw(win, startRow + i, startCol, "%s", undoButton[i].c_str());
+    for (size_t i = 0; i < undoButtonArt.size(); i++) {
+        mvwprintw(win, startRow + i, startCol, "%s", undoButtonArt[i].c_str());
     }
     wattroff(win, COLOR_PAIR(6));
-    wrefresh(win);
+    undoButtonDrawn = true;
 }
 
-void BOARD::drawInfo(const std::vector<MoveInfo>& history, WINDOW* win) {
-    int startRow = 0;
+void BOARD::drawInfo(const PgnGame& record, WINDOW* win) {
+    std::vector<std::string> lines;
+    lines.push_back("Move History:");
+    std::vector<short> start;
+    int moveNumber = 1;
+    bool whiteToMove = true;
+    if (record.startPosition(start, moveNumber))
+        whiteToMove = start[TURN_INDEX] > 0;
+    for (const std::string& move : record.moves) {
+        lines.push_back(std::to_string(moveNumber) + (whiteToMove ? ". " : "... ") + move);
+        if (!whiteToMove)
+            moveNumber++;
+        whiteToMove = !whiteToMove;
+    }
+
+    // Rewrite only the lines that differ; blank out what is left of longer old lines
+    // (after an undo the list also gets shorter).
     int startCol = width + 1;
-    mvwprintw(win, startRow, startCol, "Move History:");
-    startRow++;
-    for (size_t i = 0; i < history.size(); i++) {
-        const auto &info = history[i];
-        std::string sourceNotation = indexToNotation(info.lastMove.first);
-        std::string destNotation = indexToNotation(info.lastMove.second);
-        std::string pieceSymbol = pieceCodeToSymbol(info.movedPiece);
-        std::string separator = (info.capturedPiece != 0) ? "x" : "-";
-        std::string moveStr = std::to_string(i + 1) + ". " + pieceSymbol + " " + sourceNotation + separator + destNotation;
-        mvwprintw(win, startRow + i, startCol, "%s", moveStr.c_str());
+    size_t count = std::max(lines.size(), drawnInfoLines.size());
+    for (size_t i = 0; i < count; i++) {
+        std::string line = (i < lines.size()) ? lines[i] : "";
+        std::string old = (i < drawnInfoLines.size()) ? drawnInfoLines[i] : "";
+        if (line == old)
+            continue;
+        if (line.size() < old.size())
+            line.append(old.size() - line.size(), ' ');
+        mvwprintw(win, i, startCol, "%s", line.c_str());
     }
-    wrefresh(win);
+    drawnInfoLines = lines;
 }
 
 bool BOARD::clickInside(short colNum, short rowNum) {
@@ -181,26 +230,16 @@ bool BOARD::clickInside(short colNum, short rowNum) {
 short BOARD::getClickedPieceIndex(const std::vector<short>& state, short colNum, short rowNum) {
     // Convert pixel/character coordinates to board index.
     // (You may need to adjust these divisors based on your drawing dimensions.)
-    short col = colNum / 11;
-    short row = rowNum / 6;
+    short col = colNum / squareCols;
+    short row = rowNum / squareRows;
     return row * 8 + col;
 }
 
 bool BOARD::clickUndoButton(short colNum, short rowNum) {
-    PIECES pieces;
-    std::vector<std::string> undoButton = pieces.undoButton;
-    int buttonHeight = undoButton.size();
-    int buttonWidth = undoButton[0].size();
+    int buttonHeight = undoButtonArt.size();
+    int buttonWidth = undoButtonArt[0].size();
     int startRow = heigth - buttonHeight;
     int startCol = width + 1;
     return (colNum >= startCol && colNum < startCol + buttonWidth &&
             rowNum >= startRow && rowNum < startRow + buttonHeight);
-}
-
-void BOARD::highlight(const std::vector<short>& state, short index, WINDOW* win) {
-    short key = std::abs(state[index]);
-    const std::vector<std::string>& art = artDict[key];
-    // For highlighting, we use color pair 5.
-    drawPieceAt(getRow(index) * 6, getCol(index) * 11, art, 5, win);
-    wrefresh(win);
 }
\ No newline at end of file
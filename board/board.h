@@ -3,9 +3,10 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <unordered_map>
 #include "../pieces/pieces.h"
-#include "../utils/moveinfo.h"
+#include "../logic/pgn.h"
 #include <ncurses.h>
 
 struct BOARD {
@@ -14,6 +15,9 @@ struct BOARD {
     short width;    // In character columns.
     short heigth;   // In character rows.
     std::unordered_map<short, std::vector<std::string>> artDict;
+    std::vector<std::string> undoButtonArt;
+    short squareRows;   // Size of one square in character rows.
+    short squareCols;   // Size of one square in character columns.
 
     BOARD();
     ~BOARD();
@@ -25,29 +29,49 @@ struct BOARD {
     std::string pieceCodeToSymbol(short code);
 
     // Drawing functions: versions that accept a WINDOW* so that output goes to that window.
-    void draw(const std::vector<short>& state, WINDOW* win);
-    void drawPieceAt(int startRow, int startCol, const std::vector<std::string>& art, int colorPair, WINDOW* win);
-    void drawInfo(const std::vector<MoveInfo>& history, WINDOW* win);
+    // They only repaint what changed since the previous call and leave the wrefresh to the
+    // caller, so one frame costs a single refresh however many parts of it were touched.
+    // 'highlighted' is the selected square, or -1 for none; 'targets' marks the squares it can
+    // move to (bit i set = square i).
+    void draw(const std::vector<short>& state, short highlighted, uint64_t targets, WINDOW* win);
+    // The move list is shown in SAN, one numbered move per line.
+    void drawInfo(const PgnGame& record, WINDOW* win);
     void drawUndoButton(WINDOW* win);
+    // Forget what is on screen so the next draw repaints everything (after a clear or resize).
+    void invalidate();
 
     // Input helpers.
     bool clickInside(short colNum, short rowNum);
     short getClickedPieceIndex(const std::vector<short>& state, short colNum, short rowNum);
-    void highlight(const std::vector<short>& state, short index, WINDOW* win);
     bool clickUndoButton(short colNum, short rowNum);
 
     // Color helper.
     short chooseColorPair(short pieceValue, bool isLightSquare);
 
-
-
-
-
-
     void testDraw(WINDOW* win) {
         mvwprintw(win, 1, 1, "Test: Board drawing works!");
         wrefresh(win);
     }
+
+private:
+    // Colour pair used for the selected square.
+    static const short HIGHLIGHT_PAIR = 5;
+    // Colour pair used for the legal destinations of the selected piece.
+    static const short TARGET_PAIR = 7;
+    static const short COLOR_PAIR_COUNT = 8;
+
+    // Paint one square unless it already shows this piece in this colour.
+    void paintSquare(short index, short pieceValue, short colorPair, WINDOW* win);
+    // Coloured art for a piece code (absolute value) and colour pair, built once at startup.
+    const std::vector<std::vector<chtype>>& glyph(short pieceValue, short colorPair);
+
+    std::unordered_map<int, std::vector<std::vector<chtype>>> glyphCache;
+
+    // What the window currently shows. A colour pair of 0 marks a square as unknown.
+    std::vector<short> drawnPiece;
+    std::vector<short> drawnColorPair;
+    std::vector<std::string> drawnInfoLines;
+    bool undoButtonDrawn;
 };
 
 #endif // BOARD_H
\ No newline at end of file
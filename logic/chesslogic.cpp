@@ -1,18 +1,14 @@
 // This file implements the CHESSLOGIC class, which encapsulates the game state,
 // move execution (including special moves such as en passant, castling, and promotion),
 // move validation (including checking for checks and checkmate), and raw move generation.
-// Detailed debug messages are output to std::cout when moves are invalid.
 
 #include "chesslogic.h"
-#include "../utils/globals.h"
+#include "notation.h"
+#include "zobrist.h"
 #include <cstdlib>
 #include <cmath>
-#include <iostream>
-#include <sstream>
 #include <limits>
-
-//global pointer to the logic instance running the game
-CHESSLOGIC* chessLogicPtr = nullptr;
+#include <algorithm>
 
 // Stub for check: In a full implementation, this would determine whether a move creates a check.
 // For now, it always returns false for demonstration.
@@ -25,9 +21,11 @@ bool check(const std::vector<short>& state, short from, short to) {
 // ------------------------
 
 CHESSLOGIC::CHESSLOGIC() {
-    // Initialize game state with 65 elements:
+    // Initialize game state with STATE_SIZE elements:
     // indices 0-63 represent board squares,
-    // index 64 is the turn indicator (+1 for white, -1 for black).
+    // index 64 is the turn indicator (+1 for white, -1 for black),
+    // index 65 holds the castling rights (all four available at the start),
+    // index 66 the en passant square and index 67 the halfmove clock.
     gameState = {
         -5, -3, -6, -9, -127, -6, -3, -5,
         -1, -1, -1, -1, -1, -1, -1, -1,
@@ -37,26 +35,20 @@ CHESSLOGIC::CHESSLOGIC() {
          0,  0,  0,  0,  0,  0,  0,  0,
          1,  1,  1,  1,  1,  1,  1,  1,
          5,  3,  6,  9, 127,  6,  3,  5,
-         1   // Turn indicator: white's turn.
+         1,  // Turn indicator: white's turn.
+        CASTLE_WHITE | CASTLE_BLACK,
+        NO_SQUARE,
+        0
     };
-
-    chessLogicPtr = this;
+    startFullmove = 1;
 
     // Set fixed starting king positions.
     kingBlackPos = 4;   // Black king starts at index 4.
     kingWhitePos = 60;  // White king starts at index 60.
+    positionKeys.assign(1, zobristHash(gameState));
 
-    // Initialize checkmate flag and clear valid moves.
-    checkMateFlag = false;
-    allValidMoves.clear();
-
-    // Set up mapping from piece code to its move function using lambdas.
-    moveFunctions[1]   = [this](std::pair<short, short> moveIndex) { this->movePawn(moveIndex); };
-    moveFunctions[3]   = [this](std::pair<short, short> moveIndex) { this->moveKnight(moveIndex); };
-    moveFunctions[5]   = [this](std::pair<short, short> moveIndex) { this->moveRook(moveIndex); };
-    moveFunctions[6]   = [this](std::pair<short, short> moveIndex) { this->moveBishop(moveIndex); };
-    moveFunctions[9]   = [this](std::pair<short, short> moveIndex) { this->moveQueen(moveIndex); };
-    moveFunctions[127] = [this](std::pair<short, short> moveIndex) { this->moveKing(moveIndex); };
+    // Index the legal moves of the starting position (this also sets the checkmate flag).
+    refreshLegalMoves();
 }
 
 const std::vector<short>& CHESSLOGIC::getState() const {
@@ -71,90 +63,41 @@ void CHESSLOGIC::changeTurn() {
     gameState[64] *= -1;
 }
 
-// ---------------- Coordinate Helpers ----------------
-// Returns the column (0–7) for a given board index.
-short CHESSLOGIC::getCol(short index) {
-    return index % 8;
-}
-
-// Returns the row (0–7) for a given board index.
-short CHESSLOGIC::getRow(short index) {
-    for (short k = 1; k <= 8; k++) {
-        if (index < 8 * k)
-            return k - 1;
-    }
-    return 7; //
-}
-
-// ---------------- Sliding Helpers ----------------
-// For rook-like moves (horizontal/vertical sliding).
-bool CHESSLOGIC::attemptSlideRook(short start, short target, short delta) {
-    short current = start;
-    while (true) {
-        // Prevent horizontal wrap-around.
-        if ((delta == 1 && (current % 8) == 7) || (delta == -1 && (current % 8) == 0))
-            break;
-        short next = current + delta;
-        if (next < 0 || next >= 64)
-            break;
-        if (next == target)
-            return true;
-        if (gameState[next] != 0)
-            break;
-        current = next;
-    }
-    return false;
+bool CHESSLOGIC::setFen(const std::string& fen) {
+    std::vector<short> state;
+    int fullmove;
+    if (!parseFen(fen, state, fullmove))
+        return false;
+    gameState = state;
+    startFullmove = fullmove;
+    kingWhitePos = getKingPositionInState(gameState, true);
+    kingBlackPos = getKingPositionInState(gameState, false);
+    undoStack.clear();
+    positionKeys.assign(1, zobristHash(gameState));
+    refreshLegalMoves();
+    return true;
 }
 
-// For bishop-like moves (diagonal sliding).
-bool CHESSLOGIC::attemptSlideDiagonal(short start, short target, short delta) {
-    short current = start;
-    while (true) {
-        short curRow = getRow(current);
-        short curCol = getCol(current);
-        short next = current + delta;
-        if (next < 0 || next >= 64)
-            break;
-        short nextRow = getRow(next);
-        short nextCol = getCol(next);
-        // Ensure the move is exactly one diagonal step.
-        if (std::abs(nextRow - curRow) != 1 || std::abs(nextCol - curCol) != 1)
-            break;
-        if (next == target)
-            return true;
-        if (gameState[next] != 0)
-            break;
-        current = next;
-    }
-    return false;
+std::string CHESSLOGIC::getFen() const {
+    return stateToFen(gameState, fullmoveNumber());
 }
 
-// ---------------- Move Validity Helpers ----------------
-bool CHESSLOGIC::playerMovingEmptySquare(short sourceIndex) {
-    return (gameState[sourceIndex] == 0);
+int CHESSLOGIC::fullmoveNumber() const {
+    // Count plies from White's turn of the starting move.
+    const std::vector<short>& start = undoStack.empty() ? gameState : undoStack.front().priorGameState;
+    size_t plies = undoStack.size() + (start[TURN_INDEX] < 0 ? 1 : 0);
+    return startFullmove + (int)(plies / 2);
 }
 
-bool CHESSLOGIC::playerCaptureOwnPiece(short sourceIndex, short destIndex) {
-    return ((gameState[sourceIndex] < 0 && gameState[destIndex] < 0) ||
-            (gameState[sourceIndex] > 0 && gameState[destIndex] > 0));
+bool CHESSLOGIC::whiteCanCastle() const {
+    return (gameState[CASTLE_INDEX] & CASTLE_WHITE) != 0;
 }
 
-bool CHESSLOGIC::isMovePrelimValid(std::pair<short, short> moveIndex) {
-    if (playerMovingEmptySquare(moveIndex.first)) {
-        // std::cout << "Invalid move: Source square is empty.\n";
-        return false;
-    }
-    if (playerMovingEnemyPiece(moveIndex.first, turnToMove())) {
-        // std::cout << "Invalid move: Trying to move enemy piece.\n";
-        return false;
-    }
-    if (playerCaptureOwnPiece(moveIndex.first, moveIndex.second)) {
-        // std::cout << "Invalid move: Cannot capture your own piece.\n";
-        return false;
-    }
-    return true;
+bool CHESSLOGIC::blackCanCastle() const {
+    return (gameState[CASTLE_INDEX] & CASTLE_BLACK) != 0;
 }
 
+// ---------------- Move Validity Helpers ----------------
 bool CHESSLOGIC::playerMovingEnemyPiece(short sourceIndex, short playerTurn) {
     // Return true if the piece at sourceIndex does NOT belong to the player whose turn it is.
     return !((gameState[sourceIndex] < 0 && playerTurn < 0) ||
@@ -169,56 +112,47 @@ void CHESSLOGIC::saveLastMove(std::pair<short, short> moveIndex) {
     info.lastMove = moveIndex;
     info.lastKingWhitePos = kingWhitePos;
     info.lastKingBlackPos = kingBlackPos;
-    info.whiteCanCastle = whiteCanCastle; // Save castling rights.
-    info.blackCanCastle = blackCanCastle;
     info.movedPiece = gameState[moveIndex.first];
     info.capturedPiece = gameState[moveIndex.second];
     undoStack.push_back(info);
 }
 
-// Executes a validated move: saves state, updates the board, toggles turn,
-// and then updates valid moves and the checkmate flag using generateAllValidMoves().
+// Executes a legal move: saves state, plays the move exactly as the search does (castling
+// rook, en passant capture, promotion, rights, clock and turn) and indexes the legal moves
+// of the new position.
 void CHESSLOGIC::executeMove(std::pair<short, short> moveIndex) {
     // Save the current state including castling rights.
     saveLastMove(moveIndex);
+    short piece = gameState[moveIndex.first];
+    if (std::abs(piece) == 127)
+        updateKingPosition(moveIndex.second, piece > 0);
+    applyMove(gameState, moveIndex);
+    positionKeys.push_back(zobristHash(gameState));
+    refreshLegalMoves();
+}
 
-    // Determine if this move is a castling move.
-    bool isCastlingMove = (std::abs(moveIndex.second - moveIndex.first) == 2);
-
-    // If it's not a castling move, update castling rights.
-    if (!isCastlingMove) {
-        // For white: if the king moves from its starting square (60) or a rook moves from 63 or 56.
-        if ((moveIndex.first == 60 && gameState[60] == 127) ||
-            (moveIndex.first == 63 && gameState[63] == 5) ||
-            (moveIndex.first == 56 && gameState[56] == 5)) {
-            whiteCanCastle = false;
-        }
-        // For black: if the king moves from its starting square (4) or a rook moves from 7 or 0.
-        if ((moveIndex.first == 4 && gameState[4] == -127) ||
-            (moveIndex.first == 7 && gameState[7] == -5) ||
-            (moveIndex.first == 0 && gameState[0] == -5)) {
-            blackCanCastle = false;
-        }
-    }
-
-    // Now execute the move.
-    gameState[moveIndex.second] = gameState[moveIndex.first];
-    gameState[moveIndex.first] = 0;
-    changeTurn();
-    allValidMoves = generateAllValidMoves(gameState);
+// ---------------- Legal-move Index ----------------
+// Regenerates the legal moves of the current position and files each one under its source
+// square as a destination bit, so validating a move is a single lookup.
+void CHESSLOGIC::refreshLegalMoves() {
+    generateAllValidMoves(gameState, allValidMoves);
+    std::fill(destinationMasks, destinationMasks + 64, 0);
+    for (const auto &legal : allValidMoves)
+        destinationMasks[legal.first] |= uint64_t(1) << legal.second;
     checkMateFlag = allValidMoves.empty();
 }
 
-// ---------------- King Helpers ----------------
-// Returns true if the kings at pos1 and pos2 are adjacent.
-bool CHESSLOGIC::kingsAreAdjacent(short pos1, short pos2) {
-    short row1 = getRow(pos1);
-    short col1 = getCol(pos1);
-    short row2 = getRow(pos2);
-    short col2 = getCol(pos2);
-    return (std::abs(row1 - row2) <= 1 && std::abs(col1 - col2) <= 1);
+bool CHESSLOGIC::isLegalMove(std::pair<short, short> moveIndex) const {
+    if (moveIndex.first < 0 || moveIndex.first >= 64 || moveIndex.second < 0 || moveIndex.second >= 64)
+        return false;
+    return (destinationMasks[moveIndex.first] >> moveIndex.second) & 1;
+}
+
+uint64_t CHESSLOGIC::legalDestinations(short square) const {
+    return (square >= 0 && square < 64) ? destinationMasks[square] : 0;
 }
 
+// ---------------- King Helpers ----------------
 // Updates the stored king position for the given side.
 void CHESSLOGIC::updateKingPosition(short newPos, bool isWhite) {
     if (isWhite)
@@ -227,293 +161,13 @@ void CHESSLOGIC::updateKingPosition(short newPos, bool isWhite) {
         kingBlackPos = newPos;
 }
 
-// ---------------- Piece-specific Move Functions ----------------
-
-// Pawn move function with en passant and promotion.
-void CHESSLOGIC::movePawn(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    bool isWhite = (gameState[moveIndex.first] > 0);
-    short source = moveIndex.first;
-    short target = moveIndex.second;
-    //short row = getRow(source);
-    short col = getCol(source);
-    std::vector<short> candidates;
-    int forwardDir = isWhite ? -8 : 8;
-    int startRow = isWhite ? 6 : 1;
-
-    // Normal one-step forward move.
-    short oneStep = source + forwardDir;
-    if (oneStep >= 0 && oneStep < 64 && gameState[oneStep] == 0)
-        candidates.push_back(oneStep);
-
-    // Two-step move from starting row.
-    if (getRow(source) == startRow && gameState[oneStep] == 0) {
-        short twoStep = source + (forwardDir * 2);
-        if (twoStep >= 0 && twoStep < 64 && gameState[twoStep] == 0)
-            candidates.push_back(twoStep);
-    }
-
-    // Diagonal capture moves.
-    int captureLeft = isWhite ? -9 : 7;
-    int captureRight = isWhite ? -7 : 9;
-    if (col > 0) {
-        short capLeft = source + captureLeft;
-        if (capLeft >= 0 && capLeft < 64 &&
-            gameState[capLeft] != 0 &&
-            ((isWhite && gameState[capLeft] < 0) || (!isWhite && gameState[capLeft] > 0)))
-            candidates.push_back(capLeft);
-    }
-    if (col < 7) {
-        short capRight = source + captureRight;
-        if (capRight >= 0 && capRight < 64 &&
-            gameState[capRight] != 0 &&
-            ((isWhite && gameState[capRight] < 0) || (!isWhite && gameState[capRight] > 0)))
-            candidates.push_back(capRight);
-    }
-
-    // Check if any normal candidate move matches the target.
-    for (short cand : candidates) {
-        if (cand == target) {
-            if (checkAfterMove(gameState, {source, target})) {
-                // Move leaves king in check; do nothing.
-            } else {
-                executeMove({source, target});
-                // Promotion: For white, if pawn reaches row 0; for black, if pawn reaches row 7.
-                if (isWhite && getRow(target) == 0)
-                    gameState[target] = 9;    // Promote to white queen.
-                if (!isWhite && getRow(target) == 7)
-                    gameState[target] = -9;   // Promote to black queen.
-            }
-            return;
-        }
-    }
-
-    // --- En Passant Logic ---
-    // En passant is available when a pawn moves diagonally into an empty square.
-    if (gameState[target] == 0 && std::abs(getCol(target) - col) == 1) {
-        if (isWhite && getRow(source) == 3) { // White pawn eligible.
-            if (!undoStack.empty()) {
-                MoveInfo lastInfo = undoStack.back();
-                if (std::abs(lastInfo.movedPiece) == 1 && lastInfo.movedPiece < 0) {
-                    int lastSourceRow = getRow(lastInfo.lastMove.first);
-                    int lastTargetRow = getRow(lastInfo.lastMove.second);
-                    if (lastSourceRow == 1 && lastTargetRow == 3 &&
-                        std::abs(getCol(lastInfo.lastMove.second) - getCol(source)) == 1) {
-                        // En passant valid: remove enemy pawn.
-                        gameState[lastInfo.lastMove.second] = 0;
-                        if (!checkAfterMove(gameState, {source, target})) {
-                            executeMove({source, target});
-                        }
-                        return;
-                    }
-                }
-            }
-        }
-        if (!isWhite && getRow(source) == 4) { // Black pawn eligible.
-            if (!undoStack.empty()) {
-                MoveInfo lastInfo = undoStack.back();
-                if (std::abs(lastInfo.movedPiece) == 1 && lastInfo.movedPiece > 0) {
-                    int lastSourceRow = getRow(lastInfo.lastMove.first);
-                    int lastTargetRow = getRow(lastInfo.lastMove.second);
-                    if (lastSourceRow == 6 && lastTargetRow == 4 &&
-                        std::abs(getCol(lastInfo.lastMove.second) - getCol(source)) == 1) {
-                        gameState[lastInfo.lastMove.second] = 0;
-                        if (!checkAfterMove(gameState, {source, target})) {
-                            executeMove({source, target});
-                        }
-                        return;
-                    }
-                }
-            }
-        }
-    }
-    // If no candidate move is valid, do nothing.
-}
-
-// Knight move function.
-void CHESSLOGIC::moveKnight(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    short col = getCol(moveIndex.first);
-    short row = getRow(moveIndex.first);
-    short moveDiff = moveIndex.second - moveIndex.first;
-    struct KnightMove { short offset; short dCol; short dRow; };
-    KnightMove knightMoves[] = {
-        { -6,  +2, -1 },
-        {  6,  -2, +1 },
-        { -10, -2, -1 },
-        {  10, +2, +1 },
-        { -15, +1, -2 },
-        {  15, -1, +2 },
-        { -17, -1, -2 },
-        {  17, +1, +2 }
-    };
-    for (const auto &km : knightMoves) {
-        if (moveDiff == km.offset) {
-            if ((col + km.dCol >= 0) && (col + km.dCol < 8) &&
-                (row + km.dRow >= 0) && (row + km.dRow < 8)) {
-                if (!checkAfterMove(gameState, moveIndex)) {
-                    executeMove(moveIndex);
-                }
-                return;
-            }
-        }
-    }
-}
-
-// Rook move function.
-void CHESSLOGIC::moveRook(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    const short directions[4] = { -8, +8, +1, -1 };
-    for (int d = 0; d < 4; d++) {
-        if (attemptSlideRook(moveIndex.first, moveIndex.second, directions[d])) {
-            if (!checkAfterMove(gameState, moveIndex)) {
-                executeMove(moveIndex);
-            }
-            return;
-        }
-    }
-}
-
-// Bishop move function.
-void CHESSLOGIC::moveBishop(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    const short diagonalDeltas[4] = { -9, -7, +7, +9 };
-    for (int d = 0; d < 4; d++) {
-        if (attemptSlideDiagonal(moveIndex.first, moveIndex.second, diagonalDeltas[d])) {
-            if (!checkAfterMove(gameState, moveIndex)) {
-                executeMove(moveIndex);
-            }
-            return;
-        }
-    }
-}
-
-// Queen move function.
-void CHESSLOGIC::moveQueen(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    const short allDeltas[8] = { -8, +8, +1, -1, -9, -7, +7, +9 };
-    for (int d = 0; d < 8; d++) {
-        bool valid = false;
-        if (d < 4)
-            valid = attemptSlideRook(moveIndex.first, moveIndex.second, allDeltas[d]);
-        else
-            valid = attemptSlideDiagonal(moveIndex.first, moveIndex.second, allDeltas[d]);
-        if (valid) {
-            if (!checkAfterMove(gameState, moveIndex)) {
-                executeMove(moveIndex);
-            }
-            return;
-        }
-    }
-}
-
-// King move function with castling support.
-void CHESSLOGIC::moveKing(std::pair<short, short> moveIndex) {
-    if (!isMovePrelimValid(moveIndex))
-        return;
-    if (moveIndex.second < 0 || moveIndex.second >= 64)
-        return;
-
-    // Determine if this is a castling move (king moving two squares horizontally).
-    bool isCastle = (std::abs(moveIndex.second - moveIndex.first) == 2);
-    if (isCastle) {
-        // --- CASTLING LOGIC ---
-        bool kingside = (moveIndex.second > moveIndex.first);
-        bool isWhite = (gameState[moveIndex.first] > 0);
-        // Expected rook starting index:
-        // White: kingside at 63, queenside at 56; Black: kingside at 7, queenside at 0.
-        short rookIndex = isWhite ? (kingside ? 63 : 56) : (kingside ? 7 : 0);
-
-        // 1. Verify that the allied rook is still in its original position.
-        if ((isWhite && gameState[rookIndex] != 5) ||
-            (!isWhite && gameState[rookIndex] != -5)) {
-            return;
-        }
-
-        // 2. Check that all squares between the king and rook are empty.
-        std::vector<short> betweenSquares;
-        if (isWhite) {
-            betweenSquares = kingside ? std::vector<short>{61, 62} : std::vector<short>{57, 58, 59};
-        } else {
-            betweenSquares = kingside ? std::vector<short>{5, 6} : std::vector<short>{1, 2, 3};
-        }
-        for (short sq : betweenSquares) {
-            if (gameState[sq] != 0)
-                return;
-        }
-
-        // 3. Verify that neither the king nor the involved rook has moved before.
-        for (const auto &info : undoStack) {
-            if (info.lastMove.first == moveIndex.first || info.lastMove.first == rookIndex) {
-                return;
-            }
-        }
-
-        // 4. Check that the king is not in check on its current square,
-        // does not pass through check, and does not end in check.
-        short passingSquare = isWhite ? (kingside ? 61 : 59) : (kingside ? 5 : 3);
-        if (checkAfterMove(gameState, {moveIndex.first, moveIndex.first}))
-            return;
-        if (checkAfterMove(gameState, {moveIndex.first, passingSquare}))
-            return;
-        if (checkAfterMove(gameState, moveIndex))
-            return;
-
-        // 5. Execute castling: move the king, then the rook.
-        executeMove(moveIndex);
-        updateKingPosition(moveIndex.second, isWhite);
-
-        std::pair<short, short> rookMove;
-        if (isWhite) {
-            rookMove = kingside ? std::make_pair(63, 61) : std::make_pair(56, 59);
-        } else {
-            rookMove = kingside ? std::make_pair(7, 5) : std::make_pair(0, 3);
-        }
-        // Directly execute the rook move without further validation.
-        gameState[rookMove.second] = gameState[rookMove.first];
-        gameState[rookMove.first] = 0;
-        return;
-    } else {
-        // --- Normal King Move ---
-        short srcRow = getRow(moveIndex.first);
-        short srcCol = getCol(moveIndex.first);
-        short destRow = getRow(moveIndex.second);
-        short destCol = getCol(moveIndex.second);
-        if (!(std::abs(destRow - srcRow) <= 1 &&
-              std::abs(destCol - srcCol) <= 1 &&
-              !(destRow == srcRow && destCol == srcCol))) {
-            //std::cout << "King move illegal: King can only move one square.\n";
-            return;
-        }
-        bool isWhite = (gameState[moveIndex.first] > 0);
-        short newKingPos = moveIndex.second;
-        short otherKingPos = isWhite ? kingBlackPos : kingWhitePos;
-        if (kingsAreAdjacent(newKingPos, otherKingPos)) {
-            return;
-        }
-        if (checkAfterMove(gameState, moveIndex)) {
-            return;
-        }
-        executeMove(moveIndex);
-        updateKingPosition(newKingPos, isWhite);
-    }
-}
-
 // ---------------- General Move Function ----------------
-// Looks up and calls the appropriate piece-specific move function.
-void CHESSLOGIC::move(std::pair<short, short> moveIndex) {
-    short pieceCode = std::abs(gameState[moveIndex.first]);
-    auto it = moveFunctions.find(pieceCode);
-    if (it != moveFunctions.end()) {
-        it->second(moveIndex);
-    } else {
-        //
-    }
+// Plays the move if the legal-move index lists it.
+bool CHESSLOGIC::move(std::pair<short, short> moveIndex) {
+    if (!isLegalMove(moveIndex))
+        return false;
+    executeMove(moveIndex);
+    return true;
 }
 
 // ---------------- Undo Function ----------------
@@ -526,8 +180,8 @@ bool CHESSLOGIC::undoMove() {
     gameState = lastInfo.priorGameState;
     kingWhitePos = lastInfo.lastKingWhitePos;
     kingBlackPos = lastInfo.lastKingBlackPos;
-    whiteCanCastle = lastInfo.whiteCanCastle;  // Restore castling rights.
-    blackCanCastle = lastInfo.blackCanCastle;
+    positionKeys.pop_back();
+    refreshLegalMoves();
     return true;
 }
 
@@ -536,322 +190,455 @@ std::vector<MoveInfo> CHESSLOGIC::getMoveHistory() const {
 }
 
 // ---------------- Raw Move Generation Helpers ----------------
+// The generator is written once per colour: every helper below is a template on the side
+// whose pieces move (or attack), so pawn directions, promotion and castling squares and the
+// own/enemy piece tests are compile-time constants. The public functions pick the
+// instantiation once, from the moving piece or the side to move.
 
-// Generates knight moves as {source, destination} pairs.
-std::vector<std::pair<short, short>> CHESSLOGIC::generateKnightMoves(short index, const std::vector<short>& state) {
-    std::vector<std::pair<short, short>> moves;
-    struct KnightMove { short offset; short dCol; short dRow; };
-    KnightMove knightMoves[] = {
-        { -6,  +2, -1 },
-        {  6,  -2, +1 },
-        { -10, -2, -1 },
-        {  10, +2, +1 },
-        { -15, +1, -2 },
-        {  15, -1, +2 },
-        { -17, -1, -2 },
-        {  17, +1, +2 }
-    };
-    short col = index % 8;
+namespace {
+
+const short KNIGHT_OFFSETS[8][2] = { {-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1} };
+const short KING_OFFSETS[8][2]   = { {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+const short ROOK_DELTAS[]   = { -8, +8, +1, -1 };
+const short BISHOP_DELTAS[] = { -9, -7, +7, +9 };
+const short QUEEN_DELTAS[]  = { -8, +8, +1, -1, -9, -7, +7, +9 };
+
+} // namespace
+
+template <Color Us>
+void CHESSLOGIC::addKnightMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    const short sign = colorSign(Us);
     short row = index / 8;
-    for (const auto &km : knightMoves) {
-        short candidate = index + km.offset;
-        if (candidate < 0 || candidate >= 64)
-            continue;
-        short candRow = candidate / 8;
-        short candCol = candidate % 8;
-        // Verify candidate is exactly a knight move away.
-        if (std::abs(candRow - row) == std::abs(km.dRow) &&
-            std::abs(candCol - col) == std::abs(km.dCol)) {
-            if (state[candidate] == 0 ||
-                (state[index] > 0 && state[candidate] < 0) ||
-                (state[index] < 0 && state[candidate] > 0)) {
-                moves.push_back({index, candidate});
-            }
-        }
+    short col = index % 8;
+    for (const auto &step : KNIGHT_OFFSETS) {
+        short r = row + step[0];
+        short c = col + step[1];
+        // Empty squares and enemy pieces (a non-positive product with our sign) can be reached.
+        if (r >= 0 && r < 8 && c >= 0 && c < 8 && state[r * 8 + c] * sign <= 0)
+            moves.push_back({index, (short)(r * 8 + c)});
     }
-    return moves;
 }
 
-// Generates sliding moves (for rook, bishop, queen) using directional deltas.
-std::vector<std::pair<short, short>> CHESSLOGIC::generateSlidingMoves(
-    short index,
-    const std::vector<short>& state,
-    const std::vector<short>& deltas)
-{
-    std::vector<std::pair<short, short>> moves;
-    for (short delta : deltas) {
+template <Color Us>
+void CHESSLOGIC::addSlidingMoves(short index, const std::vector<short>& state, const short* deltas, int deltaCount,
+                                 std::vector<std::pair<short, short>>& moves) {
+    const short sign = colorSign(Us);
+    for (int d = 0; d < deltaCount; d++) {
+        short delta = deltas[d];
+        // Vertical steps keep the column; every other step must change it by exactly one.
+        bool vertical = (delta % 8 == 0);
         short current = index;
         while (true) {
-            // Compute the next square.
             short next = current + delta;
-            // Check board boundaries.
             if (next < 0 || next >= 64)
                 break;
-            // --- Wrapping Checks ---
-            short currentCol = getCol(current);
-            short nextCol = getCol(next);
-            // Vertical moves (multiples of 8) should not change the column.
-            if (delta % 8 == 0) {
-                if (nextCol != currentCol)
-                    break;
-            }
-            // Horizontal moves: ensure exactly one column shift.
-            else if (delta == 1 || delta == -1) {
-                if (std::abs(nextCol - currentCol) != 1)
-                    break;
-            }
-            // Diagonal moves: column must change by exactly 1.
-            else {
-                if (std::abs(nextCol - currentCol) != 1)
-                    break;
-            }
-            // --- End Wrapping Checks ---
-            // If destination square is empty or contains an enemy piece, add the move.
-            if (state[next] == 0 ||
-                (state[index] > 0 && state[next] < 0) ||
-                (state[index] < 0 && state[next] > 0))
-            {
-                moves.push_back({index, next});
-            }
-            // Stop sliding if the square is occupied.
-            if (state[next] != 0)
+            if (vertical ? (next % 8 != current % 8) : (std::abs(next % 8 - current % 8) != 1))
                 break;
+            short target = state[next];
+            if (target * sign > 0)
+                break;              // Own piece.
+            moves.push_back({index, next});
+            if (target != 0)
+                break;              // Capture: the slide ends here.
             current = next;
         }
     }
-    return moves;
 }
 
-// Generates moves for any piece at the given index using appropriate helper functions.
-std::vector<std::pair<short, short>> CHESSLOGIC::generateMovesForPiece(short index, const std::vector<short>& state) {
-    std::vector<std::pair<short, short>> moves;
-    short pieceCode = std::abs(state[index]);
-    switch(pieceCode) {
+template <Color Us>
+void CHESSLOGIC::addPieceMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    const short sign = colorSign(Us);
+    switch (state[index] * sign) {
         case 1: { // Pawn
-            bool isWhite = (state[index] > 0);
-            int forward = isWhite ? -8 : 8;
+            const short forward = (Us == WHITE) ? -8 : 8;
+            const short startRow = (Us == WHITE) ? 6 : 1;
             short oneStep = index + forward;
-            if (oneStep >= 0 && oneStep < 64 && state[oneStep] == 0)
+            if (oneStep < 0 || oneStep >= 64)
+                break;
+            if (state[oneStep] == 0) {
                 moves.push_back({index, oneStep});
-            int startRow = isWhite ? 6 : 1;
-            if (getRow(index) == startRow) {
-                short twoStep = index + (forward * 2);
-                if (oneStep >= 0 && twoStep >= 0 && oneStep < 64 && twoStep < 64 &&
-                    state[oneStep] == 0 && state[twoStep] == 0)
+                short twoStep = oneStep + forward;
+                if (index / 8 == startRow && state[twoStep] == 0)
                     moves.push_back({index, twoStep});
             }
-            int captureLeft = isWhite ? -9 : 7;
-            int captureRight = isWhite ? -7 : 9;
-            if (getCol(index) > 0) {
-                short capLeft = index + captureLeft;
-                if (capLeft >= 0 && capLeft < 64 &&
-                    state[capLeft] != 0 &&
-                    ((isWhite && state[capLeft] < 0) || (!isWhite && state[capLeft] > 0)))
-                    moves.push_back({index, capLeft});
-            }
-            if (getCol(index) < 7) {
-                short capRight = index + captureRight;
-                if (capRight >= 0 && capRight < 64 &&
-                    state[capRight] != 0 &&
-                    ((isWhite && state[capRight] < 0) || (!isWhite && state[capRight] > 0)))
-                    moves.push_back({index, capRight});
-            }
+            short col = index % 8;
+            if (col > 0 && state[oneStep - 1] * sign < 0)
+                moves.push_back({index, (short)(oneStep - 1)});
+            if (col < 7 && state[oneStep + 1] * sign < 0)
+                moves.push_back({index, (short)(oneStep + 1)});
             // --- En Passant Generation ---
-            if (!undoStack.empty()) {
-                if (isWhite && getRow(index) == 3) {
-                    MoveInfo lastInfo = undoStack.back();
-                    if (std::abs(lastInfo.movedPiece) == 1 && lastInfo.movedPiece < 0) {
-                        int lastSourceRow = getRow(lastInfo.lastMove.first);
-                        int lastTargetRow = getRow(lastInfo.lastMove.second);
-                        if (lastSourceRow == 1 && lastTargetRow == 3 &&
-                            std::abs(getCol(lastInfo.lastMove.second) - getCol(index)) == 1) {
-                            short delta = (getCol(lastInfo.lastMove.second) < getCol(index)) ? -9 : -7;
-                            short enPassantTarget = index + delta;
-                            moves.push_back({index, enPassantTarget});
-                        }
-                    }
-                }
-                if (!isWhite && getRow(index) == 4) {
-                    MoveInfo lastInfo = undoStack.back();
-                    if (std::abs(lastInfo.movedPiece) == 1 && lastInfo.movedPiece > 0) {
-                        int lastSourceRow = getRow(lastInfo.lastMove.first);
-                        int lastTargetRow = getRow(lastInfo.lastMove.second);
-                        if (lastSourceRow == 6 && lastTargetRow == 4 &&
-                            std::abs(getCol(lastInfo.lastMove.second) - getCol(index)) == 1) {
-                            short delta = (getCol(lastInfo.lastMove.second) < getCol(index)) ? 7 : 9;
-                            short enPassantTarget = index + delta;
-                            moves.push_back({index, enPassantTarget});
-                        }
-                    }
-                }
-            }
-            // --- Promotion (Coronation) Logic ---
-            // Identify candidate moves that land on the promotion rank.
-            std::vector<std::pair<short, short>> promotionCandidates;
-            for (const auto &mv : moves) {
-                short targetRow = getRow(mv.second);
-                if ((isWhite && targetRow == 0) || (!isWhite && targetRow == 7)) {
-                    promotionCandidates.push_back(mv);
-                }
-            }
-            // (Promotion candidates will be handled during move execution.)
+            short enPassant = state[EP_INDEX];
+            if (enPassant != NO_SQUARE && enPassant / 8 == oneStep / 8 && std::abs(enPassant % 8 - col) == 1)
+                moves.push_back({index, enPassant});
+            // (Promotions are handled during move execution.)
             break;
         }
-        case 3: { // Knight
-            moves = generateKnightMoves(index, state);
+        case 3: // Knight
+            addKnightMoves<Us>(index, state, moves);
             break;
-        }
-        case 5: { // Rook
-            std::vector<short> rookDeltas = { -8, +8, +1, -1 };
-            moves = generateSlidingMoves(index, state, rookDeltas);
+        case 5: // Rook
+            addSlidingMoves<Us>(index, state, ROOK_DELTAS, 4, moves);
             break;
-        }
-        case 6: { // Bishop
-            std::vector<short> bishopDeltas = { -9, -7, +7, +9 };
-            moves = generateSlidingMoves(index, state, bishopDeltas);
+        case 6: // Bishop
+            addSlidingMoves<Us>(index, state, BISHOP_DELTAS, 4, moves);
             break;
-        }
-        case 9: { // Queen
-            std::vector<short> queenDeltas = { -8, +8, +1, -1, -9, -7, +7, +9 };
-            moves = generateSlidingMoves(index, state, queenDeltas);
+        case 9: // Queen
+            addSlidingMoves<Us>(index, state, QUEEN_DELTAS, 8, moves);
             break;
-        }
         case 127: { // King
-            // Generate normal one-square moves.
-            for (int d = -9; d <= 9; d++) {
-                if (d == 0)
-                    continue;
-                short candidate = index + d;
-                if (candidate < 0 || candidate >= 64)
-                    continue;
-                if (std::abs(getRow(candidate) - getRow(index)) <= 1 &&
-                    std::abs(getCol(candidate) - getCol(index)) <= 1) {
-                    if (state[candidate] == 0 ||
-                        (state[index] > 0 && state[candidate] < 0) ||
-                        (state[index] < 0 && state[candidate] > 0))
-                        moves.push_back({index, candidate});
-                }
-            }
-            // Generate castling moves only if the king is on its starting square and castling rights are available.
-            if ((state[index] > 0 && index == 60 && whiteCanCastle) ||
-                (state[index] < 0 && index == 4 && blackCanCastle)) {
-                // (Castling move generation code as before.)
-                bool canKingside = true;
-                bool canQueenside = true;
-                // Check that the king and corresponding rook have not moved before by scanning undoStack.
-                for (const auto &info : undoStack) {
-                    if ((state[index] > 0 && (info.lastMove.first == 60 || info.lastMove.first == 63 || info.lastMove.first == 56)) ||
-                        (state[index] < 0 && (info.lastMove.first == 4 || info.lastMove.first == 7 || info.lastMove.first == 0))) {
-                        canKingside = false;
-                        canQueenside = false;
-                        break;
-                    }
-                }
-                // Check for empty squares and attacked squares.
-                if (state[index] > 0) { // White king.
-                    if (state[61] != 0 || state[62] != 0)
-                        canKingside = false;
-                    else if (checkAfterMove(state, {60, 61}) || checkAfterMove(state, {60, 62}))
-                        canKingside = false;
-                    if (state[57] != 0 || state[58] != 0 || state[59] != 0)
-                        canQueenside = false;
-                    else if (checkAfterMove(state, {60, 59}) || checkAfterMove(state, {60, 58}))
-                        canQueenside = false;
-                } else { // Black king.
-                    if (state[5] != 0 || state[6] != 0)
-                        canKingside = false;
-                    else if (checkAfterMove(state, {4, 5}) || checkAfterMove(state, {4, 6}))
-                        canKingside = false;
-                    if (state[1] != 0 || state[2] != 0 || state[3] != 0)
-                        canQueenside = false;
-                    else if (checkAfterMove(state, {4, 3}) || checkAfterMove(state, {4, 2}))
-                        canQueenside = false;
-                }
-                if (canKingside)
-                    moves.push_back({index, (state[index] > 0) ? 62 : 6});
-                if (canQueenside)
-                    moves.push_back({index, (state[index] > 0) ? 58 : 2});
+            short row = index / 8;
+            short col = index % 8;
+            for (const auto &step : KING_OFFSETS) {
+                short r = row + step[0];
+                short c = col + step[1];
+                if (r >= 0 && r < 8 && c >= 0 && c < 8 && state[r * 8 + c] * sign <= 0)
+                    moves.push_back({index, (short)(r * 8 + c)});
             }
+            // Castling: only from the home square with the right still available. The king may
+            // not castle out of, through, or into check; attack tests are used instead of
+            // generated moves so castling generation never recurses.
+            const short home = (Us == WHITE) ? 60 : 4;
+            const short kingsideRight = (Us == WHITE) ? CASTLE_WHITE_KINGSIDE : CASTLE_BLACK_KINGSIDE;
+            const short queensideRight = (Us == WHITE) ? CASTLE_WHITE_QUEENSIDE : CASTLE_BLACK_QUEENSIDE;
+            const short rook = 5 * sign;
+            short rights = state[CASTLE_INDEX];
+            if (index != home || !(rights & (kingsideRight | queensideRight)) || squareAttacked<~Us>(state, home))
+                break;
+            if ((rights & kingsideRight) && state[home + 3] == rook && state[home + 1] == 0 && state[home + 2] == 0 &&
+                !squareAttacked<~Us>(state, home + 1) && !squareAttacked<~Us>(state, home + 2))
+                moves.push_back({index, (short)(home + 2)});
+            if ((rights & queensideRight) && state[home - 4] == rook && state[home - 1] == 0 && state[home - 2] == 0 &&
+                state[home - 3] == 0 && !squareAttacked<~Us>(state, home - 1) && !squareAttacked<~Us>(state, home - 2))
+                moves.push_back({index, (short)(home - 2)});
             break;
         }
         default:
             break;
     }
+}
+
+template <Color Us>
+void CHESSLOGIC::generateLegalMoves(const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    const short sign = colorSign(Us);
+    moves.clear();
+    short kingSquare = getKingPositionInState(state, Us == WHITE);
+    // Candidates are tried on one scratch copy, which leavesKingInCheck restores after each.
+    scratchState = state;
+    for (short i = 0; i < 64; i++) {
+        if (state[i] * sign <= 0)
+            continue;
+        // Raw moves are appended, then the ones leaving the king in check are dropped.
+        size_t first = moves.size();
+        addPieceMoves<Us>(i, state, moves);
+        size_t kept = first;
+        for (size_t m = first; m < moves.size(); m++) {
+            if (!leavesKingInCheck<Us>(scratchState, moves[m], kingSquare))
+                moves[kept++] = moves[m];
+        }
+        moves.resize(kept);
+    }
+}
+
+template <Color Us>
+bool CHESSLOGIC::leavesKingInCheck(std::vector<short>& board, std::pair<short, short> move, short kingSquare) {
+    if (kingSquare < 0)
+        return false;
+    const short sign = colorSign(Us);
+    const short forward = (Us == WHITE) ? -8 : 8;
+    short piece = board[move.first];
+    short captured = board[move.second];
+    // An en passant capture also removes the passed pawn, which may uncover a check along the row.
+    short passedPawnSquare = NO_SQUARE;
+    if (piece * sign == 1 && move.second == board[EP_INDEX] && move.first % 8 != move.second % 8) {
+        passedPawnSquare = move.second - forward;
+        board[passedPawnSquare] = 0;
+    }
+    board[move.second] = piece;
+    board[move.first] = 0;
+    bool inCheck = squareAttacked<~Us>(board, piece * sign == 127 ? move.second : kingSquare);
+    // Take the move back.
+    board[move.first] = piece;
+    board[move.second] = captured;
+    if (passedPawnSquare != NO_SQUARE)
+        board[passedPawnSquare] = -piece;
+    return inCheck;
+}
+
+// Scans outward from 'square' for pawns, knights, kings and sliders of the attacking side.
+template <Color By>
+bool CHESSLOGIC::squareAttacked(const std::vector<short>& state, short square) const {
+    const short sign = colorSign(By);
+    short row = square / 8;
+    short col = square % 8;
+
+    // Pawns attack diagonally forward, so a white attacker sits one row below the square.
+    short pawnRow = (By == WHITE) ? row + 1 : row - 1;
+    if (pawnRow >= 0 && pawnRow < 8) {
+        if (col > 0 && state[pawnRow * 8 + col - 1] == sign * 1)
+            return true;
+        if (col < 7 && state[pawnRow * 8 + col + 1] == sign * 1)
+            return true;
+    }
+
+    // Knights and the enemy king.
+    for (const auto &step : KNIGHT_OFFSETS) {
+        short r = row + step[0];
+        short c = col + step[1];
+        if (r >= 0 && r < 8 && c >= 0 && c < 8 && state[r * 8 + c] == sign * 3)
+            return true;
+    }
+    for (const auto &step : KING_OFFSETS) {
+        short r = row + step[0];
+        short c = col + step[1];
+        if (r >= 0 && r < 8 && c >= 0 && c < 8 && state[r * 8 + c] == sign * 127)
+            return true;
+    }
+
+    // Sliding pieces: rooks and queens along ranks/files, bishops and queens along diagonals.
+    static const short slideSteps[8][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
+    for (int d = 0; d < 8; d++) {
+        short straightPiece = (d < 4) ? 5 : 6;
+        short r = row + slideSteps[d][0];
+        short c = col + slideSteps[d][1];
+        while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            short piece = state[r * 8 + c];
+            if (piece != 0) {
+                if (piece == sign * straightPiece || piece == sign * 9)
+                    return true;
+                break;
+            }
+            r += slideSteps[d][0];
+            c += slideSteps[d][1];
+        }
+    }
+    return false;
+}
+
+template <Color Us>
+bool CHESSLOGIC::kingInCheck(const std::vector<short>& state) const {
+    short kingPos = getKingPositionInState(state, Us == WHITE);
+    return kingPos >= 0 && squareAttacked<~Us>(state, kingPos);
+}
+
+// The search calls the colour-specialised functions directly.
+template void CHESSLOGIC::generateLegalMoves<WHITE>(const std::vector<short>&, std::vector<std::pair<short, short>>&);
+template void CHESSLOGIC::generateLegalMoves<BLACK>(const std::vector<short>&, std::vector<std::pair<short, short>>&);
+template bool CHESSLOGIC::squareAttacked<WHITE>(const std::vector<short>&, short) const;
+template bool CHESSLOGIC::squareAttacked<BLACK>(const std::vector<short>&, short) const;
+template bool CHESSLOGIC::kingInCheck<WHITE>(const std::vector<short>&) const;
+template bool CHESSLOGIC::kingInCheck<BLACK>(const std::vector<short>&) const;
+
+// ---------------- Colour Dispatch ----------------
+
+// Generates knight moves as {source, destination} pairs.
+std::vector<std::pair<short, short>> CHESSLOGIC::generateKnightMoves(short index, const std::vector<short>& state) {
+    std::vector<std::pair<short, short>> moves;
+    appendKnightMoves(index, state, moves);
     return moves;
 }
 
+void CHESSLOGIC::appendKnightMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    if (state[index] > 0)
+        addKnightMoves<WHITE>(index, state, moves);
+    else if (state[index] < 0)
+        addKnightMoves<BLACK>(index, state, moves);
+}
+
+// Generates sliding moves (for rook, bishop, queen) using directional deltas.
+std::vector<std::pair<short, short>> CHESSLOGIC::generateSlidingMoves(
+    short index,
+    const std::vector<short>& state,
+    const std::vector<short>& deltas)
+{
+    std::vector<std::pair<short, short>> moves;
+    appendSlidingMoves(index, state, deltas.data(), (int)deltas.size(), moves);
+    return moves;
+}
+
+void CHESSLOGIC::appendSlidingMoves(short index, const std::vector<short>& state, const short* deltas, int deltaCount,
+                                    std::vector<std::pair<short, short>>& moves)
+{
+    if (state[index] > 0)
+        addSlidingMoves<WHITE>(index, state, deltas, deltaCount, moves);
+    else if (state[index] < 0)
+        addSlidingMoves<BLACK>(index, state, deltas, deltaCount, moves);
+}
+
+// Generates moves for any piece at the given index using appropriate helper functions.
+std::vector<std::pair<short, short>> CHESSLOGIC::generateMovesForPiece(short index, const std::vector<short>& state) {
+    std::vector<std::pair<short, short>> moves;
+    appendMovesForPiece(index, state, moves);
+    return moves;
+}
+
+void CHESSLOGIC::appendMovesForPiece(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    if (state[index] > 0)
+        addPieceMoves<WHITE>(index, state, moves);
+    else if (state[index] < 0)
+        addPieceMoves<BLACK>(index, state, moves);
+}
+
 // ---------------- New Generate All Valid Moves Function ----------------
 // Generates all valid moves for the given state by generating raw moves for each piece
 // of the side whose turn it is and filtering out moves that leave the king in check.
 std::vector<std::pair<short, short>> CHESSLOGIC::generateAllValidMoves(const std::vector<short>& state) {
     std::vector<std::pair<short, short>> validMoves;
-    bool isWhite = (state[64] > 0);
-
-    // Loop over all board squares (indices 0-63).
-    for (short i = 0; i < 64; i++) {
-        // If the square contains a piece belonging to the current player...
-        if (state[i] != 0 && ((isWhite && state[i] > 0) || (!isWhite && state[i] < 0))) {
-            std::vector<std::pair<short, short>> rawMoves = generateMovesForPiece(i, state);
-            for (const auto &move : rawMoves) {
-                // Use the refactored checkAfterMove that accepts the state parameter.
-                if (!checkAfterMove(state, move)) {
-                    validMoves.push_back(move);
-                }
-            }
-        }
-    }
+    generateAllValidMoves(state, validMoves);
     return validMoves;
 }
 
+void CHESSLOGIC::generateAllValidMoves(const std::vector<short>& state, std::vector<std::pair<short, short>>& moves) {
+    if (state[TURN_INDEX] > 0)
+        generateLegalMoves<WHITE>(state, moves);
+    else
+        generateLegalMoves<BLACK>(state, moves);
+}
+
 // ---------------- Refactored Check After Move Function ----------------
-// Simulates a candidate move on a dummy copy of the given state and returns true if
+// Simulates a candidate move on a scratch copy of the given state and returns true if
 // it leaves the moving side's king in check.
 bool CHESSLOGIC::checkAfterMove(const std::vector<short>& state, std::pair<short, short> candidateMove) {
-    // 1. Create a dummy copy of the provided state.
-    std::vector<short> dummyState = state;
-
-    // 2. Simulate the candidate move on the dummy state.
-    dummyState[candidateMove.second] = dummyState[candidateMove.first];
-    dummyState[candidateMove.first] = 0;
-
-    // 3. Toggle the turn indicator (now representing the enemy's turn).
-    dummyState[64] *= -1;
-
-    // 4. Determine the king's position for the moving side.
-    short candidateKingPos;
-    if (std::abs(state[candidateMove.first]) == 127) {
-        candidateKingPos = candidateMove.second;
-    } else {
-        // Since dummyState[64] now represents the enemy's turn, the moving side is the opposite.
-        bool movingSideIsWhite = (dummyState[64] < 0);
-        candidateKingPos = getKingPositionInState(dummyState, movingSideIsWhite);
-    }
-
-    // 5. For every enemy piece in the dummy state, generate its moves.
-    for (short i = 0; i < 64; i++) {
-        if (dummyState[i] != 0) {
-            if ((dummyState[64] < 0 && dummyState[i] < 0) ||
-                (dummyState[64] > 0 && dummyState[i] > 0)) {
-                std::vector<std::pair<short, short>> enemyMoves = generateMovesForPiece(i, dummyState);
-                for (const auto &move : enemyMoves) {
-                    if (move.second == candidateKingPos) {
-                        return true; // The king would be in check.
-                    }
-                }
-            }
-        }
-    }
-    return false;
+    short piece = state[candidateMove.first];
+    if (piece == 0)
+        return false;
+    scratchState = state;
+    bool movingSideIsWhite = (piece > 0);
+    short kingSquare = getKingPositionInState(state, movingSideIsWhite);
+    return movingSideIsWhite ? leavesKingInCheck<WHITE>(scratchState, candidateMove, kingSquare)
+                             : leavesKingInCheck<BLACK>(scratchState, candidateMove, kingSquare);
 }
 
 // ---------------- Helper: Get King Position In State ----------------
 // Returns the index of the king for the given color in the provided state.
 // isWhite = true returns white king (127), false returns black king (-127).
-short CHESSLOGIC::getKingPositionInState(const std::vector<short>& state, bool isWhite) {
+short CHESSLOGIC::getKingPositionInState(const std::vector<short>& state, bool isWhite) const {
     short kingValue = isWhite ? 127 : -127;
     for (short i = 0; i < 64; i++) {
         if (state[i] == kingValue)
             return i;
     }
     return -1; // Should not happen in a legal state.
+}
+
+// ---------------- Helper: Is King In Check ----------------
+// Returns true if any enemy piece in the provided state attacks the king of the given side.
+bool CHESSLOGIC::isKingInCheck(const std::vector<short>& state, bool isWhite) {
+    return isWhite ? kingInCheck<WHITE>(state) : kingInCheck<BLACK>(state);
+}
+
+// ---------------- Helper: Is Square Attacked ----------------
+bool CHESSLOGIC::isSquareAttacked(const std::vector<short>& state, short square, bool byWhite) {
+    return byWhite ? squareAttacked<WHITE>(state, square) : squareAttacked<BLACK>(state, square);
+}
+
+// ---------------- Draw Rules ----------------
+const std::vector<uint64_t>& CHESSLOGIC::getPositionKeys() const {
+    return positionKeys;
+}
+
+// Only positions since the last capture or pawn move can equal the current one, and only
+// those with the same side to move, so the scan steps back two plies at a time and stops
+// at the halfmove clock.
+int CHESSLOGIC::repetitionCount() const {
+    int count = 1;
+    int current = (int)positionKeys.size() - 1;
+    int reversible = std::min<int>(gameState[HALFMOVE_INDEX], current);
+    for (int back = 4; back <= reversible; back += 2) {
+        if (positionKeys[current - back] == positionKeys[current])
+            count++;
+    }
+    return count;
+}
+
+bool CHESSLOGIC::isDrawByRule() const {
+    return gameState[HALFMOVE_INDEX] >= 100 || repetitionCount() >= 3;
+}
+
+// ---------------- Insufficient Material ----------------
+// Only bare kings, or kings plus a single knight or bishop, remain on the board.
+bool CHESSLOGIC::isInsufficientMaterial(const std::vector<short>& state) {
+    int minorPieces = 0;
+    for (short i = 0; i < 64; i++) {
+        short absPiece = std::abs(state[i]);
+        if (absPiece == 1 || absPiece == 5 || absPiece == 9)
+            return false;
+        if (absPiece == 3 || absPiece == 6)
+            minorPieces++;
+    }
+    return minorPieces <= 1;
+}
+
+// ---------------- Castling Rights ----------------
+// A king move clears both rights of its side; a move from or onto a rook's home corner clears that right.
+void CHESSLOGIC::updateCastlingRights(std::vector<short>& state, std::pair<short, short> move) {
+    short rights = state[CASTLE_INDEX];
+    if (rights == 0)
+        return;
+    if (state[move.first] == 127)
+        rights &= ~CASTLE_WHITE;
+    if (state[move.first] == -127)
+        rights &= ~CASTLE_BLACK;
+    const short squares[2] = { move.first, move.second };
+    for (short sq : squares) {
+        if (sq == 63) rights &= ~CASTLE_WHITE_KINGSIDE;
+        if (sq == 56) rights &= ~CASTLE_WHITE_QUEENSIDE;
+        if (sq == 7)  rights &= ~CASTLE_BLACK_KINGSIDE;
+        if (sq == 0)  rights &= ~CASTLE_BLACK_QUEENSIDE;
+    }
+    state[CASTLE_INDEX] = rights;
+}
+
+// ---------------- En Passant and Halfmove Clock ----------------
+// A pawn move or capture resets the clock. A double push records the skipped square, but only
+// when an enemy pawn stands beside the destination, so equal positions get equal states.
+void CHESSLOGIC::updatePawnState(std::vector<short>& state, std::pair<short, short> move) {
+    short piece = state[move.first];
+    short enPassant = state[EP_INDEX];
+    state[EP_INDEX] = NO_SQUARE;
+    if (std::abs(piece) != 1) {
+        if (state[move.second] != 0)
+            state[HALFMOVE_INDEX] = 0;
+        else if (state[HALFMOVE_INDEX] < std::numeric_limits<short>::max())
+            state[HALFMOVE_INDEX]++;
+        return;
+    }
+    state[HALFMOVE_INDEX] = 0;
+    short forward = (piece > 0) ? -8 : 8;
+    if (move.second == enPassant && move.first % 8 != move.second % 8)
+        state[move.second - forward] = 0;
+    if (move.second - move.first == 2 * forward) {
+        short col = move.second % 8;
+        if ((col > 0 && state[move.second - 1] == -piece) || (col < 7 && state[move.second + 1] == -piece))
+            state[EP_INDEX] = move.first + forward;
+    }
+}
+
+// ---------------- Apply Move To State ----------------
+// Applies a legal move (as produced by generateAllValidMoves) to a standalone state.
+void CHESSLOGIC::applyMove(std::vector<short>& state, std::pair<short, short> move) {
+    short piece = state[move.first];
+    bool movingSideIsWhite = (piece > 0);
+    updateCastlingRights(state, move);
+    updatePawnState(state, move);
+
+    // Move the piece from source to destination.
+    state[move.second] = piece;
+    state[move.first] = 0;
+
+    // Castling: the king moves two squares, so bring the rook across as well.
+    if (std::abs(piece) == 127 && std::abs(move.second - move.first) == 2) {
+        bool kingside = (move.second > move.first);
+        short rookFrom = kingside ? move.first + 3 : move.first - 4;
+        short rookTo = kingside ? move.first + 1 : move.first - 1;
+        state[rookTo] = state[rookFrom];
+        state[rookFrom] = 0;
+    }
+
+    // Promotion: a pawn reaching the last row becomes a queen.
+    short promotionRow = movingSideIsWhite ? 0 : 7;
+    if (std::abs(piece) == 1 && move.second / 8 == promotionRow)
+        state[move.second] = movingSideIsWhite ? 9 : -9;
+
+    // Toggle the turn indicator so the state now reflects the new turn.
+    state[TURN_INDEX] *= -1;
 }
\ No newline at end of file
@@ -3,44 +3,123 @@
 
 #include <vector>
 #include <utility>
-#include <unordered_map>
-#include <functional>
 #include <string>
+#include <cstdint>
 #include "../utils/moveinfo.h"
 
-// CHESSLOGIC encapsulates the game state, move dispatching (including special moves),
-// move validation (checking for check and checkmate), undo functionality, and raw move generation.
-// It also stores all valid moves for the current turn (for use in algorithms like MiniMax) and a flag
-// to indicate checkmate.
+// ------------------ State Layout ------------------
+// A state vector holds the 64 board squares followed by the side to move, the castling
+// rights, the en passant square and the halfmove clock, so the move generator and the
+// evaluation can work from the state alone.
+const short TURN_INDEX     = 64;  // +1 for white, -1 for black.
+const short CASTLE_INDEX   = 65;  // Bitmask of the CASTLE_* rights still available.
+const short EP_INDEX       = 66;  // Square a pawn may capture onto en passant, or NO_SQUARE.
+const short HALFMOVE_INDEX = 67;  // Plies since the last capture or pawn move.
+const short STATE_SIZE     = 68;
+
+const short NO_SQUARE = -1;
+
+// Side to move as a compile-time parameter of the colour-specialised generator.
+enum Color { WHITE, BLACK };
+constexpr Color operator~(Color color) { return color == WHITE ? BLACK : WHITE; }
+// Sign of the pieces of a colour in the state (White's are positive).
+constexpr short colorSign(Color color) { return color == WHITE ? 1 : -1; }
+
+const short CASTLE_WHITE_KINGSIDE  = 1;
+const short CASTLE_WHITE_QUEENSIDE = 2;
+const short CASTLE_BLACK_KINGSIDE  = 4;
+const short CASTLE_BLACK_QUEENSIDE = 8;
+const short CASTLE_WHITE = CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE;
+const short CASTLE_BLACK = CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE;
+
+// CHESSLOGIC encapsulates the game state, move validation (checking for check and checkmate),
+// undo functionality, and raw move generation. It also stores all valid moves for the current
+// turn (for use in algorithms like MiniMax), indexed by source square, and a flag to indicate
+// checkmate.
+//
+// CHESSLOGIC holds no global state: the game owns one instance and every search thread owns
+// its own, so any number of games and engines can run side by side in one process.
 struct CHESSLOGIC {
 public:
     CHESSLOGIC();
 
     // ------------------ Accessors ------------------
-    // Returns the current game state vector (board squares + turn indicator).
+    // Returns the current game state vector (board squares, turn indicator and castling rights).
     const std::vector<short>& getState() const;
     // Returns whose turn it is (value at index 64; +1 for white, -1 for black).
     short turnToMove() const;
     // Toggles the turn indicator.
     void changeTurn();
 
+    // ------------------ FEN ------------------
+    // Replace the game with the position of a FEN string (see notation.h); the move history
+    // is cleared. Returns false and leaves the game unchanged if the FEN is malformed.
+    bool setFen(const std::string& fen);
+    // The current position as a FEN string.
+    std::string getFen() const;
+    // Number of the move being played, counted as in FEN (starts at 1, increments after Black).
+    int fullmoveNumber() const;
+
     // ------------------ Move Dispatch & Undo ------------------
-    // Dispatches a move request to the appropriate piece-specific move function.
-    void move(std::pair<short, short> moveIndex);
+    // Plays a move if it is legal in the current position; returns false and changes
+    // nothing otherwise. Legality is one lookup in the legal-move index.
+    bool move(std::pair<short, short> moveIndex);
     // Undoes the last move; returns false if no moves remain.
     bool undoMove();
     // Returns the history of moves (each move stored as a MoveInfo record).
     std::vector<MoveInfo> getMoveHistory() const;
 
     std::vector<std::pair<short, short>> generateAllValidMoves(const std::vector<short>& state);
+    // Same, into a caller-owned buffer (cleared first). The buffer keeps its capacity, so a
+    // search that reuses one list per ply generates moves without allocating.
+    void generateAllValidMoves(const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
     bool checkAfterMove(const std::vector<short>& state, std::pair<short, short> candidateMove);
-    short getKingPositionInState(const std::vector<short>& state, bool isWhite);
+    short getKingPositionInState(const std::vector<short>& state, bool isWhite) const;
+    // Returns true if the king of the given side is attacked in the provided state.
+    bool isKingInCheck(const std::vector<short>& state, bool isWhite);
+    // Returns true if 'square' is attacked by any piece of the given side in the provided state.
+    bool isSquareAttacked(const std::vector<short>& state, short square, bool byWhite);
+    // Applies a legal move to a state: moves the rook when castling, removes the pawn taken en
+    // passant, promotes pawns to queens, updates the castling rights, en passant square and
+    // halfmove clock, and toggles the turn. Used by the search to build child states.
+    static void applyMove(std::vector<short>& state, std::pair<short, short> move);
+    // Updates the halfmove clock and en passant square for 'move' and removes a pawn captured
+    // en passant. Called before the moving piece leaves its square.
+    static void updatePawnState(std::vector<short>& state, std::pair<short, short> move);
+    // Clears the castling rights lost by moving from (or capturing on) the squares of 'move'.
+    static void updateCastlingRights(std::vector<short>& state, std::pair<short, short> move);
+    // Returns true if neither side has enough material left to mate (K v K, K+minor v K).
+    static bool isInsufficientMaterial(const std::vector<short>& state);
+    // ------------------ Draw Rules ------------------
+    // Zobrist keys (see zobrist.h) of every position of the game so far, the current one last.
+    // The search continues this history along its own path to detect repetitions.
+    const std::vector<uint64_t>& getPositionKeys() const;
+    // How often the current position has occurred in the game, this time included.
+    int repetitionCount() const;
+    // True if the game is drawn by threefold repetition or the fifty-move rule.
+    bool isDrawByRule() const;
+    // ------------------ Colour-specialised Generation ------------------
+    // The functions above for a side known at compile time; the search calls these directly
+    // since it knows whose turn it is at every node. 'Us' is the side to move, 'By' the attacker.
+    template <Color Us>
+    void generateLegalMoves(const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
+    template <Color By>
+    bool squareAttacked(const std::vector<short>& state, short square) const;
+    template <Color Us>
+    bool kingInCheck(const std::vector<short>& state) const;
+
+    // Castling rights of the current game state.
+    bool whiteCanCastle() const;
+    bool blackCanCastle() const;
     // Stores all valid moves for the current turn.
     std::vector<std::pair<short, short>> allValidMoves;
+    // ------------------ Legal-move Index ------------------
+    // The same moves as destination bitmasks per source square (bit i set = square i), rebuilt
+    // whenever the position changes.
+    bool isLegalMove(std::pair<short, short> moveIndex) const;
+    uint64_t legalDestinations(short square) const;
     // True if the current player is in checkmate.
     bool checkMateFlag;
-    bool blackCanCastle;
-    bool whiteCanCastle;
 
     // ------------------ Raw Move Generation ------------------
     // These helper functions generate raw moves (without full check validation) for each piece.
@@ -48,7 +127,13 @@ public:
     std::vector<std::pair<short, short>> generateKnightMoves(short index, const std::vector<short>& state);
     std::vector<std::pair<short, short>> generateSlidingMoves(short index, const std::vector<short>& state, const std::vector<short>& deltas);
     std::vector<std::pair<short, short>> generateMovesForPiece(short index, const std::vector<short>& state);
-    bool gameOver() {return checkMateFlag;}
+    // The same moves appended to an existing list, which is how the generator works internally.
+    void appendKnightMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
+    void appendSlidingMoves(short index, const std::vector<short>& state, const short* deltas, int deltaCount,
+                            std::vector<std::pair<short, short>>& moves);
+    void appendMovesForPiece(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
+    // True at checkmate or stalemate, or once the game is drawn by rule.
+    bool gameOver() const {return checkMateFlag || isDrawByRule();}
 
     // ------------------ Public Helper for Move Validity ------------------
     // Returns true if the piece at sourceIndex does not belong to the player whose turn it is.
@@ -56,12 +141,22 @@ public:
 
 private:
     // ------------------ Game State ------------------
-    // gameState[0..63] represent board squares; gameState[64] is the turn indicator (+1 for white, -1 for black).
+    // gameState[0..63] represent board squares; gameState[64] is the turn indicator (+1 for white, -1 for black);
+    // gameState[65] holds the castling rights, gameState[66] the en passant square and
+    // gameState[67] the halfmove clock (see State Layout above).
     std::vector<short> gameState;
-
-    // ------------------ Move Function Mapping ------------------
-    // Maps the absolute piece code to its corresponding move function.
-    std::unordered_map<short, std::function<void(std::pair<short, short>)>> moveFunctions;
+    // Fullmove number of the position the game started from (1 unless set by a FEN).
+    int startFullmove;
+    // Zobrist key of every position of the game (see getPositionKeys).
+    std::vector<uint64_t> positionKeys;
+    // Scratch copy of a state used by checkAfterMove, kept to avoid an allocation per test.
+    std::vector<short> scratchState;
+
+    // ------------------ Legal-move Index ------------------
+    // destinationMasks[from] has bit 'to' set for every legal move {from, to}.
+    uint64_t destinationMasks[64];
+    // Regenerates allValidMoves, the masks and the checkmate flag for gameState.
+    void refreshLegalMoves();
 
     // ------------------ King Position Storage ------------------
     // For a standard starting position:
@@ -71,48 +166,32 @@ private:
     short kingBlackPos;
 
     // ------------------ Undo Stack ------------------
-    // Stores the information needed to undo moves (including the game state before the move,
-    // the move itself, king positions, and which piece moved and was captured).
+    // Stores the information needed to undo moves (including the game state before the move, which
+    // also carries the castling rights, the move itself, king positions, and which piece moved and was captured).
     std::vector<MoveInfo> undoStack;
 
-    // ------------------ Board Coordinate Helpers ------------------
-    // Returns the column (0–7) for a given board index.
-    short getCol(short index);
-    // Returns the row (0–7) for a given board index.
-    short getRow(short index);
-
-    // ------------------ Sliding Helpers ------------------
-    // For rook-like moves (vertical/horizontal).
-    bool attemptSlideRook(short start, short target, short delta);
-    // For bishop-like moves (diagonal).
-    bool attemptSlideDiagonal(short start, short target, short delta);
-
-    // ------------------ Move Validity Helpers ------------------
-    bool playerMovingEmptySquare(short sourceIndex);
-    bool playerCaptureOwnPiece(short sourceIndex, short destIndex);
-    bool isMovePrelimValid(std::pair<short, short> moveIndex);
+    // ------------------ Colour-specialised Helpers ------------------
+    template <Color Us>
+    void addKnightMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
+    template <Color Us>
+    void addSlidingMoves(short index, const std::vector<short>& state, const short* deltas, int deltaCount,
+                         std::vector<std::pair<short, short>>& moves);
+    template <Color Us>
+    void addPieceMoves(short index, const std::vector<short>& state, std::vector<std::pair<short, short>>& moves);
+    // Plays 'move' on 'board', tests the king of 'Us' (on 'kingSquare' unless it moved) and
+    // takes the move back.
+    template <Color Us>
+    bool leavesKingInCheck(std::vector<short>& board, std::pair<short, short> move, short kingSquare);
 
     // ------------------ Undo / Execute Helpers ------------------
     // Saves the current game state, king positions, and move details into the undo stack.
     void saveLastMove(std::pair<short, short> moveIndex);
-    // Executes a move (updates gameState, toggles turn, and then calls checkMate() to update valid moves and checkmate flag).
+    // Executes a legal move (updates gameState and the turn, then the legal-move index and checkmate flag).
     void executeMove(std::pair<short, short> moveIndex);
 
     // ------------------ King Helpers ------------------
-    // Returns true if the kings at the given positions are adjacent.
-    bool kingsAreAdjacent(short pos1, short pos2);
     // Updates the stored king position for the given side.
     void updateKingPosition(short newPos, bool isWhite);
-
-    // ------------------ Piece-specific Move Functions ------------------
-    // Each of these functions implements the move logic for the respective piece (pawn, knight, rook, bishop, queen, king),
-    // including special moves such as en passant, promotion, and castling.
-    void movePawn(std::pair<short, short> moveIndex);
-    void moveKnight(std::pair<short, short> moveIndex);
-    void moveRook(std::pair<short, short> moveIndex);
-    void moveBishop(std::pair<short, short> moveIndex);
-    void moveQueen(std::pair<short, short> moveIndex);
-    void moveKing(std::pair<short, short> moveIndex);
 };
 
 #endif // CHESSLOGIC_H
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "notation.h"
+#include "chesslogic.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+namespace {
+
+// FEN letter of a piece code (upper case for White) and back; 0 for unknown letters.
+char pieceToFen(short code) {
+    char letter;
+    switch (std::abs(code)) {
+        case 1:   letter = 'p'; break;
+        case 3:   letter = 'n'; break;
+        case 5:   letter = 'r'; break;
+        case 6:   letter = 'b'; break;
+        case 9:   letter = 'q'; break;
+        default:  letter = 'k'; break;
+    }
+    return (code > 0) ? (char)(letter - 'a' + 'A') : letter;
+}
+
+short fenToPiece(char letter) {
+    switch (letter) {
+        case 'P': return 1;    case 'p': return -1;
+        case 'N': return 3;    case 'n': return -3;
+        case 'R': return 5;    case 'r': return -5;
+        case 'B': return 6;    case 'b': return -6;
+        case 'Q': return 9;    case 'q': return -9;
+        case 'K': return 127;  case 'k': return -127;
+        default:  return 0;
+    }
+}
+
+// Parses a non-negative decimal number; false if the text is not one.
+bool parseCount(const std::string& text, int& value) {
+    if (text.empty() || text.size() > 6 || text.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+    value = std::atoi(text.c_str());
+    return true;
+}
+
+} // namespace
+
+std::string indexToSquare(short index) {
+    char file = 'a' + (index % 8);
+    char rank = '8' - (index / 8);
+    return std::string(1, file) + std::string(1, rank);
+}
+
+short squareToIndex(const std::string& square) {
+    if (square.size() != 2)
+        return -1;
+    char file = square[0];
+    char rank = square[1];
+    if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+        return -1;
+    return (short)(('8' - rank) * 8 + (file - 'a'));
+}
+
+std::string moveToUci(const std::vector<short>& state, std::pair<short, short> move) {
+    std::string text = indexToSquare(move.first) + indexToSquare(move.second);
+    short piece = state[move.first];
+    short targetRow = move.second / 8;
+    if ((piece == 1 && targetRow == 0) || (piece == -1 && targetRow == 7))
+        text += "q";
+    return text;
+}
+
+bool parseUciMove(const std::string& text, std::pair<short, short>& move) {
+    if (text.size() != 4 && text.size() != 5)
+        return false;
+    if (text.size() == 5 && text[4] != 'q')
+        return false;
+    short from = squareToIndex(text.substr(0, 2));
+    short to = squareToIndex(text.substr(2, 2));
+    if (from < 0 || to < 0)
+        return false;
+    move = std::make_pair(from, to);
+    return true;
+}
+
+bool parseSanMove(CHESSLOGIC& logic, const std::vector<short>& state, const std::string& text,
+                  std::pair<short, short>& move) {
+    // Drop check marks and annotations.
+    std::string san = text;
+    while (!san.empty() && std::string("+#!?").find(san.back()) != std::string::npos)
+        san.pop_back();
+    if (san.empty())
+        return false;
+
+    std::vector<std::pair<short, short>> legalMoves = logic.generateAllValidMoves(state);
+    bool white = state[TURN_INDEX] > 0;
+
+    // Castling is written as a king move of two squares.
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        short from = white ? 60 : 4;
+        short to = (san.size() == 3) ? from + 2 : from - 2;
+        for (const auto& candidate : legalMoves) {
+            if (candidate.first == from && candidate.second == to && std::abs(state[from]) == 127) {
+                move = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Promotion suffix: "e8=Q" or "e8Q".
+    size_t promotion = san.find('=');
+    if (promotion != std::string::npos) {
+        if (san.substr(promotion) != "=Q")
+            return false;
+        san.erase(promotion);
+    } else if (san.size() > 2 && std::string("NBRQ").find(san.back()) != std::string::npos
+               && san[san.size() - 2] >= '1' && san[san.size() - 2] <= '8') {
+        if (san.back() != 'Q')
+            return false;
+        san.pop_back();
+    }
+
+    short pieceCode = 1;
+    size_t pos = 0;
+    switch (san[0]) {
+        case 'N': pieceCode = 3; pos = 1; break;
+        case 'B': pieceCode = 6; pos = 1; break;
+        case 'R': pieceCode = 5; pos = 1; break;
+        case 'Q': pieceCode = 9; pos = 1; break;
+        case 'K': pieceCode = 127; pos = 1; break;
+        default: break;
+    }
+    if (san.size() < pos + 2)
+        return false;
+    short to = squareToIndex(san.substr(san.size() - 2));
+    if (to < 0)
+        return false;
+
+    // Whatever sits between the piece letter and the destination disambiguates the source.
+    short fromFile = -1, fromRank = -1;
+    for (size_t i = pos; i < san.size() - 2; i++) {
+        char c = san[i];
+        if (c >= 'a' && c <= 'h')
+            fromFile = c - 'a';
+        else if (c >= '1' && c <= '8')
+            fromRank = '8' - c;
+        else if (c != 'x')
+            return false;
+    }
+
+    int matches = 0;
+    for (const auto& candidate : legalMoves) {
+        if (candidate.second != to || std::abs(state[candidate.first]) != pieceCode)
+            continue;
+        if (fromFile >= 0 && candidate.first % 8 != fromFile)
+            continue;
+        if (fromRank >= 0 && candidate.first / 8 != fromRank)
+            continue;
+        move = candidate;
+        matches++;
+    }
+    return matches == 1;
+}
+
+std::string moveToSan(CHESSLOGIC& logic, const std::vector<short>& state, std::pair<short, short> move) {
+    short piece = state[move.first];
+    short pieceCode = std::abs(piece);
+    std::string san;
+    if (pieceCode == 127 && std::abs(move.second - move.first) == 2) {
+        san = (move.second > move.first) ? "O-O" : "O-O-O";
+    } else if (pieceCode == 1) {
+        // Pawn captures name the source file; an en passant capture lands on an empty square.
+        if (move.first % 8 != move.second % 8)
+            san = std::string(1, (char)('a' + move.first % 8)) + "x";
+        san += indexToSquare(move.second);
+        if (move.second / 8 == (piece > 0 ? 0 : 7))
+            san += "=Q";
+    } else {
+        san = std::string(1, (char)(pieceToFen(pieceCode)));
+        // Disambiguate by file, then by rank, then by both.
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        for (const auto& other : logic.generateAllValidMoves(state)) {
+            if (other.second != move.second || other.first == move.first || state[other.first] != piece)
+                continue;
+            ambiguous = true;
+            sameFile |= (other.first % 8 == move.first % 8);
+            sameRank |= (other.first / 8 == move.first / 8);
+        }
+        if (ambiguous && (!sameFile || sameRank))
+            san += (char)('a' + move.first % 8);
+        if (ambiguous && sameFile)
+            san += (char)('8' - move.first / 8);
+        if (state[move.second] != 0)
+            san += "x";
+        san += indexToSquare(move.second);
+    }
+
+    std::vector<short> after = state;
+    CHESSLOGIC::applyMove(after, move);
+    if (logic.isKingInCheck(after, after[TURN_INDEX] > 0))
+        san += logic.generateAllValidMoves(after).empty() ? "#" : "+";
+    return san;
+}
+
+bool parseFen(const std::string& fen, std::vector<short>& state, int& fullmoveNumber) {
+    std::istringstream fields(fen);
+    std::string placement, side, castling, enPassant, halfmove = "0", fullmove = "1";
+    if (!(fields >> placement >> side >> castling >> enPassant))
+        return false;
+    fields >> halfmove >> fullmove;
+
+    std::vector<short> parsed(STATE_SIZE, 0);
+    int row = 0, col = 0, whiteKings = 0, blackKings = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (col != 8 || ++row > 7)
+                return false;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+            if (col > 8)
+                return false;
+        } else {
+            short piece = fenToPiece(c);
+            if (piece == 0 || col > 7)
+                return false;
+            if (std::abs(piece) == 1 && (row == 0 || row == 7))
+                return false;
+            whiteKings += (piece == 127);
+            blackKings += (piece == -127);
+            parsed[row * 8 + col++] = piece;
+        }
+    }
+    if (row != 7 || col != 8 || whiteKings != 1 || blackKings != 1)
+        return false;
+
+    if (side != "w" && side != "b")
+        return false;
+    parsed[TURN_INDEX] = (side == "w") ? 1 : -1;
+
+    // Castling rights; rights without the king and rook at home are dropped.
+    short rights = 0;
+    if (castling != "-") {
+        for (char c : castling) {
+            switch (c) {
+                case 'K': rights |= CASTLE_WHITE_KINGSIDE; break;
+                case 'Q': rights |= CASTLE_WHITE_QUEENSIDE; break;
+                case 'k': rights |= CASTLE_BLACK_KINGSIDE; break;
+                case 'q': rights |= CASTLE_BLACK_QUEENSIDE; break;
+                default: return false;
+            }
+        }
+    }
+    if (parsed[60] != 127) rights &= ~CASTLE_WHITE;
+    if (parsed[4] != -127) rights &= ~CASTLE_BLACK;
+    if (parsed[63] != 5)  rights &= ~CASTLE_WHITE_KINGSIDE;
+    if (parsed[56] != 5)  rights &= ~CASTLE_WHITE_QUEENSIDE;
+    if (parsed[7] != -5)  rights &= ~CASTLE_BLACK_KINGSIDE;
+    if (parsed[0] != -5)  rights &= ~CASTLE_BLACK_QUEENSIDE;
+    parsed[CASTLE_INDEX] = rights;
+
+    // En passant: the square behind a pawn of the side that just moved, kept only if a pawn
+    // of the side to move stands beside that pawn.
+    parsed[EP_INDEX] = NO_SQUARE;
+    if (enPassant != "-") {
+        short square = squareToIndex(enPassant);
+        if (square < 0)
+            return false;
+        short mover = parsed[TURN_INDEX];
+        short expectedRow = (mover > 0) ? 2 : 5;
+        short passedPawn = square + ((mover > 0) ? 8 : -8);
+        if (square / 8 == expectedRow && parsed[passedPawn] == -mover && parsed[square] == 0) {
+            short passedCol = passedPawn % 8;
+            if ((passedCol > 0 && parsed[passedPawn - 1] == mover) ||
+                (passedCol < 7 && parsed[passedPawn + 1] == mover))
+                parsed[EP_INDEX] = square;
+        }
+    }
+
+    int halfmoveClock, fullmoveCount;
+    if (!parseCount(halfmove, halfmoveClock) || !parseCount(fullmove, fullmoveCount))
+        return false;
+    parsed[HALFMOVE_INDEX] = (short)std::min(halfmoveClock, 32767);
+    fullmoveNumber = std::max(fullmoveCount, 1);
+    state = parsed;
+    return true;
+}
+
+std::string stateToFen(const std::vector<short>& state, int fullmoveNumber) {
+    std::string fen;
+    for (int row = 0; row < 8; row++) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            short piece = state[row * 8 + col];
+            if (piece == 0) {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+                fen += (char)('0' + empty);
+            empty = 0;
+            fen += pieceToFen(piece);
+        }
+        if (empty > 0)
+            fen += (char)('0' + empty);
+        if (row < 7)
+            fen += '/';
+    }
+    fen += (state[TURN_INDEX] > 0) ? " w " : " b ";
+    short rights = state[CASTLE_INDEX];
+    if (rights == 0)
+        fen += '-';
+    if (rights & CASTLE_WHITE_KINGSIDE)  fen += 'K';
+    if (rights & CASTLE_WHITE_QUEENSIDE) fen += 'Q';
+    if (rights & CASTLE_BLACK_KINGSIDE)  fen += 'k';
+    if (rights & CASTLE_BLACK_QUEENSIDE) fen += 'q';
+    fen += ' ';
+    fen += (state[EP_INDEX] == NO_SQUARE) ? std::string("-") : indexToSquare(state[EP_INDEX]);
+    fen += " " + std::to_string(state[HALFMOVE_INDEX]) + " " + std::to_string(fullmoveNumber);
+    return fen;
+}
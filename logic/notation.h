@@ -0,0 +1,43 @@
+// notation.h
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include <vector>
+#include <string>
+#include <utility>
+
+struct CHESSLOGIC;
+
+// Conversions between board indices (0 = a8 ... 63 = h1) and algebraic notation.
+
+// Returns the square name ("e4") of a board index.
+std::string indexToSquare(short index);
+// Returns the board index of a square name, or -1 if the name is malformed.
+short squareToIndex(const std::string& square);
+
+// Returns the move in long algebraic (UCI) form, e.g. "e2e4" or "e7e8q" for a promotion.
+std::string moveToUci(const std::vector<short>& state, std::pair<short, short> move);
+// Parses a UCI move string; returns false if it is malformed. Promotions to anything but a
+// queen are rejected.
+bool parseUciMove(const std::string& text, std::pair<short, short>& move);
+// Parses a move in standard algebraic notation ("Nf3", "exd5", "O-O", "e8=Q+") by matching
+// it against the legal moves of 'state'. Returns false if the text is malformed, matches no
+// legal move or is ambiguous; promotions to anything but a queen are rejected.
+bool parseSanMove(CHESSLOGIC& logic, const std::vector<short>& state, const std::string& text,
+                  std::pair<short, short>& move);
+
+// Returns a legal move in standard algebraic notation, with the disambiguation, capture,
+// promotion ("=Q") and check ("+", "#") marks parseSanMove() accepts.
+std::string moveToSan(CHESSLOGIC& logic, const std::vector<short>& state, std::pair<short, short> move);
+
+// Forsyth-Edwards Notation of the standard starting position.
+extern const char* const START_FEN;
+// Parses a FEN string into a state vector and its fullmove number. The halfmove clock and
+// fullmove number may be omitted (as in EPD records). Castling rights whose king or rook is
+// not on its home square are dropped, and the en passant square is only kept if a pawn can
+// capture onto it, matching what applyMove() records. Returns false if the FEN is malformed.
+bool parseFen(const std::string& fen, std::vector<short>& state, int& fullmoveNumber);
+// Returns the FEN string of a state.
+std::string stateToFen(const std::vector<short>& state, int fullmoveNumber);
+
+#endif // NOTATION_H
@@ -0,0 +1,300 @@
+#include "pgn.h"
+#include "chesslogic.h"
+#include "notation.h"
+#include <cctype>
+
+std::string PgnGame::tag(const std::string& name) const {
+    for (const auto& tag : tags) {
+        if (tag.first == name)
+            return tag.second;
+    }
+    return "";
+}
+
+void PgnGame::setTag(const std::string& name, const std::string& value) {
+    for (auto& tag : tags) {
+        if (tag.first == name) {
+            tag.second = value;
+            return;
+        }
+    }
+    tags.push_back(std::make_pair(name, value));
+}
+
+bool PgnGame::startPosition(std::vector<short>& state, int& fullmoveNumber) const {
+    std::string fen = tag("FEN");
+    return parseFen(fen.empty() ? START_FEN : fen, state, fullmoveNumber);
+}
+
+void PgnGame::clear() {
+    tags.clear();
+    moves.clear();
+    comments.clear();
+    result.clear();
+}
+
+PGN_READER::PGN_READER(std::istream& in)
+    : in(in), hasPendingLine(false), inComment(false), variationDepth(0) {}
+
+namespace {
+
+// Adds a character to the comment of the last move read (comments before the first move
+// are dropped).
+void appendComment(PgnGame& game, char c) {
+    if (game.moves.empty())
+        return;
+    game.comments.resize(game.moves.size());
+    std::string& comment = game.comments.back();
+    if (std::isspace((unsigned char)c)) {
+        if (!comment.empty() && comment.back() != ' ')
+            comment += ' ';
+    } else {
+        comment += c;
+    }
+}
+
+bool isResult(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool allDigits(const std::string& token) {
+    if (token.empty())
+        return false;
+    for (char c : token) {
+        if (!std::isdigit((unsigned char)c))
+            return false;
+    }
+    return true;
+}
+
+// Parses '[Name "Value"]'; returns false if the line is not a tag pair.
+bool parseTag(const std::string& line, std::pair<std::string, std::string>& tag) {
+    size_t open = line.find('[');
+    size_t quote = line.find('"', open);
+    if (open == std::string::npos || quote == std::string::npos)
+        return false;
+    size_t nameStart = open + 1;
+    while (nameStart < quote && std::isspace((unsigned char)line[nameStart]))
+        nameStart++;
+    size_t nameEnd = nameStart;
+    while (nameEnd < quote && !std::isspace((unsigned char)line[nameEnd]))
+        nameEnd++;
+    tag.first = line.substr(nameStart, nameEnd - nameStart);
+    tag.second.clear();
+    for (size_t i = quote + 1; i < line.size() && line[i] != '"'; i++) {
+        if (line[i] == '\\' && i + 1 < line.size())
+            i++;
+        tag.second += line[i];
+    }
+    return !tag.first.empty();
+}
+
+} // namespace
+
+bool PGN_READER::addToken(const std::string& token, PgnGame& game) {
+    if (token.empty() || variationDepth > 0 || token[0] == '$' || allDigits(token))
+        return false;
+    if (isResult(token)) {
+        game.result = token;
+        return true;
+    }
+    game.moves.push_back(token);
+    return false;
+}
+
+bool PGN_READER::readMovetext(const std::string& line, PgnGame& game) {
+    std::string token;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (inComment) {
+            if (c == '}') {
+                inComment = false;
+                if (!game.comments.empty() && !game.comments.back().empty() && game.comments.back().back() == ' ')
+                    game.comments.back().pop_back();
+            } else if (variationDepth == 0) {
+                appendComment(game, c);
+            }
+            continue;
+        }
+        if (c == '{' || c == ';' || c == '(' || c == ')' || c == '.' || std::isspace((unsigned char)c)) {
+            // A '.' ends a move number ("12." or "12..."); anything else ends any token.
+            if (c == '.' && !allDigits(token) && !token.empty()) {
+                token += c;
+                continue;
+            }
+            if (c == '.' && allDigits(token)) {
+                token.clear();
+                continue;
+            }
+            if (addToken(token, game))
+                return true;
+            token.clear();
+            if (c == '{') {
+                inComment = true;
+                if (variationDepth == 0)
+                    appendComment(game, ' ');
+            }
+            else if (c == ';')
+                break;
+            else if (c == '(')
+                variationDepth++;
+            else if (c == ')' && variationDepth > 0)
+                variationDepth--;
+            continue;
+        }
+        token += c;
+    }
+    // A comment that continues on the next line.
+    if (inComment && variationDepth == 0)
+        appendComment(game, ' ');
+    return addToken(token, game);
+}
+
+bool PGN_READER::next(PgnGame& game) {
+    game.clear();
+    inComment = false;
+    variationDepth = 0;
+    bool started = false;       // Any tag or movetext of this game has been seen.
+    bool inMovetext = false;
+    std::string line;
+    while (true) {
+        if (hasPendingLine) {
+            line = pendingLine;
+            hasPendingLine = false;
+        } else if (!std::getline(in, line)) {
+            break;
+        }
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        // Lines starting with '%' are escaped and ignored.
+        if (!line.empty() && line[0] == '%')
+            continue;
+
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos)
+            continue;
+        if (!inComment && line[first] == '[') {
+            if (inMovetext) {
+                // A game without a result token ends where the next one's tags begin.
+                pendingLine = line;
+                hasPendingLine = true;
+                return true;
+            }
+            std::pair<std::string, std::string> tag;
+            if (parseTag(line, tag))
+                game.tags.push_back(tag);
+            started = true;
+            continue;
+        }
+        started = true;
+        inMovetext = true;
+        if (readMovetext(line, game))
+            return true;
+    }
+    return started;
+}
+
+PgnGame recordGame(CHESSLOGIC& game) {
+    PgnGame record;
+    std::vector<MoveInfo> history = game.getMoveHistory();
+    const std::vector<short>& start = history.empty() ? game.getState() : history.front().priorGameState;
+    int firstMove = game.fullmoveNumber() - (int)(history.size() + (start[TURN_INDEX] < 0 ? 1 : 0)) / 2;
+    std::string fen = stateToFen(start, firstMove);
+    if (fen != START_FEN) {
+        record.setTag("SetUp", "1");
+        record.setTag("FEN", fen);
+    }
+    for (const MoveInfo& info : history)
+        record.moves.push_back(moveToSan(game, info.priorGameState, info.lastMove));
+
+    const std::vector<short>& state = game.getState();
+    bool whiteToMove = state[TURN_INDEX] > 0;
+    if (game.generateAllValidMoves(state).empty()) {
+        if (game.isKingInCheck(state, whiteToMove))
+            record.result = whiteToMove ? "0-1" : "1-0";
+        else
+            record.result = "1/2-1/2";
+    } else if (CHESSLOGIC::isInsufficientMaterial(state) || game.isDrawByRule()) {
+        record.result = "1/2-1/2";
+    } else {
+        record.result = "*";
+    }
+    return record;
+}
+
+// -----------------------
+// PGN_WRITER Implementation
+// -----------------------
+
+PGN_WRITER::PGN_WRITER(std::ostream& out) : out(out) {}
+
+namespace {
+
+std::string escapeTagValue(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+void PGN_WRITER::token(const std::string& text) {
+    if (!line.empty() && line.size() + 1 + text.size() > 79) {
+        out << line << '\n';
+        line.clear();
+    }
+    if (!line.empty())
+        line += ' ';
+    line += text;
+}
+
+void PGN_WRITER::write(const PgnGame& game) {
+    std::string result = game.result.empty() ? "*" : game.result;
+    static const char* const roster[] = { "Event", "Site", "Date", "Round", "White", "Black", "Result" };
+    for (const char* name : roster) {
+        std::string value = (std::string(name) == "Result") ? result : game.tag(name);
+        if (value.empty())
+            value = (std::string(name) == "Date") ? "????.??.??" : "?";
+        out << "[" << name << " \"" << escapeTagValue(value) << "\"]\n";
+    }
+    for (const auto& tag : game.tags) {
+        bool inRoster = false;
+        for (const char* name : roster)
+            inRoster |= (tag.first == name);
+        if (!inRoster)
+            out << "[" << tag.first << " \"" << escapeTagValue(tag.second) << "\"]\n";
+    }
+    out << '\n';
+
+    // Move numbers follow the FEN tag; a black move gets "N..." at the start and after a comment.
+    std::vector<short> start;
+    int moveNumber = 1;
+    bool whiteToMove = true;
+    if (game.startPosition(start, moveNumber))
+        whiteToMove = start[TURN_INDEX] > 0;
+    bool needNumber = true;
+    line.clear();
+    for (size_t i = 0; i < game.moves.size(); i++) {
+        if (whiteToMove)
+            token(std::to_string(moveNumber) + ".");
+        else if (needNumber)
+            token(std::to_string(moveNumber) + "...");
+        token(game.moves[i]);
+        needNumber = false;
+        if (i < game.comments.size() && !game.comments[i].empty()) {
+            token("{" + game.comments[i] + "}");
+            needNumber = true;
+        }
+        if (!whiteToMove)
+            moveNumber++;
+        whiteToMove = !whiteToMove;
+    }
+    token(result);
+    out << line << "\n\n";
+    out.flush();
+    line.clear();
+}
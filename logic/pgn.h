@@ -0,0 +1,78 @@
+// pgn.h
+#ifndef PGN_H
+#define PGN_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct CHESSLOGIC;
+
+// One game as read from a PGN file: its tag pairs and the SAN moves of the main line.
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> tags;
+    std::vector<std::string> moves;
+    // Comment following each move (without braces); may be shorter than 'moves'.
+    std::vector<std::string> comments;
+    std::string result;     // "1-0", "0-1", "1/2-1/2" or "*".
+
+    // Returns the value of a tag, or an empty string if the game does not have it.
+    std::string tag(const std::string& name) const;
+    // Sets a tag, replacing an existing one of the same name.
+    void setTag(const std::string& name, const std::string& value);
+    // The position the moves start from: the FEN tag if present, else the standard start.
+    // Returns false if the FEN tag is malformed.
+    bool startPosition(std::vector<short>& state, int& fullmoveNumber) const;
+    void clear();
+};
+
+// Builds the record of a game played on a CHESSLOGIC: SAN moves from its history, a FEN
+// tag if it did not start from the standard position, and the result if the game is over
+// (checkmate, stalemate, insufficient material, threefold repetition or the fifty-move
+// rule); "*" otherwise.
+PgnGame recordGame(CHESSLOGIC& game);
+
+// PGN_READER walks a PGN stream one game at a time, holding only the current game in
+// memory, so arbitrarily large files can be processed. Comments, variations, NAGs and
+// move numbers are skipped.
+class PGN_READER {
+public:
+    explicit PGN_READER(std::istream& in);
+
+    // Read the next game; returns false once the input holds no further game.
+    bool next(PgnGame& game);
+
+private:
+    // Split one line of movetext into tokens; returns true when the game's result was read.
+    bool readMovetext(const std::string& line, PgnGame& game);
+    // Handle one complete token; returns true if it was the game's result.
+    bool addToken(const std::string& token, PgnGame& game);
+
+    std::istream& in;
+    // A tag line that already belongs to the next game.
+    std::string pendingLine;
+    bool hasPendingLine;
+    // Tokenizer state carried across lines.
+    bool inComment;
+    int variationDepth;
+};
+
+// PGN_WRITER writes games in export format: the seven-tag roster first, movetext wrapped
+// at 80 columns, comments in braces. Each game is flushed as soon as it is written.
+class PGN_WRITER {
+public:
+    explicit PGN_WRITER(std::ostream& out);
+
+    void write(const PgnGame& game);
+
+private:
+    // Append a movetext token, breaking the line before it would pass 79 characters.
+    void token(const std::string& text);
+
+    std::ostream& out;
+    std::string line;
+};
+
+#endif // PGN_H
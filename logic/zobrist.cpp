@@ -0,0 +1,70 @@
+#include "zobrist.h"
+#include "chesslogic.h"
+#include <cstdlib>
+
+namespace {
+
+struct ZobristKeys {
+    uint64_t pieceSquare[12][64];
+    uint64_t blackToMove;
+    uint64_t castling[16];
+    uint64_t enPassantFile[8];
+
+    ZobristKeys() {
+        // splitmix64 with a fixed seed. Analysis cache files (analysiscache.h) are keyed by
+        // these values, so the seed and the order the keys are drawn in are part of that file
+        // format; changing either calls for a new CACHE_MAGIC.
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        for (int p = 0; p < 12; p++)
+            for (int sq = 0; sq < 64; sq++)
+                pieceSquare[p][sq] = next(seed);
+        blackToMove = next(seed);
+        castling[0] = 0;
+        for (int i = 1; i < 16; i++)
+            castling[i] = next(seed);
+        for (int f = 0; f < 8; f++)
+            enPassantFile[f] = next(seed);
+    }
+
+    static uint64_t next(uint64_t& seed) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+const ZobristKeys& keys() {
+    static const ZobristKeys table;
+    return table;
+}
+
+} // namespace
+
+int zobristPieceIndex(short pieceCode) {
+    int index;
+    switch (std::abs(pieceCode)) {
+        case 1:   index = 0; break;
+        case 3:   index = 1; break;
+        case 5:   index = 2; break;
+        case 6:   index = 3; break;
+        case 9:   index = 4; break;
+        default:  index = 5; break; // King (127).
+    }
+    return (pieceCode > 0) ? index : index + 6;
+}
+
+uint64_t zobristHash(const std::vector<short>& state) {
+    const ZobristKeys& k = keys();
+    uint64_t hash = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        if (state[sq] != 0)
+            hash ^= k.pieceSquare[zobristPieceIndex(state[sq])][sq];
+    }
+    if (state[TURN_INDEX] < 0)
+        hash ^= k.blackToMove;
+    hash ^= k.castling[state[CASTLE_INDEX] & 15];
+    if (state[EP_INDEX] != NO_SQUARE)
+        hash ^= k.enPassantFile[state[EP_INDEX] % 8];
+    return hash;
+}
@@ -0,0 +1,17 @@
+// zobrist.h
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <vector>
+#include <cstdint>
+
+// Zobrist hashing of a state vector: one random key per (piece, square), one for the side
+// to move, one per castling-rights combination and one per en passant file, XOR-ed
+// together. The keys come from a fixed-seed generator so hashes are identical across runs
+// and builds.
+uint64_t zobristHash(const std::vector<short>& state);
+
+// Index (0-11) of a non-empty piece code in the key tables; white pieces first.
+int zobristPieceIndex(short pieceCode);
+
+#endif // ZOBRIST_H
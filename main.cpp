@@ -1,12 +1,102 @@
 #include "board/board.h"
 #include "logic/chesslogic.h"
+#include "logic/pgn.h"
+#include "logic/zobrist.h"
 #include "ai/chessAI.h"
+#include "utils/wakeup.h"
 #include <ncurses.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <iostream>
 #include <sstream>
 #include <utility>
 
-int main() {
+// Appends the game to a PGN file; the human plays White against the engine.
+static bool saveGame(CHESSLOGIC& game, const std::string& path) {
+    std::ofstream out(path.c_str(), std::ios::app);
+    if (!out)
+        return false;
+    PgnGame record = recordGame(game);
+    char date[16];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y.%m.%d", std::localtime(&now));
+    record.setTag("Event", "terminalChessAI game");
+    record.setTag("Date", date);
+    record.setTag("Round", "-");
+    record.setTag("White", "Human");
+    record.setTag("Black", "terminalChessAI");
+    PGN_WRITER writer(out);
+    writer.write(record);
+    return true;
+}
+
+// Formats a line of moves as "e2-e4 e7-e5 ...".
+static std::string formatLine(BOARD& board, const std::vector<std::pair<short, short>>& moves) {
+    std::string text;
+    for (const auto &move : moves)
+        text += " " + board.indexToNotation(move.first) + "-" + board.indexToNotation(move.second);
+    return text;
+}
+
+// Shows the engine's latest progress while it thinks; with MultiPV the other ranked lines
+// follow on the rows below.
+static void drawThinking(WINDOW* debugWin, BOARD& board, const SearchInfo& info, bool pondering) {
+    std::ostringstream line;
+    line << (pondering ? "Pondering... depth " : "Thinking... depth ") << info.depth << "  eval " << formatScore(info.score)
+         << " (side to move)  nodes " << info.nodes << "  pv" << formatLine(board, info.pv);
+    wmove(debugWin, 0, 1);
+    wclrtoeol(debugWin);
+    mvwprintw(debugWin, 0, 1, "%s", line.str().c_str());
+    for (size_t i = 1; i < info.lines.size(); i++) {
+        std::string ranked = std::to_string(i + 1) + ". " + formatScore(info.lines[i].score)
+                             + formatLine(board, info.lines[i].pv);
+        wmove(debugWin, (int)i, 1);
+        wclrtoeol(debugWin);
+        mvwprintw(debugWin, (int)i, 1, "%s", ranked.c_str());
+    }
+    wrefresh(debugWin);
+}
+
+int main(int argc, char** argv) {
+    // Optional settings: chess --depth N --book FILE --tb DIR --fen FEN --pgn FILE
+    //                          --trace FILE --trace-ply N --multipv N --cache FILE
+    //                          --nnue FILE --weights FILE
+    int aiDepth = 4, tracePly = 2, multiPV = 1;
+    std::string bookFile, tablebaseDir, startFen, pgnFile, traceFile, cacheFile, networkFile, weightsFile;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "--depth") == 0)
+            aiDepth = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--book") == 0)
+            bookFile = argv[++i];
+        else if (std::strcmp(argv[i], "--tb") == 0)
+            tablebaseDir = argv[++i];
+        else if (std::strcmp(argv[i], "--fen") == 0)
+            startFen = argv[++i];
+        else if (std::strcmp(argv[i], "--pgn") == 0)
+            pgnFile = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0)
+            traceFile = argv[++i];
+        else if (std::strcmp(argv[i], "--trace-ply") == 0)
+            tracePly = std::max(0, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--multipv") == 0)
+            multiPV = std::max(1, std::min(std::atoi(argv[++i]), MAX_MOVES));
+        else if (std::strcmp(argv[i], "--cache") == 0)
+            cacheFile = argv[++i];
+        else if (std::strcmp(argv[i], "--nnue") == 0)
+            networkFile = argv[++i];
+        else if (std::strcmp(argv[i], "--weights") == 0)
+            weightsFile = argv[++i];
+    }
+
     // Initialize ncurses.
     initscr();
     cbreak();
@@ -25,44 +115,168 @@ int main() {
     // Create game objects.
     BOARD board;
     CHESSLOGIC game;
+    if (!startFen.empty() && !game.setFen(startFen)) {
+        endwin();
+        std::cerr << "invalid FEN " << startFen << std::endl;
+        return 1;
+    }
     ChessAI ai;
+    ai.defaultDepth = aiDepth;
+    ai.multiPV = multiPV;
+    if (!bookFile.empty() && !ai.setBook(bookFile)) {
+        endwin();
+        std::cerr << "cannot open book " << bookFile << std::endl;
+        return 1;
+    }
+    if (!tablebaseDir.empty())
+        ai.setTablebasePath(tablebaseDir);
+    if (!weightsFile.empty() && !ai.setEvalWeights(weightsFile)) {
+        endwin();
+        std::cerr << "cannot read weights " << weightsFile << std::endl;
+        return 1;
+    }
+    if (!networkFile.empty() && !ai.setEvalFile(networkFile)) {
+        endwin();
+        std::cerr << "cannot load network " << networkFile << std::endl;
+        return 1;
+    }
+    if (!cacheFile.empty() && !ai.setAnalysisCache(cacheFile, CACHE_DEFAULT_MEGABYTES)) {
+        endwin();
+        std::cerr << "cannot map analysis cache " << cacheFile << std::endl;
+        return 1;
+    }
+    ai.tracePly = tracePly;
+    if (!traceFile.empty() && !ai.setTraceFile(traceFile)) {
+        endwin();
+        std::cerr << "cannot write trace " << traceFile << std::endl;
+        return 1;
+    }
 
-    // Set non-blocking input.
+    // Non-blocking reads: the loop below blocks in poll() instead, and drains every
+    // pending key or mouse event with getch() once stdin becomes readable.
     nodelay(stdscr, TRUE);
+    // Engine-completion events arrive through this pipe.
+    WAKEUP_PIPE wakeup;
+
+    // The engine searches on a worker thread. It reports progress and completion through
+    // these shared values and a wakeup; all ncurses calls stay on this thread.
+    std::mutex progressMutex;
+    SearchInfo progress;
+    bool progressUpdated = false;
+    std::atomic<bool> searchFinished(false);
+    ai.onIteration = [&](const SearchInfo& info) {
+        {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            progress = info;
+            progressUpdated = true;
+        }
+        wakeup.notify();
+    };
 
     MEVENT event;
     int ch;
     bool awaitingSecondClick = false;
     std::pair<short, short> moveIndex;
     short highlightedSquare = -1;
+    bool dirty = true;     // The screen no longer matches the game state.
+    bool running = true;
+    // While the human thinks, the engine searches the reply it expects ('ponderMove').
+    bool pondering = false;
+    std::pair<short, short> ponderMove;
 
-    while ((ch = getch()) != 'q') {
-        // Always redraw the board.
-        board.draw(game.getState(), boardWin);
-        board.drawInfo(game.getMoveHistory(), boardWin);
-        board.drawUndoButton(boardWin);
-        // Reapply the highlight if a square is selected.
-        if (highlightedSquare != -1) {
-            board.highlight(game.getState(), highlightedSquare, boardWin);
+    // Cancels a running search and throws its result away.
+    auto abandonSearch = [&]() {
+        if (ai.isSearching()) {
+            ai.stop();
+            ai.waitForResult();
+            searchFinished = false;
         }
-        wrefresh(boardWin);
+        pondering = false;
+    };
 
-        // If it's AI's turn (Black is AI-controlled).
-        if (game.turnToMove() < 0) {
-            // Let the AI compute its best move.
-            std::pair<short, short> bestMove = ai.getBestMove(game);
+    while (running) {
+        // Redraw only when something changed since the last frame.
+        if (dirty) {
+            // The board only repaints the squares and lines that changed since the last frame.
+            // The selected piece's legal destinations come straight from the legal-move index.
+            uint64_t targets = highlightedSquare >= 0 ? game.legalDestinations(highlightedSquare) : 0;
+            board.draw(game.getState(), highlightedSquare, targets, boardWin);
+            board.drawInfo(recordGame(game), boardWin);
+            board.drawUndoButton(boardWin);
+            wrefresh(boardWin);
+            dirty = false;
+        }
+
+        // If it's AI's turn (Black is AI-controlled), start thinking in the background.
+        if (game.turnToMove() < 0 && !game.gameOver() && !ai.isSearching()) {
+            wclear(debugWin);
+            mvwprintw(debugWin, 0, 1, "Thinking...  [m] move now  [u] undo  [q] quit");
+            wrefresh(debugWin);
+            SearchLimits limits;
+            limits.history = game.getPositionKeys();
+            ai.startSearch(game.getState(), limits, [&]() {
+                searchFinished = true;
+                wakeup.notify();
+            });
+        }
+
+        // Sleep until the user does something or the engine reports progress or completion.
+        struct pollfd fds[2];
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        fds[1].fd = wakeup.readFd();
+        fds[1].events = POLLIN;
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+            break;
+        if (fds[1].revents & POLLIN)
+            wakeup.drain();
+
+        {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            if (progressUpdated && !searchFinished)
+                drawThinking(debugWin, board, progress, pondering);
+            progressUpdated = false;
+        }
+
+        if (searchFinished) {
+            // The engine finished (or was told to move now): play its move.
+            searchFinished = false;
+            std::pair<short, short> bestMove = ai.waitForResult();
 
             // Update the debug window.
             wclear(debugWin);
             std::ostringstream debugStream;
-            debugStream << "AI Move: " << bestMove.first << " -> " << bestMove.second << "\n";
-            debugStream << "Root Evaluation: " << ai.getRootEvaluation() << "\n";
+            debugStream << "AI Move: " << board.indexToNotation(bestMove.first) << "-"
+                        << board.indexToNotation(bestMove.second) << "\n";
+            debugStream << "Root Evaluation: " << formatScore(ai.getRootEvaluation()) << "\n";
+            if (SEARCH_STATS_ENABLED) {
+                SearchStats stats = ai.getSearchStats();
+                char statsText[512];
+                std::snprintf(statsText, sizeof(statsText),
+                              "Nodes: %lld  QNodes: %lld  NPS: %lld  Time: %lld ms\n"
+                              "Depth: %zu  Seldepth: %d\n"
+                              "Beta cutoffs: %.1f%%  First-move cutoffs: %.1f%%\n"
+                              "TT probes: %lld  Hits: %.1f%%  Cutoffs: %.1f%%\n",
+                              stats.nodes, stats.qnodes, stats.timeMs > 0 ? stats.nodes * 1000 / stats.timeMs : stats.nodes,
+                              stats.timeMs, stats.iterationMs.size(), stats.seldepth,
+                              SearchStats::percent(stats.betaCutoffs, stats.expanded),
+                              SearchStats::percent(stats.firstMoveCutoffs, stats.betaCutoffs),
+                              stats.ttProbes, SearchStats::percent(stats.ttHits, stats.ttProbes),
+                              SearchStats::percent(stats.ttCutoffs, stats.ttProbes));
+                debugStream << statsText << "Iteration times (ms):";
+                for (long long ms : stats.iterationMs)
+                    debugStream << " " << ms;
+                debugStream << "\n";
+            }
+            // The ranked root moves (one unless --multipv), scored for the engine's side.
+            std::vector<RootLine> lines = ai.getRootLines();
+            debugStream << "Best lines (eval for the side to move):\n";
+            for (size_t i = 0; i < lines.size(); i++)
+                debugStream << (i + 1) << ". " << formatScore(lines[i].score) << formatLine(board, lines[i].pv) << "\n";
             debugStream << "Valid Moves at Root: " << game.allValidMoves.size() << "\n";
 
             // Loop through each valid move and convert it to standard notation.
             for (const auto &move : game.allValidMoves) {
-                // Assuming you have a function to convert an index to chess notation, for example:
-                // std::string indexToNotation(short index);
                 std::string sourceNotation = board.indexToNotation(move.first);
                 std::string destNotation = board.indexToNotation(move.second);
                 debugStream << sourceNotation << "-" << destNotation << "\n";
@@ -70,23 +284,50 @@ int main() {
 
             mvwprintw(debugWin, 1, 1, "%s", debugStream.str().c_str());
             wrefresh(debugWin);
-            napms(1000); // Pause briefly.
 
             game.move(bestMove);
             highlightedSquare = -1; // Clear any highlight since board has changed.
-            board.draw(game.getState(), boardWin);
-            board.drawInfo(game.getMoveHistory(), boardWin);
-            board.drawUndoButton(boardWin);
-            wrefresh(boardWin);
+            awaitingSecondClick = false;
+            dirty = true;
 
-            napms(1000); // Pause briefly.
-            continue;   // Skip further input processing during AI turn.
+            // Ponder: search the position after the reply predicted by the principal variation.
+            std::vector<std::pair<short, short>> pv = ai.getPrincipalVariation();
+            if (pv.size() >= 2 && !game.gameOver() && pv[0] == bestMove &&
+                std::find(game.allValidMoves.begin(), game.allValidMoves.end(), pv[1]) != game.allValidMoves.end()) {
+                ponderMove = pv[1];
+                std::vector<short> ponderState = game.getState();
+                CHESSLOGIC::applyMove(ponderState, ponderMove);
+                SearchLimits ponderLimits;
+                ponderLimits.ponder = true;
+                ponderLimits.history = game.getPositionKeys();
+                ponderLimits.history.push_back(zobristHash(ponderState));
+                pondering = true;
+                ai.startSearch(ponderState, ponderLimits, [&]() {
+                    searchFinished = true;
+                    wakeup.notify();
+                });
+            }
         }
 
-        // Process human input.
-        if (ch == KEY_MOUSE) {
-            if (getmouse(&event) == OK) {
-                if (board.clickInside(event.x, event.y)) {
+        // Process all pending human input (a resize signal also surfaces here as KEY_RESIZE).
+        while (running && (ch = getch()) != ERR) {
+            bool undoRequested = false;
+            if (ch == 'q') {
+                running = false;
+            } else if (ch == 'm') {
+                // Move now: the search returns its best move so far through the usual wakeup.
+                if (ai.isSearching() && !pondering)
+                    ai.stop();
+            } else if (ch == 'u') {
+                undoRequested = true;
+            } else if (ch == KEY_RESIZE) {
+                wclear(boardWin);
+                board.invalidate();
+                dirty = true;
+            } else if (ch == KEY_MOUSE && getmouse(&event) == OK) {
+                // Board clicks only count while the human (White) is on move, not while the
+                // engine searches its reply.
+                if (game.turnToMove() > 0 && board.clickInside(event.x, event.y)) {
                     short clickedIndex = board.getClickedPieceIndex(game.getState(), event.x, event.y);
                     if (!awaitingSecondClick) {
                         if (!game.playerMovingEnemyPiece(clickedIndex, game.turnToMove())) {
@@ -94,33 +335,56 @@ int main() {
                             highlightedSquare = clickedIndex; // Save highlighted square.
                             awaitingSecondClick = true;
                         }
+                    } else if (!game.playerMovingEnemyPiece(clickedIndex, game.turnToMove())) {
+                        // Another own piece: select it instead.
+                        moveIndex.first = clickedIndex;
+                        highlightedSquare = clickedIndex;
                     } else {
                         moveIndex.second = clickedIndex;
                         game.move(moveIndex);
                         awaitingSecondClick = false;
                         highlightedSquare = -1; // Clear highlight after move.
-                        board.draw(game.getState(), boardWin);
-                        board.drawInfo(game.getMoveHistory(), boardWin);
-                        board.drawUndoButton(boardWin);
-                        wrefresh(boardWin);
+                        if (pondering && game.turnToMove() < 0) {
+                            if (moveIndex == ponderMove) {
+                                // Ponder hit: keep the search (and everything it found) running.
+                                ai.ponderHit();
+                                pondering = false;
+                                mvwprintw(debugWin, 0, 1, "Ponder hit - thinking...  [m] move now  [u] undo  [q] quit");
+                                wrefresh(debugWin);
+                            } else {
+                                // Ponder miss: start again from the position actually reached.
+                                abandonSearch();
+                            }
+                        }
                     }
+                    dirty = true;
                 } else if (board.clickUndoButton(event.x, event.y)) {
-                    game.undoMove();
-                    highlightedSquare = -1; // Clear highlight.
-                    board.draw(game.getState(), boardWin);
-                    board.drawInfo(game.getMoveHistory(), boardWin);
-                    board.drawUndoButton(boardWin);
-                    wrefresh(boardWin);
+                    undoRequested = true;
                 }
             }
+            if (undoRequested) {
+                // Undo while thinking takes back the human move the engine was answering.
+                abandonSearch();
+                game.undoMove();
+                highlightedSquare = -1; // Clear highlight.
+                awaitingSecondClick = false;
+                dirty = true;
+            }
         }
-        napms(50); // Delay to reduce CPU usage.
     }
 
+    abandonSearch();
+
     // Clean up.
     delwin(boardWin);
     delwin(debugWin);
     endwin();
+
+    // The game played (finished or not) is appended to the PGN file.
+    if (!pgnFile.empty() && !game.getMoveHistory().empty() && !saveGame(game, pgnFile)) {
+        std::cerr << "cannot write " << pgnFile << std::endl;
+        return 1;
+    }
     return 0;
 }
 
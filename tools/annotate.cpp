@@ -0,0 +1,206 @@
+// annotate.cpp
+// Batch game analysis: streams the games of one or more PGN files through a pool of
+// engines and writes them back with an evaluation comment after every move. Only the games
+// being analysed are held in memory, so archives of any size can be processed.
+//
+// Usage: chess_annotate [--nodes N] [--movetime MS] [--depth N] [--concurrency N]
+//                       [--hash MB] [--out FILE] PGN...
+// Each comment reads "{+0.35/6}" (White's view of the position after the move, and the
+// search depth); when the engine prefers another move it is added: "{-1.20/6 best Nf3 +0.15}".
+// Without a limit every position is searched with --depth 4.
+
+#include "../ai/chessAI.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../logic/pgn.h"
+#include "../logic/zobrist.h"
+#include "../utils/threadpool.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+
+// Per-worker analysis resources.
+struct Analyser {
+    ChessAI ai;
+    CHESSLOGIC logic;
+    int lastDepth;   // Depth of the last completed iteration, set through onIteration.
+
+    Analyser() : lastDepth(0) {
+        ai.onIteration = [this](const SearchInfo& info) { lastDepth = info.depth; };
+    }
+};
+
+// Result of searching one position.
+struct PositionEval {
+    int score;                       // White's point of view (mate scores as in score.h).
+    int depth;
+    std::pair<short, short> best;
+    bool hasMove;                    // False at checkmate or stalemate.
+};
+
+static PositionEval evaluate(Analyser& analyser, const std::vector<short>& state, const SearchLimits& limits) {
+    PositionEval eval;
+    eval.depth = 0;
+    eval.hasMove = !analyser.logic.generateAllValidMoves(state).empty();
+    if (!eval.hasMove) {
+        // Game over: mated (from the side to move's view) or stalemate.
+        bool whiteToMove = state[TURN_INDEX] > 0;
+        bool mated = analyser.logic.isKingInCheck(state, whiteToMove);
+        eval.score = mated ? (whiteToMove ? matedIn(0) : mateIn(0)) : 0;
+        return eval;
+    }
+    analyser.lastDepth = 0;
+    eval.best = analyser.ai.search(state, limits);
+    eval.score = analyser.ai.getRootEvaluation();
+    eval.depth = analyser.lastDepth;
+    return eval;
+}
+
+// Annotates the moves of 'game' that can be replayed; moves after an unreadable one are
+// kept as they are.
+static void annotateGame(Analyser& analyser, PgnGame& game, const SearchLimits& limits) {
+    std::vector<short> state;
+    int fullmove;
+    if (!game.startPosition(state, fullmove))
+        return;
+    analyser.ai.clearHash();
+    game.comments.resize(game.moves.size());
+    // Each position is searched with the game that led to it, so repetitions count as draws.
+    SearchLimits gameLimits = limits;
+    gameLimits.history.assign(1, zobristHash(state));
+    PositionEval before = evaluate(analyser, state, gameLimits);
+    for (size_t i = 0; i < game.moves.size(); i++) {
+        std::pair<short, short> move;
+        if (!parseSanMove(analyser.logic, state, game.moves[i], move))
+            break;
+        std::vector<short> after = state;
+        CHESSLOGIC::applyMove(after, move);
+        gameLimits.history.push_back(zobristHash(after));
+        PositionEval next = evaluate(analyser, after, gameLimits);
+
+        std::string comment = formatScore(next.score) + "/" + std::to_string(next.depth);
+        if (before.hasMove && before.best != move)
+            comment += " best " + moveToSan(analyser.logic, state, before.best) + " " + formatScore(before.score);
+        // Comments already in the game are kept in front of the evaluation.
+        game.comments[i] = game.comments[i].empty() ? comment : game.comments[i] + " " + comment;
+        state = after;
+        before = next;
+    }
+}
+
+static void printUsage() {
+    std::cerr << "usage: chess_annotate [--nodes N] [--movetime MS] [--depth N] [--concurrency N]\n"
+                 "                      [--hash MB] [--out FILE] PGN...\n";
+}
+
+int main(int argc, char** argv) {
+    SearchLimits limits;
+    size_t concurrency = THREADPOOL::hardwareThreads();
+    int hashMegabytes = 16;
+    std::string outFile;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool isOption = arg.compare(0, 2, "--") == 0;
+        if (isOption && i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        if (arg == "--nodes")             limits.nodes = std::atoll(argv[++i]);
+        else if (arg == "--movetime")     limits.movetime = std::atoi(argv[++i]);
+        else if (arg == "--depth")        limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--concurrency")  concurrency = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash")         hashMegabytes = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--out")          outFile = argv[++i];
+        else if (isOption) {
+            printUsage();
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (limits.nodes == 0 && limits.movetime == 0 && limits.depth == 0)
+        limits.depth = 4;
+
+    std::ofstream outStream;
+    if (!outFile.empty()) {
+        outStream.open(outFile.c_str());
+        if (!outStream) {
+            std::cerr << "cannot write " << outFile << "\n";
+            return 1;
+        }
+    }
+    PGN_WRITER writer(outFile.empty() ? std::cout : outStream);
+
+    THREADPOOL pool(concurrency);
+    std::vector<std::unique_ptr<Analyser>> analysers;
+    for (size_t i = 0; i < pool.size(); i++) {
+        analysers.push_back(std::unique_ptr<Analyser>(new Analyser()));
+        analysers.back()->ai.setHashSize(hashMegabytes);
+    }
+
+    // Games are written in input order: finished games wait in 'done' until every earlier
+    // game has been written. At most 'maxInFlight' games are read ahead of the writer.
+    const size_t maxInFlight = pool.size() * 4;
+    std::mutex mutex;
+    std::condition_variable slotFree;
+    std::map<long long, PgnGame> done;
+    long long nextToWrite = 0, gameCount = 0, moveCount = 0;
+    size_t inFlight = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& input : inputs) {
+        std::ifstream file(input.c_str());
+        if (!file) {
+            std::cerr << "cannot open " << input << "\n";
+            continue;
+        }
+        PGN_READER reader(file);
+        PgnGame game;
+        while (reader.next(game)) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                slotFree.wait(lock, [&]() { return inFlight < maxInFlight; });
+                inFlight++;
+            }
+            long long index = gameCount++;
+            moveCount += game.moves.size();
+            pool.submit([&, index, game](size_t worker) mutable {
+                annotateGame(*analysers[worker], game, limits);
+                game.setTag("Annotator", "terminalChessAI");
+                std::lock_guard<std::mutex> lock(mutex);
+                done[index] = std::move(game);
+                for (auto next = done.find(nextToWrite); next != done.end(); next = done.find(nextToWrite)) {
+                    writer.write(next->second);
+                    done.erase(next);
+                    nextToWrite++;
+                    inFlight--;
+                }
+                slotFree.notify_one();
+            });
+        }
+    }
+    pool.wait();
+    double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+    char summary[200];
+    std::snprintf(summary, sizeof(summary), "games %lld  moves %lld  time %.1fs  games/s %.2f  games/s/core %.2f",
+                  gameCount, moveCount, seconds, seconds > 0 ? gameCount / seconds : 0.0,
+                  seconds > 0 ? gameCount / seconds / pool.size() : 0.0);
+    std::cerr << summary << std::endl;
+    return 0;
+}
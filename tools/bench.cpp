@@ -0,0 +1,483 @@
+// bench.cpp
+// Component microbenchmarks: times the move generator, the check test, the evaluation,
+// the move-ordering heuristic and the alpha-beta search in isolation over a fixed corpus
+// of opening, middlegame, endgame and tactical positions, and reports ns/op and ops/s.
+//
+// Usage: chess_bench [--json] [--min-time MS] [--depth N] [--filter NAME] [--nnue FILE]
+//                    [--verify] [--write-nnue FILE]
+// --min-time is the minimum run time of each benchmark on each category (default 300 ms);
+// --depth is the depth of the search benchmark (default 3), whose op is one node.
+// --nnue adds the network evaluation (full refresh, and incremental update per legal move)
+// for every kernel the CPU supports, and a search benchmark that evaluates with it.
+// --verify checks the network instead of timing it: the legal-move trees of the corpus (and
+// of a few positions with every special move) are walked to --depth, carrying accumulators
+// down by update() as the search does, and at every node the result is compared with a
+// refresh() and every supported kernel with the scalar one. The exit status is 1 on a
+// mismatch. --write-nnue writes a network of pseudo-random weights (fixed seed) to check the
+// pipeline with when no trained one is at hand; it plays nonsense.
+// With --json the results are printed as one JSON object, so runs can be diffed.
+// Every benchmark also reports its heap allocations per op, counted after one warm-up pass;
+// the search is expected to report zero.
+
+#include "../ai/chessAI.h"
+#include "../ai/transposition.h"
+#include "../ai/nnue.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <atomic>
+#include <fstream>
+#include <new>
+#include <random>
+
+// ---- Allocation counter ----
+// Replacing the global allocation functions routes every heap allocation of the process
+// through this counter.
+static std::atomic<long long> allocationCount(0);
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size ? size : 1))
+        return block;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete[](void* block) noexcept { std::free(block); }
+void operator delete(void* block, std::size_t) noexcept { std::free(block); }
+void operator delete[](void* block, std::size_t) noexcept { std::free(block); }
+
+// The fixed corpus. Changing it changes every number, so add positions rather than edit them.
+struct BenchPosition {
+    const char* category;
+    const char* fen;
+};
+
+static const BenchPosition CORPUS[] = {
+    { "opening",    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+    { "opening",    "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3" },
+    { "opening",    "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5" },
+    { "middlegame", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "middlegame", "r1bq1rk1/pp2bppp/2n1pn2/2pp4/2PP4/2N1PN2/PP1QBPPP/R1B2RK1 w - - 0 9" },
+    { "middlegame", "2r2rk1/1bqnbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 0 14" },
+    { "endgame",    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+    { "endgame",    "8/8/4k3/3p4/3P1K2/8/5P2/8 w - - 0 1" },
+    { "endgame",    "6k1/5pp1/8/8/8/8/r4PPP/1R4K1 w - - 0 1" },
+    { "tactical",   "2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4qK1 w - - 0 1" },
+    { "tactical",   "r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1" },
+    { "tactical",   "5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1" },
+};
+
+static const char* const CATEGORIES[] = { "opening", "middlegame", "endgame", "tactical" };
+
+// Extra positions for --verify only, with castling on both wings, en passant captures and
+// promotions (with and without capture) within the first two plies.
+static const char* const VERIFY_FENS[] = {
+    "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "8/8/8/8/2pP4/8/8/K1k5 b - d3 0 1",
+    "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+};
+
+struct BenchResult {
+    std::string name;
+    std::string category;
+    long long ops;
+    double seconds;
+    long long allocations;
+
+    double nsPerOp() const { return ops > 0 ? seconds * 1e9 / ops : 0; }
+    double opsPerSec() const { return seconds > 0 ? ops / seconds : 0; }
+    double allocationsPerOp() const { return ops > 0 ? (double)allocations / ops : 0; }
+};
+
+// A prepared position: its state and legal moves, computed once outside the timed loops.
+struct Prepared {
+    std::vector<short> state;
+    std::vector<std::pair<short, short>> moves;
+};
+
+// Keeps the optimizer from discarding the benchmarked calls.
+static volatile long long sink;
+
+// Repeats 'pass' (one sweep over the positions, returning the ops it performed) until
+// at least 'minTimeMs' have passed. A first, untimed pass warms up caches and buffers.
+template <typename Pass>
+static BenchResult runBench(const std::string& name, const std::string& category, int minTimeMs, Pass pass) {
+    BenchResult result;
+    result.name = name;
+    result.category = category;
+    result.ops = 0;
+    pass();
+    long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        result.ops += pass();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed * 1000 < minTimeMs);
+    result.seconds = elapsed;
+    result.allocations = allocationCount.load() - allocationsBefore;
+    return result;
+}
+
+static void printUsage() {
+    std::cerr << "usage: chess_bench [--json] [--min-time MS] [--depth N] [--filter NAME] [--nnue FILE]\n"
+                 "                   [--verify] [--write-nnue FILE]\n";
+}
+
+// ---- Network checks ----
+
+// Writes a network in the format of ai/nnue.h with weights drawn from a fixed seed. The
+// feature transformer's are kept small so the accumulators span the clipped range.
+static bool writeRandomNetwork(const std::string& path) {
+    std::mt19937 random(20240613);
+    std::ofstream out(path.c_str(), std::ios::binary);
+    auto put = [&out](const void* data, size_t size) { out.write(static_cast<const char*>(data), size); };
+    auto fill = [&](size_t count, size_t size, int low, int high) {
+        std::uniform_int_distribution<int> value(low, high);
+        for (size_t i = 0; i < count; i++) {
+            int32_t v = value(random);
+            put(&v, size);  // Little-endian: the low bytes come first.
+        }
+    };
+    put(NNUE_MAGIC, sizeof(NNUE_MAGIC));
+    const uint32_t dimensions[5] = { (uint32_t)NNUE_INPUTS, (uint32_t)NNUE_HIDDEN, (uint32_t)NNUE_L2,
+                                     (uint32_t)NNUE_L3, (uint32_t)NNUE_FEATURES_PER_KING };
+    put(dimensions, sizeof(dimensions));
+    fill(NNUE_HIDDEN, 2, -16, 64);
+    fill((size_t)NNUE_INPUTS * NNUE_HIDDEN, 2, -12, 12);
+    fill(NNUE_L2, 4, -2000, 2000);
+    fill((size_t)NNUE_L2 * 2 * NNUE_HIDDEN, 1, -128, 127);
+    fill(NNUE_L3, 4, -2000, 2000);
+    fill((size_t)NNUE_L3 * NNUE_L2, 1, -128, 127);
+    fill(1, 4, -2000, 2000);
+    fill(NNUE_L3, 1, -128, 127);
+    return (bool)out;
+}
+
+struct VerifyStats {
+    long long nodes, castles, enPassants, promotions, kingMoves, mismatches;
+    VerifyStats() : nodes(0), castles(0), enPassants(0), promotions(0), kingMoves(0), mismatches(0) {}
+};
+
+static bool sameHalf(const NnueAccumulator& a, const NnueAccumulator& b, int side) {
+    return a.kingSquare[side] == b.kingSquare[side]
+        && std::memcmp(a.values[side], b.values[side], sizeof(a.values[side])) == 0;
+}
+
+// Checks every child of 'state' ('accumulator' is its incrementally built accumulator, both
+// halves computed with the scalar kernel) and recurses 'depth' plies.
+static void verifyTree(NNUE_NETWORK& network, const std::vector<NnueKernel>& kernels, CHESSLOGIC& logic,
+                       const std::vector<short>& state, const NnueAccumulator& accumulator, int depth,
+                       VerifyStats& stats) {
+    if (depth == 0)
+        return;
+    for (const auto& move : logic.generateAllValidMoves(state)) {
+        std::vector<short> child = state;
+        CHESSLOGIC::applyMove(child, move);
+        stats.nodes++;
+        int changed = 0;
+        for (int square = 0; square < 64; square++)
+            changed += (state[square] != child[square]);
+        short piece = state[move.first];
+        if (std::abs(piece) == 127 && changed == 4)
+            stats.castles++;
+        else if (std::abs(piece) == 127)
+            stats.kingMoves++;
+        else if (std::abs(piece) == 1 && changed == 3)
+            stats.enPassants++;
+        else if (std::abs(piece) == 1 && child[move.second] != piece)
+            stats.promotions++;
+
+        NnueAccumulator updated;
+        int score = 0;
+        for (NnueKernel kernel : kernels) {
+            network.setKernel(kernel);
+            NnueAccumulator incremental, refreshed;
+            bool ok = true;
+            for (int side = 0; side < 2; side++) {
+                network.update(state, accumulator, child, side, incremental);
+                network.refresh(child, side, refreshed);
+                ok = ok && sameHalf(incremental, refreshed, side);
+                if (kernel != KERNEL_SCALAR)
+                    ok = ok && sameHalf(incremental, updated, side);
+            }
+            int incrementalScore = network.evaluate(child, incremental);
+            ok = ok && incrementalScore == network.evaluate(child, refreshed);
+            if (kernel == KERNEL_SCALAR) {
+                updated = incremental;
+                score = incrementalScore;
+            } else {
+                ok = ok && incrementalScore == score;
+            }
+            if (!ok) {
+                if (stats.mismatches++ < 10)
+                    std::cerr << "mismatch (" << NNUE_NETWORK::kernelName(kernel) << ") after "
+                              << moveToUci(state, move) << " in " << stateToFen(state, 1) << "\n";
+            }
+        }
+        verifyTree(network, kernels, logic, child, updated, depth - 1, stats);
+    }
+}
+
+// Runs the checks from every corpus and verify position; returns false on a mismatch.
+static bool verifyNetwork(NNUE_NETWORK& network, CHESSLOGIC& logic, int depth) {
+    std::vector<NnueKernel> kernels;
+    const NnueKernel all[] = { KERNEL_SCALAR, KERNEL_SSSE3, KERNEL_AVX2 };
+    for (NnueKernel kernel : all) {
+        if (NNUE_NETWORK::kernelSupported(kernel))
+            kernels.push_back(kernel);
+    }
+    std::vector<std::string> fens;
+    for (const BenchPosition& entry : CORPUS)
+        fens.push_back(entry.fen);
+    fens.insert(fens.end(), std::begin(VERIFY_FENS), std::end(VERIFY_FENS));
+
+    VerifyStats stats;
+    for (const std::string& fen : fens) {
+        std::vector<short> state;
+        int fullmove;
+        if (!parseFen(fen, state, fullmove)) {
+            std::cerr << "bad FEN " << fen << "\n";
+            return false;
+        }
+        network.setKernel(KERNEL_SCALAR);
+        NnueAccumulator root;
+        network.refresh(state, 0, root);
+        network.refresh(state, 1, root);
+        verifyTree(network, kernels, logic, state, root, depth, stats);
+    }
+    network.setKernel(NNUE_NETWORK::bestKernel());
+
+    std::printf("nnue verify: %zu roots to depth %d, %lld positions (%lld castles, %lld en passant, "
+                "%lld promotions, %lld other king moves)\nkernels:", fens.size(), depth, stats.nodes,
+                stats.castles, stats.enPassants, stats.promotions, stats.kingMoves);
+    for (NnueKernel kernel : kernels)
+        std::printf(" %s", NNUE_NETWORK::kernelName(kernel));
+    std::printf("\n%lld mismatches\n", stats.mismatches);
+    return stats.mismatches == 0;
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    int minTimeMs = 300, searchDepth = 3;
+    bool verify = false;
+    std::string filter, networkFile, writeFile;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--min-time" && i + 1 < argc)
+            minTimeMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--depth" && i + 1 < argc)
+            searchDepth = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--nnue" && i + 1 < argc)
+            networkFile = argv[++i];
+        else if (arg == "--write-nnue" && i + 1 < argc)
+            writeFile = argv[++i];
+        else if (arg == "--verify")
+            verify = true;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!writeFile.empty()) {
+        if (!writeRandomNetwork(writeFile)) {
+            std::cerr << "cannot write " << writeFile << "\n";
+            return 1;
+        }
+        if (networkFile.empty() && !verify)
+            return 0;
+    }
+    if (verify && networkFile.empty() && writeFile.empty()) {
+        std::cerr << "--verify needs a network (--nnue FILE or --write-nnue FILE)\n";
+        return 1;
+    }
+    if (networkFile.empty())
+        networkFile = writeFile;
+
+    CHESSLOGIC logic;
+    ALPHA_BETA searcher;
+    TRANSPOSITION_TABLE tt(16);
+    SearchControl control;
+    searcher.tt = &tt;
+    searcher.control = &control;
+    NNUE_NETWORK network;
+    if (!networkFile.empty() && !network.load(networkFile)) {
+        std::cerr << "cannot load network " << networkFile << "\n";
+        return 1;
+    }
+    if (verify)
+        return verifyNetwork(network, logic, searchDepth) ? 0 : 1;
+    const NnueKernel kernels[] = { KERNEL_SCALAR, KERNEL_SSSE3, KERNEL_AVX2 };
+
+    std::vector<BenchResult> results;
+    for (const char* category : CATEGORIES) {
+        std::vector<Prepared> positions;
+        for (const BenchPosition& entry : CORPUS) {
+            if (std::string(entry.category) != category)
+                continue;
+            Prepared prepared;
+            int fullmove;
+            if (!parseFen(entry.fen, prepared.state, fullmove)) {
+                std::cerr << "bad corpus FEN " << entry.fen << "\n";
+                return 1;
+            }
+            prepared.moves = logic.generateAllValidMoves(prepared.state);
+            positions.push_back(prepared);
+        }
+        auto selected = [&](const std::string& name) { return filter.empty() || name.find(filter) != std::string::npos; };
+
+        if (selected("generateAllValidMoves")) {
+            // Into a reused list, as the search generates them.
+            std::vector<std::pair<short, short>> moves;
+            results.push_back(runBench("generateAllValidMoves", category, minTimeMs, [&]() {
+                for (const Prepared& p : positions) {
+                    logic.generateAllValidMoves(p.state, moves);
+                    sink += moves.size();
+                }
+                return (long long)positions.size();
+            }));
+        }
+        if (selected("checkAfterMove")) {
+            results.push_back(runBench("checkAfterMove", category, minTimeMs, [&]() {
+                long long ops = 0;
+                for (const Prepared& p : positions) {
+                    for (const auto& move : p.moves)
+                        sink += logic.checkAfterMove(p.state, move);
+                    ops += p.moves.size();
+                }
+                return ops;
+            }));
+        }
+        if (selected("evaluateNode")) {
+            NODE node;
+            EvalWeights weights;
+            results.push_back(runBench("evaluateNode", category, minTimeMs, [&]() {
+                for (const Prepared& p : positions) {
+                    node.state = p.state;
+                    node.evaluateNode(p.moves, weights);
+                    sink += node.evaluation;
+                }
+                return (long long)positions.size();
+            }));
+        }
+        for (NnueKernel kernel : kernels) {
+            if (!network.isLoaded() || !network.setKernel(kernel))
+                continue;
+            std::string suffix = std::string("/") + NNUE_NETWORK::kernelName(kernel);
+            if (selected("nnueRefresh" + suffix)) {
+                results.push_back(runBench("nnueRefresh" + suffix, category, minTimeMs, [&]() {
+                    for (const Prepared& p : positions)
+                        sink += network.evaluate(p.state);
+                    return (long long)positions.size();
+                }));
+            }
+            if (selected("nnueUpdate" + suffix)) {
+                // One op: both halves updated for a legal move, then evaluated, as at a
+                // search frontier.
+                NnueAccumulator parent, child;
+                std::vector<short> after;
+                results.push_back(runBench("nnueUpdate" + suffix, category, minTimeMs, [&]() {
+                    long long ops = 0;
+                    for (const Prepared& p : positions) {
+                        network.refresh(p.state, 0, parent);
+                        network.refresh(p.state, 1, parent);
+                        for (const auto& move : p.moves) {
+                            after = p.state;
+                            CHESSLOGIC::applyMove(after, move);
+                            network.update(p.state, parent, after, 0, child);
+                            network.update(p.state, parent, after, 1, child);
+                            sink += network.evaluate(after, child);
+                        }
+                        ops += p.moves.size();
+                    }
+                    return ops;
+                }));
+            }
+        }
+        if (network.isLoaded())
+            network.setKernel(NNUE_NETWORK::bestKernel());
+        if (selected("heuristicMoveScore")) {
+            results.push_back(runBench("heuristicMoveScore", category, minTimeMs, [&]() {
+                long long ops = 0;
+                double total = 0;
+                for (const Prepared& p : positions) {
+                    for (const auto& move : p.moves)
+                        total += searcher.heuristicMoveScore(move, p.state);
+                    ops += p.moves.size();
+                }
+                sink += (long long)total;
+                return ops;
+            }));
+        }
+        if (selected("search")) {
+            // A fixed-depth search from an empty table; one op is one node.
+            NODE root;
+            results.push_back(runBench("search", category, minTimeMs, [&]() {
+                long long before = searcher.nodes;
+                for (const Prepared& p : positions) {
+                    tt.clear();
+                    searcher.maxDepth = searchDepth;
+                    root.state = p.state;
+                    root.computeHashKey();
+                    sink += searcher.search(&root, -INFINITE_SCORE, INFINITE_SCORE);
+                }
+                return searcher.nodes - before;
+            }));
+        }
+        if (network.isLoaded() && selected("search_nnue")) {
+            NODE root;
+            searcher.network = &network;
+            results.push_back(runBench("search_nnue", category, minTimeMs, [&]() {
+                long long before = searcher.nodes;
+                for (const Prepared& p : positions) {
+                    tt.clear();
+                    searcher.maxDepth = searchDepth;
+                    root.state = p.state;
+                    root.computeHashKey();
+                    sink += searcher.search(&root, -INFINITE_SCORE, INFINITE_SCORE);
+                }
+                return searcher.nodes - before;
+            }));
+            searcher.network = nullptr;
+        }
+    }
+
+    if (json) {
+        std::ostringstream out;
+        out << "{\"search_depth\": " << searchDepth << ", \"min_time_ms\": " << minTimeMs << ", \"results\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            char line[320];
+            std::snprintf(line, sizeof(line),
+                          "%s\n  {\"name\": \"%s\", \"category\": \"%s\", \"ops\": %lld, \"ns_per_op\": %.1f, "
+                          "\"ops_per_sec\": %.0f, \"allocs_per_op\": %.3f}",
+                          i ? "," : "", r.name.c_str(), r.category.c_str(), r.ops, r.nsPerOp(), r.opsPerSec(),
+                          r.allocationsPerOp());
+            out << line;
+        }
+        out << "\n]}";
+        std::cout << out.str() << std::endl;
+        return 0;
+    }
+
+    std::printf("%-24s %-12s %14s %14s %10s\n", "benchmark", "category", "ns/op", "ops/s", "allocs/op");
+    for (const BenchResult& r : results)
+        std::printf("%-24s %-12s %14.1f %14.0f %10.3f\n", r.name.c_str(), r.category.c_str(), r.nsPerOp(),
+                    r.opsPerSec(), r.allocationsPerOp());
+    return 0;
+}
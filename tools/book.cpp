@@ -0,0 +1,138 @@
+// book.cpp
+// Opening book builder: replays the games of one or more PGN files and writes every
+// (position, move) pair of their first plies to a book file for OPENING_BOOK (see book.h).
+//
+// Usage: chess_book --out FILE [--maxply N] [--mincount N] GAMES.pgn...
+// A move earns 2 points for each game its side won and 1 for each draw; moves played in
+// fewer than --mincount games, or that never scored, are left out.
+
+#include "../ai/book.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../logic/pgn.h"
+#include "../logic/zobrist.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BookOptions {
+    std::string output;
+    std::vector<std::string> inputs;
+    int maxPly;          // Only the first plies of a game go into the book.
+    int minCount;        // Drop moves seen in fewer games than this.
+
+    BookOptions() : maxPly(24), minCount(1) {}
+};
+
+// Statistics of one (position, move) pair.
+struct BookTally {
+    long long weight;
+    long long games;
+
+    BookTally() : weight(0), games(0) {}
+};
+
+static void printUsage() {
+    std::cerr << "usage: chess_book --out FILE [--maxply N] [--mincount N] GAMES.pgn...\n";
+}
+
+static bool parseArguments(int argc, char** argv, BookOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue)
+            options.output = argv[++i];
+        else if (arg == "--maxply" && hasValue)
+            options.maxPly = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--mincount" && hasValue)
+            options.minCount = std::max(1, std::atoi(argv[++i]));
+        else if (arg.compare(0, 2, "--") == 0)
+            return false;
+        else
+            options.inputs.push_back(arg);
+    }
+    return !options.output.empty() && !options.inputs.empty();
+}
+
+int main(int argc, char** argv) {
+    BookOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    CHESSLOGIC logic;
+    const std::vector<short> startState = logic.getState();
+    std::map<std::pair<uint64_t, uint16_t>, BookTally> tallies;
+    long long gameCount = 0, skippedMoves = 0;
+
+    for (const std::string& input : options.inputs) {
+        std::ifstream file(input.c_str());
+        if (!file) {
+            std::cerr << "cannot open " << input << "\n";
+            return 1;
+        }
+        PGN_READER reader(file);
+        PgnGame game;
+        while (reader.next(game)) {
+            gameCount++;
+            // Games from a set-up position are replayed from their FEN tag.
+            std::vector<short> state = startState;
+            int fullmove;
+            if (!game.tag("FEN").empty() && !parseFen(game.tag("FEN"), state, fullmove))
+                continue;
+            int plies = std::min((int)game.moves.size(), options.maxPly);
+            for (int ply = 0; ply < plies; ply++) {
+                std::pair<short, short> move;
+                if (!parseSanMove(logic, state, game.moves[ply], move)) {
+                    // Unknown or unsupported move (underpromotion): the rest
+                    // of the game cannot be replayed.
+                    skippedMoves++;
+                    break;
+                }
+                bool whiteMoved = state[TURN_INDEX] > 0;
+                BookTally& tally = tallies[std::make_pair(zobristHash(state), OPENING_BOOK::encodeMove(move))];
+                tally.games++;
+                if (game.result == "1-0" || game.result == "0-1") {
+                    if ((game.result == "1-0") == whiteMoved)
+                        tally.weight += 2;
+                } else {
+                    // Draws and games without a known result.
+                    tally.weight += 1;
+                }
+                CHESSLOGIC::applyMove(state, move);
+            }
+        }
+    }
+
+    // The map is already ordered by key; scale the weights into 16 bits if necessary.
+    long long maxWeight = 1;
+    for (const auto& entry : tallies)
+        maxWeight = std::max(maxWeight, entry.second.weight);
+    std::vector<unsigned char> bytes;
+    size_t entries = 0;
+    for (const auto& entry : tallies) {
+        const BookTally& tally = entry.second;
+        if (tally.games < options.minCount || tally.weight == 0)
+            continue;
+        long long weight = (maxWeight > 65535) ? std::max(1LL, tally.weight * 65535 / maxWeight) : tally.weight;
+        bytes.resize(bytes.size() + BOOK_ENTRY_SIZE);
+        OPENING_BOOK::writeEntry(&bytes[bytes.size() - BOOK_ENTRY_SIZE], entry.first.first,
+                                 entry.first.second, (uint16_t)weight);
+        entries++;
+    }
+
+    std::ofstream out(options.output.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!out) {
+        std::cerr << "cannot write " << options.output << "\n";
+        return 1;
+    }
+    std::cout << "games " << gameCount << ", moves not replayed " << skippedMoves
+              << ", book entries " << entries << " written to " << options.output << "\n";
+    return 0;
+}
@@ -0,0 +1,242 @@
+// epd.cpp
+// Test-suite runner: searches every position of one or more EPD files with a fixed node,
+// time or depth limit, spreading the positions over all cores, and checks the moves found
+// against the "bm" (best move) and "am" (avoid move) operations of each record.
+//
+// Usage: chess_epd [--nodes N] [--movetime MS] [--depth N] [--concurrency N] [--hash MB]
+//                  FILE...
+// Without a limit every position gets --movetime 1000.
+
+#include "../ai/chessAI.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../utils/threadpool.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+// One EPD record: a position and the operations that define a correct answer.
+struct EpdRecord {
+    std::string id;
+    std::string fen;
+    std::vector<std::string> bestMoves;     // "bm" operands (SAN).
+    std::vector<std::string> avoidMoves;    // "am" operands (SAN).
+};
+
+// Outcome of searching one record.
+struct EpdResult {
+    bool valid;          // The record parsed and its position is legal.
+    bool solved;
+    std::string found;   // Move played, in UCI form.
+    long long nodes;
+    long long timeMs;
+
+    EpdResult() : valid(false), solved(false), nodes(0), timeMs(0) {}
+};
+
+// Splits an EPD line into its four position fields and its operations ("opcode operand...;").
+// Quoted operands may contain spaces and semicolons.
+static bool parseEpdLine(const std::string& line, EpdRecord& record) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement >> side >> castling >> enPassant))
+        return false;
+    record.fen = placement + " " + side + " " + castling + " " + enPassant;
+
+    std::string rest;
+    std::getline(fields, rest);
+    size_t pos = 0;
+    while (pos < rest.size()) {
+        // Read "opcode operand operand ... ;".
+        std::vector<std::string> words;
+        std::string word;
+        bool quoted = false;
+        for (; pos < rest.size(); pos++) {
+            char c = rest[pos];
+            if (c == '"') {
+                quoted = !quoted;
+            } else if (!quoted && c == ';') {
+                pos++;
+                break;
+            } else if (!quoted && (c == ' ' || c == '\t')) {
+                if (!word.empty())
+                    words.push_back(word);
+                word.clear();
+            } else {
+                word += c;
+            }
+        }
+        if (!word.empty())
+            words.push_back(word);
+        if (words.empty())
+            continue;
+        const std::string& opcode = words[0];
+        if (opcode == "id" && words.size() > 1)
+            record.id = words[1];
+        else if (opcode == "bm")
+            record.bestMoves.insert(record.bestMoves.end(), words.begin() + 1, words.end());
+        else if (opcode == "am")
+            record.avoidMoves.insert(record.avoidMoves.end(), words.begin() + 1, words.end());
+    }
+    return true;
+}
+
+static std::vector<EpdRecord> loadSuite(const std::string& path) {
+    std::vector<EpdRecord> records;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        EpdRecord record;
+        if (!parseEpdLine(line, record))
+            continue;
+        if (record.id.empty())
+            record.id = path + ":" + std::to_string(records.size() + 1);
+        records.push_back(record);
+    }
+    return records;
+}
+
+// True if 'move' is one of the SAN moves listed in 'texts' for the position.
+static bool moveListed(CHESSLOGIC& logic, const std::vector<short>& state,
+                       const std::vector<std::string>& texts, std::pair<short, short> move) {
+    for (const std::string& text : texts) {
+        std::pair<short, short> listed;
+        if ((parseSanMove(logic, state, text, listed) || parseUciMove(text, listed)) && listed == move)
+            return true;
+    }
+    return false;
+}
+
+static void printUsage() {
+    std::cerr << "usage: chess_epd [--nodes N] [--movetime MS] [--depth N] [--concurrency N]\n"
+                 "                 [--hash MB] FILE...\n";
+}
+
+int main(int argc, char** argv) {
+    SearchLimits limits;
+    size_t concurrency = THREADPOOL::hardwareThreads();
+    int hashMegabytes = 16;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg.compare(0, 2, "--") == 0 && !hasValue) {
+            printUsage();
+            return 1;
+        }
+        if (arg == "--nodes")             limits.nodes = std::atoll(argv[++i]);
+        else if (arg == "--movetime")     limits.movetime = std::atoi(argv[++i]);
+        else if (arg == "--depth")        limits.depth = std::atoi(argv[++i]);
+        else if (arg == "--concurrency")  concurrency = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash")         hashMegabytes = std::max(1, std::atoi(argv[++i]));
+        else if (arg.compare(0, 2, "--") == 0) {
+            printUsage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        printUsage();
+        return 1;
+    }
+    if (limits.nodes == 0 && limits.movetime == 0 && limits.depth == 0)
+        limits.movetime = 1000;
+
+    std::vector<EpdRecord> records;
+    for (const std::string& file : files) {
+        std::vector<EpdRecord> suite = loadSuite(file);
+        if (suite.empty())
+            std::cerr << "no positions read from " << file << "\n";
+        records.insert(records.end(), suite.begin(), suite.end());
+    }
+    if (records.empty())
+        return 1;
+
+    // One single-threaded engine per worker; positions are the unit of parallelism.
+    THREADPOOL pool(concurrency);
+    std::vector<std::unique_ptr<ChessAI>> engines;
+    std::vector<std::unique_ptr<CHESSLOGIC>> logics;
+    for (size_t i = 0; i < pool.size(); i++) {
+        engines.push_back(std::unique_ptr<ChessAI>(new ChessAI()));
+        engines.back()->setHashSize(hashMegabytes);
+        logics.push_back(std::unique_ptr<CHESSLOGIC>(new CHESSLOGIC()));
+    }
+    std::cout << "positions: " << records.size() << "  concurrency: " << pool.size() << std::endl;
+
+    std::vector<EpdResult> results(records.size());
+    std::mutex outputMutex;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < records.size(); r++) {
+        pool.submit([&, r](size_t worker) {
+            const EpdRecord& record = records[r];
+            EpdResult& result = results[r];
+            CHESSLOGIC& logic = *logics[worker];
+            if (logic.setFen(record.fen) && !logic.allValidMoves.empty()) {
+                ChessAI& ai = *engines[worker];
+                std::vector<short> state = logic.getState();
+                ai.clearHash();
+                auto searchStart = std::chrono::steady_clock::now();
+                std::pair<short, short> move = ai.search(state, limits);
+                result.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - searchStart).count();
+                result.nodes = ai.getNodes();
+                result.found = moveToUci(state, move);
+                result.valid = true;
+                bool best = record.bestMoves.empty() || moveListed(logic, state, record.bestMoves, move);
+                bool avoided = !moveListed(logic, state, record.avoidMoves, move);
+                result.solved = best && avoided;
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout << (result.valid ? (result.solved ? "ok    " : "FAIL  ") : "SKIP  ") << record.id;
+            if (result.valid) {
+                std::cout << "  found " << result.found;
+                if (!record.bestMoves.empty()) {
+                    std::cout << "  bm";
+                    for (const std::string& text : record.bestMoves)
+                        std::cout << " " << text;
+                }
+                if (!record.avoidMoves.empty()) {
+                    std::cout << "  am";
+                    for (const std::string& text : record.avoidMoves)
+                        std::cout << " " << text;
+                }
+                std::cout << "  nodes " << result.nodes << "  time " << result.timeMs;
+            }
+            std::cout << std::endl;
+        });
+    }
+    pool.wait();
+    long long wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int solved = 0, searched = 0;
+    long long totalNodes = 0, searchMs = 0;
+    for (const EpdResult& result : results) {
+        if (!result.valid)
+            continue;
+        searched++;
+        solved += result.solved ? 1 : 0;
+        totalNodes += result.nodes;
+        searchMs += result.timeMs;
+    }
+    char summary[256];
+    std::snprintf(summary, sizeof(summary),
+                  "solved %d/%d  nodes %lld  wall %.1fs  nps %lld  nps/thread %lld",
+                  solved, searched, totalNodes, wallMs / 1000.0,
+                  wallMs > 0 ? totalNodes * 1000 / wallMs : totalNodes,
+                  searchMs > 0 ? totalNodes * 1000 / searchMs : totalNodes);
+    std::cout << summary << std::endl;
+    return 0;
+}
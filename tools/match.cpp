@@ -0,0 +1,321 @@
+// match.cpp
+// Self-play match runner: plays engine-vs-engine games between two configurations on all
+// cores, adjudicates finished games, and reports Elo with error bars and a running SPRT.
+//
+// Usage: chess_match [--a SPEC] [--b SPEC] [--games N] [--concurrency N] [--openings FILE]
+//                    [--maxplies N] [--resign CP] [--resigncount N]
+//                    [--sprt ELO0,ELO1] [--alpha A] [--beta B]
+// A SPEC is a comma-separated list of depth=, nodes=, movetime=, hash=, nnue= and weights=
+// settings, for example "depth=3" or "nodes=20000,hash=8,nnue=net.bin" (nnue= names an
+// evaluation network, see nnue.h; without it the engine uses the classical evaluation, with
+// the weights of a weights= file if given, see evalweights.h).
+
+#include "../ai/chessAI.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../utils/threadpool.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+
+// Search settings of one side of the match.
+struct EngineConfig {
+    SearchLimits limits;
+    int hashMegabytes;
+    std::string networkFile;
+    std::string weightsFile;
+    std::string description;
+
+    EngineConfig() : hashMegabytes(16) { limits.depth = 3; }
+};
+
+struct MatchOptions {
+    EngineConfig engines[2];
+    int games;
+    size_t concurrency;
+    std::string openingsFile;
+    int maxPlies;            // Adjudicate a draw after this many plies.
+    int resignScore;         // Adjudicate a win when both engines agree on at least this score...
+    int resignCount;         // ...for this many consecutive moves each.
+    bool sprt;
+    double elo0, elo1, alpha, beta;
+
+    MatchOptions()
+        : games(100), concurrency(THREADPOOL::hardwareThreads()), maxPlies(300),
+          resignScore(1000), resignCount(4), sprt(false), elo0(0), elo1(5), alpha(0.05), beta(0.05) {}
+};
+
+// Game result from engine A's point of view.
+enum GameResult { RESULT_LOSS = 0, RESULT_DRAW = 1, RESULT_WIN = 2 };
+
+static bool parseEngineSpec(const std::string& spec, EngineConfig& config) {
+    config.limits = SearchLimits();
+    config.networkFile.clear();
+    config.weightsFile.clear();
+    config.description = spec;
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            return false;
+        std::string key = item.substr(0, eq);
+        long long value = std::atoll(item.substr(eq + 1).c_str());
+        if (key == "depth")         config.limits.depth = (int)value;
+        else if (key == "nodes")    config.limits.nodes = value;
+        else if (key == "movetime") config.limits.movetime = (int)value;
+        else if (key == "hash")     config.hashMegabytes = (int)value;
+        else if (key == "nnue")     config.networkFile = item.substr(eq + 1);
+        else if (key == "weights")  config.weightsFile = item.substr(eq + 1);
+        else return false;
+    }
+    return true;
+}
+
+// Each opening line is a sequence of UCI moves from the start position; '#' starts a comment.
+static std::vector<std::vector<std::pair<short, short>>> loadOpenings(const std::string& path) {
+    std::vector<std::vector<std::pair<short, short>>> openings;
+    std::ifstream in(path.c_str());
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::vector<std::pair<short, short>> moves;
+        std::string token;
+        std::pair<short, short> move;
+        while (tokens >> token && parseUciMove(token, move))
+            moves.push_back(move);
+        if (!moves.empty())
+            openings.push_back(moves);
+    }
+    return openings;
+}
+
+// Plays one game; 'engines[0]' plays White. Returns the result from White's point of view.
+static GameResult playGame(ChessAI* engines[2], const EngineConfig* configs[2],
+                           const std::vector<std::pair<short, short>>& opening,
+                           const MatchOptions& options, int& plies)
+{
+    CHESSLOGIC game;
+    for (const auto &move : opening) {
+        if (!game.move(move))
+            break;
+    }
+    engines[0]->clearHash();
+    engines[1]->clearHash();
+
+    int winningStreak[2] = {0, 0};  // Consecutive moves each engine has been clearly winning.
+    int losingStreak[2] = {0, 0};
+    for (plies = 0; ; plies++) {
+        const std::vector<short>& state = game.getState();
+        bool whiteToMove = state[TURN_INDEX] > 0;
+        int side = whiteToMove ? 0 : 1;
+        std::vector<std::pair<short, short>> legal = game.generateAllValidMoves(state);
+        if (legal.empty()) {
+            if (!game.isKingInCheck(state, whiteToMove))
+                return RESULT_DRAW;
+            return whiteToMove ? RESULT_LOSS : RESULT_WIN;
+        }
+        if (CHESSLOGIC::isInsufficientMaterial(state) || game.isDrawByRule() || plies >= options.maxPlies)
+            return RESULT_DRAW;
+
+        SearchLimits limits = configs[side]->limits;
+        limits.history = game.getPositionKeys();
+        std::pair<short, short> best = engines[side]->search(state, limits);
+        if (std::find(legal.begin(), legal.end(), best) == legal.end())
+            return whiteToMove ? RESULT_LOSS : RESULT_WIN;  // Illegal move forfeits.
+
+        // Win adjudication: both engines must agree for several moves in a row.
+        int score = engines[side]->getRootEvaluation();  // White's point of view.
+        int own = whiteToMove ? score : -score;
+        winningStreak[side] = (own >= options.resignScore) ? winningStreak[side] + 1 : 0;
+        losingStreak[side] = (own <= -options.resignScore) ? losingStreak[side] + 1 : 0;
+        int other = 1 - side;
+        if (winningStreak[side] >= options.resignCount && losingStreak[other] >= options.resignCount)
+            return whiteToMove ? RESULT_WIN : RESULT_LOSS;
+        if (losingStreak[side] >= options.resignCount && winningStreak[other] >= options.resignCount)
+            return whiteToMove ? RESULT_LOSS : RESULT_WIN;
+
+        game.move(best);
+    }
+}
+
+// Running W/D/L tally with Elo and SPRT statistics (normal approximation of the trinomial).
+struct MatchStats {
+    int wins, draws, losses;
+    MatchStats() : wins(0), draws(0), losses(0) {}
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+    // Per-game variance of the score. Half a win and half a loss are added as a prior, so a
+    // match where every game had the same result (common for deterministic fixed-depth
+    // self-play) still has a spread and the SPRT and error bar can move.
+    double variance() const {
+        double w = wins + 0.5, d = draws, l = losses + 0.5;
+        double n = w + d + l;
+        double s = (w + 0.5 * d) / n;
+        return (w * (1 - s) * (1 - s) + d * (0.5 - s) * (0.5 - s) + l * s * s) / n;
+    }
+
+    static double eloFromScore(double s) {
+        s = std::min(std::max(s, 1e-6), 1 - 1e-6);
+        return -400.0 * std::log10(1.0 / s - 1.0);
+    }
+    static double scoreFromElo(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+    double elo() const { return eloFromScore(score()); }
+    // Half-width of the 95% confidence interval, in Elo.
+    double eloError() const {
+        if (games() < 2)
+            return 0;
+        double margin = 1.96 * std::sqrt(variance() / games());
+        return (eloFromScore(score() + margin) - eloFromScore(score() - margin)) / 2;
+    }
+    // Log-likelihood ratio of H1 (elo1) against H0 (elo0).
+    double llr(double elo0, double elo1) const {
+        double var = variance();
+        double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+        return (s1 - s0) * (2 * score() - s0 - s1) * games() / (2 * var);
+    }
+};
+
+static void printUsage() {
+    std::cerr << "usage: chess_match [--a SPEC] [--b SPEC] [--games N] [--concurrency N]\n"
+                 "                   [--openings FILE] [--maxplies N] [--resign CP] [--resigncount N]\n"
+                 "                   [--sprt ELO0,ELO1] [--alpha A] [--beta B]\n"
+                 "SPEC: comma-separated depth=, nodes=, movetime=, hash=, nnue=, weights= (default depth=3)\n";
+}
+
+int main(int argc, char** argv) {
+    MatchOptions options;
+    options.engines[0].description = options.engines[1].description = "depth=3";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = (i + 1 < argc) ? argv[i + 1] : "";
+        bool ok = true;
+        if (arg == "--a")                ok = parseEngineSpec(value, options.engines[0]);
+        else if (arg == "--b")           ok = parseEngineSpec(value, options.engines[1]);
+        else if (arg == "--games")       options.games = std::atoi(value.c_str());
+        else if (arg == "--concurrency") options.concurrency = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--openings")    options.openingsFile = value;
+        else if (arg == "--maxplies")    options.maxPlies = std::atoi(value.c_str());
+        else if (arg == "--resign")      options.resignScore = std::atoi(value.c_str());
+        else if (arg == "--resigncount") options.resignCount = std::atoi(value.c_str());
+        else if (arg == "--alpha")       options.alpha = std::atof(value.c_str());
+        else if (arg == "--beta")        options.beta = std::atof(value.c_str());
+        else if (arg == "--sprt") {
+            options.sprt = std::sscanf(value.c_str(), "%lf,%lf", &options.elo0, &options.elo1) == 2;
+            ok = options.sprt;
+        } else {
+            printUsage();
+            return 1;
+        }
+        if (!ok) {
+            printUsage();
+            return 1;
+        }
+        i++;
+    }
+
+    std::vector<std::vector<std::pair<short, short>>> openings;
+    if (!options.openingsFile.empty()) {
+        openings = loadOpenings(options.openingsFile);
+        if (openings.empty()) {
+            std::cerr << "no openings read from " << options.openingsFile << "\n";
+            return 1;
+        }
+    } else {
+        openings.push_back(std::vector<std::pair<short, short>>());
+    }
+
+    // Each configuration's network is loaded once and shared by all its engines.
+    NNUE_NETWORK networks[2];
+    for (int side = 0; side < 2; side++) {
+        const std::string& file = options.engines[side].networkFile;
+        if (!file.empty() && !networks[side].load(file)) {
+            std::cerr << "cannot load network " << file << "\n";
+            return 1;
+        }
+    }
+
+    // Per-worker engine pair: index 0 runs configuration A, index 1 configuration B.
+    THREADPOOL pool(options.concurrency);
+    std::vector<std::unique_ptr<ChessAI>> engineA, engineB;
+    for (size_t i = 0; i < pool.size(); i++) {
+        engineA.push_back(std::unique_ptr<ChessAI>(new ChessAI()));
+        engineB.push_back(std::unique_ptr<ChessAI>(new ChessAI()));
+        engineA.back()->setHashSize(options.engines[0].hashMegabytes);
+        engineB.back()->setHashSize(options.engines[1].hashMegabytes);
+        engineA.back()->shareNetwork(&networks[0]);
+        engineB.back()->shareNetwork(&networks[1]);
+        for (int side = 0; side < 2; side++) {
+            ChessAI* engine = (side == 0) ? engineA.back().get() : engineB.back().get();
+            if (!engine->setEvalWeights(options.engines[side].weightsFile)) {
+                std::cerr << "cannot read weights " << options.engines[side].weightsFile << "\n";
+                return 1;
+            }
+        }
+    }
+
+    double lowerBound = std::log(options.beta / (1 - options.alpha));
+    double upperBound = std::log((1 - options.beta) / options.alpha);
+    std::cout << "A: " << options.engines[0].description << "  B: " << options.engines[1].description
+              << "  games: " << options.games << "  concurrency: " << pool.size()
+              << "  openings: " << openings.size() << std::endl;
+
+    MatchStats stats;
+    std::mutex statsMutex;
+    std::atomic<bool> finished(false);
+    for (int g = 0; g < options.games; g++) {
+        pool.submit([&, g](size_t worker) {
+            if (finished)
+                return;
+            // Each opening is played twice with colours reversed.
+            const std::vector<std::pair<short, short>>& opening = openings[(g / 2) % openings.size()];
+            bool aIsWhite = (g % 2 == 0);
+            ChessAI* engines[2];
+            const EngineConfig* configs[2];
+            engines[aIsWhite ? 0 : 1] = engineA[worker].get();
+            engines[aIsWhite ? 1 : 0] = engineB[worker].get();
+            configs[aIsWhite ? 0 : 1] = &options.engines[0];
+            configs[aIsWhite ? 1 : 0] = &options.engines[1];
+            int plies = 0;
+            GameResult whiteResult = playGame(engines, configs, opening, options, plies);
+            GameResult result = aIsWhite ? whiteResult : (GameResult)(RESULT_WIN - whiteResult);
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+            if (finished)
+                return;
+            if (result == RESULT_WIN) stats.wins++;
+            else if (result == RESULT_LOSS) stats.losses++;
+            else stats.draws++;
+            char line[256];
+            std::snprintf(line, sizeof(line), "Game %d (%d plies): W-D-L %d-%d-%d  Elo %+.1f +/- %.1f",
+                          stats.games(), plies, stats.wins, stats.draws, stats.losses, stats.elo(), stats.eloError());
+            std::cout << line;
+            if (options.sprt) {
+                double llr = stats.llr(options.elo0, options.elo1);
+                std::snprintf(line, sizeof(line), "  LLR %.2f [%.2f, %.2f]", llr, lowerBound, upperBound);
+                std::cout << line;
+                if (llr >= upperBound || llr <= lowerBound) {
+                    std::cout << "\nSPRT: " << (llr >= upperBound ? "H1 accepted" : "H0 accepted");
+                    finished = true;
+                }
+            }
+            std::cout << std::endl;
+        });
+    }
+    pool.wait();
+    if (options.sprt && !finished)
+        std::cout << "SPRT: no decision after " << stats.games() << " games" << std::endl;
+    return 0;
+}
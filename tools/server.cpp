@@ -0,0 +1,610 @@
+// server.cpp
+// Long-running analysis service. Jobs arrive as JSON lines on stdin or from any number of
+// clients of a Unix domain socket; they are searched on a fixed pool of single-threaded
+// engines that share one transposition table, and every result is streamed back to the
+// client that sent the job as soon as it is ready.
+//
+// Usage: chess_server [--socket PATH] [--engines N] [--hash MB] [--depth N] [--max-time MS]
+//                     [--tb DIR] [--cache FILE] [--nnue FILE]
+//
+// Job:     {"id": 7, "fen": "<FEN>", "moves": ["e2e4", "e7e5"], "depth": 8, "nodes": 0,
+//           "movetime": 0, "multipv": 3}
+//          Every field but "fen" is optional ("startpos" is accepted as a FEN); without
+//          a limit the job is searched to --depth.
+// Result:  {"id": 7, "bestmove": "g1f3", "depth": 8, "nodes": 51234, "queue_ms": 0,
+//           "search_ms": 42, "lines": [{"multipv": 1, "cp": 35, "pv": "g1f3 b8c6"}, ...]}
+//          Scores are from the side to move's point of view ("mate": N for mates).
+// Errors:  {"id": 7, "error": "..."}
+// {"stats": true} is answered at once with the jobs done so far, throughput and latency
+// percentiles. In stdin mode the server exits once the input ends and all jobs are done.
+
+#include "../ai/chessAI.h"
+#include "../ai/transposition.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../utils/threadpool.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <algorithm>
+
+// ---------------- JSON Lines ----------------
+// Jobs are flat JSON objects: string, number and literal values, and arrays of them.
+
+// One field of a job. 'raw' is the value as written (echoed back for the id); 'text' is a
+// string's decoded contents or a literal's text; 'items' holds an array's elements.
+struct JsonField {
+    std::string raw;
+    std::string text;
+    std::vector<std::string> items;
+};
+
+static void skipSpace(const std::string& line, size_t& pos) {
+    while (pos < line.size() && std::isspace((unsigned char)line[pos]))
+        pos++;
+}
+
+static bool parseJsonString(const std::string& line, size_t& pos, std::string& text) {
+    if (pos >= line.size() || line[pos] != '"')
+        return false;
+    text.clear();
+    for (pos++; pos < line.size(); pos++) {
+        char c = line[pos];
+        if (c == '"') {
+            pos++;
+            return true;
+        }
+        if (c == '\\') {
+            if (++pos >= line.size())
+                return false;
+            switch (line[pos]) {
+                case 'n': text += '\n'; break;
+                case 't': text += '\t'; break;
+                case 'r': text += '\r'; break;
+                case 'b': text += '\b'; break;
+                case 'f': text += '\f'; break;
+                case 'u':
+                    // Non-ASCII escapes never occur in FENs or moves; keep them as '?'.
+                    if (pos + 4 >= line.size())
+                        return false;
+                    pos += 4;
+                    text += '?';
+                    break;
+                default: text += line[pos]; break;
+            }
+        } else {
+            text += c;
+        }
+    }
+    return false;
+}
+
+// A string or a bare literal (number, true, false, null).
+static bool parseJsonScalar(const std::string& line, size_t& pos, std::string& text) {
+    if (pos < line.size() && line[pos] == '"')
+        return parseJsonString(line, pos, text);
+    size_t start = pos;
+    while (pos < line.size() && (std::isalnum((unsigned char)line[pos]) || std::strchr("+-.", line[pos])))
+        pos++;
+    text = line.substr(start, pos - start);
+    return !text.empty();
+}
+
+// True if 'raw' is a JSON number as the grammar allows it: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool isJsonNumber(const std::string& raw) {
+    size_t pos = 0;
+    auto digits = [&raw, &pos]() {
+        size_t start = pos;
+        while (pos < raw.size() && std::isdigit((unsigned char)raw[pos]))
+            pos++;
+        return pos > start;
+    };
+    if (pos < raw.size() && raw[pos] == '-')
+        pos++;
+    if (pos < raw.size() && raw[pos] == '0')
+        pos++;
+    else if (!digits())
+        return false;
+    if (pos < raw.size() && raw[pos] == '.') {
+        pos++;
+        if (!digits())
+            return false;
+    }
+    if (pos < raw.size() && (raw[pos] == 'e' || raw[pos] == 'E')) {
+        pos++;
+        if (pos < raw.size() && (raw[pos] == '+' || raw[pos] == '-'))
+            pos++;
+        if (!digits())
+            return false;
+    }
+    return pos == raw.size();
+}
+
+// Ids are echoed back as written, so only a string, a number or null is accepted.
+static bool isJsonId(const JsonField& field) {
+    return (!field.raw.empty() && field.raw[0] == '"') || field.raw == "null" || isJsonNumber(field.raw);
+}
+
+// Parses one JSON object into its fields; nested objects are not supported.
+static bool parseJsonObject(const std::string& line, std::map<std::string, JsonField>& fields) {
+    size_t pos = 0;
+    skipSpace(line, pos);
+    if (pos >= line.size() || line[pos++] != '{')
+        return false;
+    skipSpace(line, pos);
+    if (pos < line.size() && line[pos] == '}')
+        return true;
+    while (pos < line.size()) {
+        std::string key;
+        skipSpace(line, pos);
+        if (!parseJsonString(line, pos, key))
+            return false;
+        skipSpace(line, pos);
+        if (pos >= line.size() || line[pos++] != ':')
+            return false;
+        skipSpace(line, pos);
+        JsonField field;
+        size_t start = pos;
+        if (pos < line.size() && line[pos] == '[') {
+            pos++;
+            skipSpace(line, pos);
+            while (pos < line.size() && line[pos] != ']') {
+                std::string item;
+                if (!parseJsonScalar(line, pos, item))
+                    return false;
+                field.items.push_back(item);
+                skipSpace(line, pos);
+                if (pos < line.size() && line[pos] == ',') {
+                    pos++;
+                    skipSpace(line, pos);
+                }
+            }
+            if (pos++ >= line.size())
+                return false;
+        } else if (!parseJsonScalar(line, pos, field.text)) {
+            return false;
+        }
+        field.raw = line.substr(start, pos - start);
+        fields[key] = field;
+        skipSpace(line, pos);
+        if (pos < line.size() && line[pos] == ',') {
+            pos++;
+            continue;
+        }
+        return pos < line.size() && line[pos] == '}';
+    }
+    return false;
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        if ((unsigned char)c < 0x20)
+            escaped += ' ';
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+// ---------------- Clients ----------------
+
+// A source of jobs and the destination of their results: stdout, or one socket connection.
+// Results of different workers may finish at the same time, so writes are serialised.
+class CLIENT {
+public:
+    // 'fd' is closed with the client unless it is stdout.
+    explicit CLIENT(int fd) : fd(fd) {}
+    ~CLIENT() {
+        if (fd != STDOUT_FILENO)
+            close(fd);
+    }
+    CLIENT(const CLIENT&) = delete;
+    CLIENT& operator=(const CLIENT&) = delete;
+
+    // Writes one line; a client that went away simply stops receiving.
+    void send(const std::string& line) {
+        std::string text = line + "\n";
+        std::lock_guard<std::mutex> lock(writeMutex);
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t count = (fd == STDOUT_FILENO)
+                ? write(fd, text.data() + written, text.size() - written)
+                : ::send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return;
+            written += (size_t)count;
+        }
+    }
+
+private:
+    int fd;
+    std::mutex writeMutex;
+};
+
+// ---------------- Jobs ----------------
+
+struct Job {
+    std::shared_ptr<CLIENT> client;
+    std::string id;                    // JSON text of the job's id ("null" if it had none).
+    std::vector<short> state;
+    SearchLimits limits;               // Includes the game history of "moves".
+    int multiPV;
+    std::chrono::steady_clock::time_point received;
+};
+
+// JOB_QUEUE hands jobs out round-robin over the clients that have work waiting, so a
+// client that submits a batch of thousands of positions delays another client's job by
+// at most one job per worker rather than by the whole batch.
+class JOB_QUEUE {
+public:
+    JOB_QUEUE() : next(0), count(0) {}
+
+    void push(const Job& job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        count++;
+        for (auto& waiting : clients) {
+            if (waiting.first == job.client.get()) {
+                waiting.second.push_back(job);
+                return;
+            }
+        }
+        clients.push_back(std::make_pair(job.client.get(), std::deque<Job>(1, job)));
+    }
+
+    // Takes the next job; there is one for every push.
+    Job pop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        next %= clients.size();
+        std::deque<Job>& queue = clients[next].second;
+        Job job = queue.front();
+        queue.pop_front();
+        count--;
+        if (queue.empty())
+            clients.erase(clients.begin() + next);
+        else
+            next++;
+        return job;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<std::pair<CLIENT*, std::deque<Job>>> clients;
+    size_t next;
+    size_t count;
+};
+
+// Completed jobs and their latency (from arrival to result), for {"stats": true}. "nps" is
+// the nodes of all jobs over the time spent searching them, so idle time does not lower it;
+// it is the speed of one engine, not of the whole pool.
+class SERVER_STATS {
+public:
+    SERVER_STATS() : start(std::chrono::steady_clock::now()), nodes(0), searchSeconds(0) {}
+
+    void record(long long latencyMs, long long searchNodes, double searchTime) {
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies.push_back(latencyMs);
+        nodes += searchNodes;
+        searchSeconds += searchTime;
+    }
+
+    std::string summary(size_t queued) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<long long> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        char text[320];
+        std::snprintf(text, sizeof(text),
+                      "{\"jobs\":%zu,\"queued\":%zu,\"jobs_per_s\":%.1f,\"nps\":%.0f,"
+                      "\"latency_ms\":{\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,\"max\":%lld}}",
+                      sorted.size(), queued, seconds > 0 ? sorted.size() / seconds : 0.0,
+                      searchSeconds > 0 ? nodes / searchSeconds : 0.0,
+                      percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99),
+                      sorted.empty() ? 0LL : sorted.back());
+        return text;
+    }
+
+private:
+    static long long percentile(const std::vector<long long>& sorted, int percent) {
+        if (sorted.empty())
+            return 0;
+        return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+    }
+
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point start;
+    std::vector<long long> latencies;
+    long long nodes;
+    double searchSeconds;
+};
+
+// ---------------- Server ----------------
+
+struct ServerOptions {
+    int engines;
+    int hashMegabytes;
+    int depth;
+    int maxTimeMs;         // Cap on every job's search time (0: none).
+    std::string tablebaseDir;
+    std::string cacheFile;  // Persistent analysis cache mapped by every engine (see analysiscache.h).
+    std::string networkFile;  // Evaluation network shared by every engine (see nnue.h).
+
+    ServerOptions() : engines((int)THREADPOOL::hardwareThreads()), hashMegabytes(256), depth(8), maxTimeMs(0) {}
+};
+
+// One engine of the pool, with the depth its last search completed.
+struct PoolEngine {
+    ChessAI ai;
+    int lastDepth;
+
+    PoolEngine() : lastDepth(0) {
+        ai.onIteration = [this](const SearchInfo& info) { lastDepth = info.depth; };
+    }
+};
+
+class SERVER {
+public:
+    explicit SERVER(const ServerOptions& options);
+    // Parses one line from 'client' and queues its job, or answers it directly.
+    void handleLine(const std::shared_ptr<CLIENT>& client, CHESSLOGIC& logic, const std::string& line);
+    // Blocks until every queued job has been answered.
+    void drain() { pool.wait(); }
+    std::string stats() { return statistics.summary(queue.size()); }
+    bool hasNetwork() const { return network.isLoaded(); }
+
+private:
+    void runJob(const Job& job, PoolEngine& engine);
+
+    ServerOptions options;
+    TRANSPOSITION_TABLE table;
+    NNUE_NETWORK network;
+    std::vector<std::unique_ptr<PoolEngine>> engines;
+    JOB_QUEUE queue;
+    SERVER_STATS statistics;
+    // Declared last so its workers stop before the engines and the table they use go away.
+    THREADPOOL pool;
+};
+
+SERVER::SERVER(const ServerOptions& options)
+    : options(options), table(options.hashMegabytes), pool(options.engines)
+{
+    if (!options.networkFile.empty())
+        network.load(options.networkFile);
+    // One single-threaded engine per worker: independent positions scale better across
+    // cores than Lazy SMP within one position, and every engine reads and fills the same
+    // table, so related positions from a batch help each other.
+    for (size_t i = 0; i < pool.size(); i++) {
+        engines.push_back(std::unique_ptr<PoolEngine>(new PoolEngine()));
+        ChessAI& ai = engines.back()->ai;
+        ai.setHashSize(1);
+        ai.shareTable(&table);
+        ai.shareNetwork(&network);
+        ai.defaultDepth = options.depth;
+        if (!options.tablebaseDir.empty())
+            ai.setTablebasePath(options.tablebaseDir);
+        if (!options.cacheFile.empty())
+            ai.setAnalysisCache(options.cacheFile, CACHE_DEFAULT_MEGABYTES);
+    }
+}
+
+void SERVER::handleLine(const std::shared_ptr<CLIENT>& client, CHESSLOGIC& logic, const std::string& line) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos)
+        return;
+    std::map<std::string, JsonField> fields;
+    if (!parseJsonObject(line, fields) || (fields.count("id") && !isJsonId(fields["id"]))) {
+        client->send("{\"id\":null,\"error\":\"malformed JSON\"}");
+        return;
+    }
+    if (fields.count("stats")) {
+        client->send(stats());
+        return;
+    }
+    Job job;
+    job.client = client;
+    job.received = std::chrono::steady_clock::now();
+    job.id = fields.count("id") ? fields["id"].raw : "null";
+    std::string fen = fields.count("fen") ? fields["fen"].text : "";
+    if (fen == "startpos")
+        fen = START_FEN;
+    if (fen.empty() || !logic.setFen(fen)) {
+        client->send("{\"id\":" + job.id + ",\"error\":\"invalid fen\"}");
+        return;
+    }
+    for (const std::string& text : fields["moves"].items) {
+        std::pair<short, short> move;
+        if (!parseUciMove(text, move) || !logic.move(move)) {
+            client->send("{\"id\":" + job.id + ",\"error\":\"illegal move " + jsonEscape(text) + "\"}");
+            return;
+        }
+    }
+    if (logic.allValidMoves.empty()) {
+        client->send("{\"id\":" + job.id + ",\"error\":\"no legal moves\"}");
+        return;
+    }
+    job.state = logic.getState();
+    job.limits.history = logic.getPositionKeys();
+    job.limits.depth = std::max(0, std::atoi(fields["depth"].text.c_str()));
+    job.limits.nodes = std::max(0LL, std::atoll(fields["nodes"].text.c_str()));
+    job.limits.movetime = std::max(0, std::atoi(fields["movetime"].text.c_str()));
+    if (options.maxTimeMs > 0 && (job.limits.movetime == 0 || job.limits.movetime > options.maxTimeMs))
+        job.limits.movetime = options.maxTimeMs;
+    job.multiPV = std::max(1, std::min(std::atoi(fields["multipv"].text.c_str()), MAX_MOVES));
+
+    // Each submitted task runs whichever job the fair queue hands out next.
+    queue.push(job);
+    pool.submit([this](size_t worker) { runJob(queue.pop(), *engines[worker]); });
+}
+
+void SERVER::runJob(const Job& job, PoolEngine& engine) {
+    ChessAI& ai = engine.ai;
+    auto searchStart = std::chrono::steady_clock::now();
+    ai.multiPV = job.multiPV;
+    engine.lastDepth = 0;
+    std::pair<short, short> best = ai.search(job.state, job.limits);
+    auto finished = std::chrono::steady_clock::now();
+    long long queueMs = std::chrono::duration_cast<std::chrono::milliseconds>(searchStart - job.received).count();
+    long long searchMs = std::chrono::duration_cast<std::chrono::milliseconds>(finished - searchStart).count();
+
+    std::string result = "{\"id\":" + job.id + ",\"bestmove\":\"" + moveToUci(job.state, best) + "\""
+                       + ",\"depth\":" + std::to_string(engine.lastDepth)
+                       + ",\"nodes\":" + std::to_string(ai.getNodes())
+                       + ",\"queue_ms\":" + std::to_string(queueMs)
+                       + ",\"search_ms\":" + std::to_string(searchMs) + ",\"lines\":[";
+    std::vector<RootLine> lines = ai.getRootLines();
+    for (size_t i = 0; i < lines.size(); i++) {
+        std::string pv;
+        std::vector<short> state = job.state;
+        for (const auto& move : lines[i].pv) {
+            pv += (pv.empty() ? "" : " ") + moveToUci(state, move);
+            CHESSLOGIC::applyMove(state, move);
+        }
+        int score = lines[i].score;
+        result += (i > 0 ? ",{\"multipv\":" : "{\"multipv\":") + std::to_string(i + 1)
+                + (isMateScore(score) ? ",\"mate\":" + std::to_string(mateDistanceInMoves(score))
+                                      : ",\"cp\":" + std::to_string(score))
+                + ",\"pv\":\"" + pv + "\"}";
+    }
+    result += "]}";
+    job.client->send(result);
+    statistics.record(std::chrono::duration_cast<std::chrono::milliseconds>(finished - job.received).count(),
+                      ai.getNodes(), std::chrono::duration<double>(finished - searchStart).count());
+}
+
+// Reads lines from a connection until it closes; results go back over the same socket.
+static void serveConnection(SERVER& server, int fd) {
+    std::shared_ptr<CLIENT> client(new CLIENT(fd));
+    CHESSLOGIC logic;
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        pending.append(buffer, (size_t)count);
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            server.handleLine(client, logic, pending.substr(0, newline));
+            pending.erase(0, newline + 1);
+        }
+    }
+    // Jobs still queued keep the client alive and answer into the closed socket.
+}
+
+static int listenUnix(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    std::strcpy(address.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path.c_str());
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, 64) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void printUsage() {
+    std::cerr << "usage: chess_server [--socket PATH] [--engines N] [--hash MB] [--depth N]\n"
+                 "                    [--max-time MS] [--tb DIR] [--cache FILE] [--nnue FILE]\n";
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    std::string socketPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc)
+            socketPath = argv[++i];
+        else if (arg == "--engines" && i + 1 < argc)
+            options.engines = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--hash" && i + 1 < argc)
+            options.hashMegabytes = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--depth" && i + 1 < argc)
+            options.depth = std::max(1, std::min(std::atoi(argv[++i]), MAX_SEARCH_DEPTH));
+        else if (arg == "--max-time" && i + 1 < argc)
+            options.maxTimeMs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--tb" && i + 1 < argc)
+            options.tablebaseDir = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc)
+            options.cacheFile = argv[++i];
+        else if (arg == "--nnue" && i + 1 < argc)
+            options.networkFile = argv[++i];
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    // Every engine maps the cache itself; check once that the file is usable.
+    ANALYSIS_CACHE cacheCheck;
+    if (!options.cacheFile.empty() && !cacheCheck.open(options.cacheFile, CACHE_DEFAULT_MEGABYTES)) {
+        std::cerr << "cannot map analysis cache " << options.cacheFile << std::endl;
+        return 1;
+    }
+    cacheCheck.close();
+
+    SERVER server(options);
+    if (!options.networkFile.empty() && !server.hasNetwork()) {
+        std::cerr << "cannot load network " << options.networkFile << std::endl;
+        return 1;
+    }
+    if (socketPath.empty()) {
+        // stdin mode: answer every job, then report the totals on stderr.
+        std::shared_ptr<CLIENT> client(new CLIENT(STDOUT_FILENO));
+        CHESSLOGIC logic;
+        std::string line;
+        while (std::getline(std::cin, line))
+            server.handleLine(client, logic, line);
+        server.drain();
+        std::cerr << server.stats() << std::endl;
+        return 0;
+    }
+
+    int listener = listenUnix(socketPath);
+    if (listener < 0) {
+        std::cerr << "cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "listening on " << socketPath << " with " << options.engines << " engines" << std::endl;
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        std::thread(serveConnection, std::ref(server), fd).detach();
+    }
+    close(listener);
+    return 1;
+}
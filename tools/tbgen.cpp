@@ -0,0 +1,555 @@
+// tbgen.cpp
+// Endgame tablebase generator: solves small endgames by retrograde analysis on all cores
+// and writes one distance-to-mate table per material signature (see tablebase.h). Tables
+// reached by captures and promotions are generated first, or loaded if already on disk.
+//
+// Usage: chess_tbgen [--out DIR] [--threads N] TABLE...
+// TABLE is a material signature such as KQK, KRK, KBNK or KRKP (at most 4 pieces).
+
+#include "../ai/tablebase.h"
+#include "../utils/threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Generation-only markers; never written to a table file.
+const uint8_t TB_UNKNOWN = 254;
+const uint8_t TB_INVALID = 255;
+// Longest mate the result byte can hold (losses use 128 + moves).
+const int TB_MAX_MOVES = 120;
+
+const int KNIGHT_JUMPS[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+const int ROOK_DIRECTIONS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+const int BISHOP_DIRECTIONS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+bool onBoard(int row, int col) {
+    return row >= 0 && row < 8 && col >= 0 && col < 8;
+}
+
+// Board of piece codes built from a TbPosition.
+struct SmallBoard {
+    short square[64];
+
+    explicit SmallBoard(const TbPosition& position) {
+        std::fill(square, square + 64, 0);
+        for (int i = 0; i < position.count; i++)
+            square[position.square[i]] = position.piece[i];
+    }
+};
+
+// True if the piece 'code' on 'from' attacks 'target'.
+bool attacks(const SmallBoard& board, short from, short code, short target) {
+    int dr = target / 8 - from / 8, dc = target % 8 - from % 8;
+    int absCode = std::abs(code);
+    if (absCode == 127)
+        return std::max(std::abs(dr), std::abs(dc)) == 1;
+    if (absCode == 3)
+        return (std::abs(dr) == 1 && std::abs(dc) == 2) || (std::abs(dr) == 2 && std::abs(dc) == 1);
+    if (absCode == 1)
+        return std::abs(dc) == 1 && dr == (code > 0 ? -1 : 1);
+    bool straight = (dr == 0 || dc == 0);
+    bool diagonal = std::abs(dr) == std::abs(dc);
+    if ((absCode == 5 && !straight) || (absCode == 6 && !diagonal) || (!straight && !diagonal) || from == target)
+        return false;
+    int stepRow = (dr > 0) - (dr < 0), stepCol = (dc > 0) - (dc < 0);
+    int row = from / 8 + stepRow, col = from % 8 + stepCol;
+    while (row * 8 + col != target) {
+        if (board.square[row * 8 + col] != 0)
+            return false;
+        row += stepRow;
+        col += stepCol;
+    }
+    return true;
+}
+
+bool inCheck(const TbPosition& position, const SmallBoard& board, bool white) {
+    short king = -1;
+    for (int i = 0; i < position.count; i++) {
+        if (position.piece[i] == (white ? 127 : -127))
+            king = position.square[i];
+    }
+    for (int i = 0; i < position.count; i++) {
+        if ((position.piece[i] > 0) != white && attacks(board, position.square[i], position.piece[i], king))
+            return true;
+    }
+    return false;
+}
+
+// Apply a move to a position: captures remove the piece, pawns promote to queens.
+TbPosition makeMove(const TbPosition& position, int mover, short to) {
+    TbPosition child = position;
+    for (int i = 0; i < child.count; i++) {
+        if (i != mover && child.square[i] == to) {
+            child.square[i] = child.square[child.count - 1];
+            child.piece[i] = child.piece[child.count - 1];
+            if (mover == child.count - 1)
+                mover = i;
+            child.count--;
+            break;
+        }
+    }
+    child.square[mover] = to;
+    if (std::abs(child.piece[mover]) == 1 && (to < 8 || to >= 56))
+        child.piece[mover] = child.piece[mover] > 0 ? 9 : -9;
+    child.whiteToMove = !child.whiteToMove;
+    return child;
+}
+
+// All legal successors of a position.
+int generateChildren(const TbPosition& position, TbPosition children[]) {
+    SmallBoard board(position);
+    bool white = position.whiteToMove;
+    int count = 0;
+    short targets[32];
+    for (int i = 0; i < position.count; i++) {
+        short code = position.piece[i];
+        if ((code > 0) != white)
+            continue;
+        short from = position.square[i];
+        int row = from / 8, col = from % 8;
+        int targetCount = 0;
+        int absCode = std::abs(code);
+        if (absCode == 127 || absCode == 3) {
+            for (int k = 0; k < 8; k++) {
+                int r, c;
+                if (absCode == 3) {
+                    r = row + KNIGHT_JUMPS[k][0];
+                    c = col + KNIGHT_JUMPS[k][1];
+                } else {
+                    int step = (k < 4) ? k : k + 1;   // Skip the centre of the 3x3 block.
+                    r = row + step / 3 - 1;
+                    c = col + step % 3 - 1;
+                }
+                if (onBoard(r, c))
+                    targets[targetCount++] = (short)(r * 8 + c);
+            }
+        } else if (absCode == 1) {
+            int forward = white ? -1 : 1;
+            short push = (short)(from + forward * 8);
+            if (board.square[push] == 0) {
+                targets[targetCount++] = push;
+                bool startRow = white ? row == 6 : row == 1;
+                short doublePush = (short)(from + forward * 16);
+                if (startRow && board.square[doublePush] == 0)
+                    targets[targetCount++] = doublePush;
+            }
+            for (int side = -1; side <= 1; side += 2) {
+                if (onBoard(row + forward, col + side)) {
+                    short target = (short)((row + forward) * 8 + col + side);
+                    if (board.square[target] != 0)
+                        targets[targetCount++] = target;
+                }
+            }
+        } else {
+            for (int d = 0; d < 8; d++) {
+                const int* direction = (d < 4) ? ROOK_DIRECTIONS[d] : BISHOP_DIRECTIONS[d - 4];
+                if ((absCode == 5 && d >= 4) || (absCode == 6 && d < 4))
+                    continue;
+                int r = row + direction[0], c = col + direction[1];
+                while (onBoard(r, c)) {
+                    targets[targetCount++] = (short)(r * 8 + c);
+                    if (board.square[r * 8 + c] != 0)
+                        break;
+                    r += direction[0];
+                    c += direction[1];
+                }
+            }
+        }
+        for (int t = 0; t < targetCount; t++) {
+            short occupant = board.square[targets[t]];
+            if (occupant != 0 && ((occupant > 0) == white || std::abs(occupant) == 127))
+                continue;
+            TbPosition child = makeMove(position, i, targets[t]);
+            if (!inCheck(child, SmallBoard(child), white))
+                children[count++] = child;
+        }
+    }
+    return count;
+}
+
+// All positions from which a quiet move of the side that just moved leads to 'position'.
+// Captures and promotions are left out: they start from positions of other tables.
+int generateParents(const TbPosition& position, TbPosition parents[]) {
+    SmallBoard board(position);
+    bool white = !position.whiteToMove;
+    int count = 0;
+    short origins[32];
+    for (int i = 0; i < position.count; i++) {
+        short code = position.piece[i];
+        if ((code > 0) != white)
+            continue;
+        short to = position.square[i];
+        int row = to / 8, col = to % 8;
+        int originCount = 0;
+        int absCode = std::abs(code);
+        if (absCode == 127 || absCode == 3) {
+            for (int k = 0; k < 8; k++) {
+                int r, c;
+                if (absCode == 3) {
+                    r = row + KNIGHT_JUMPS[k][0];
+                    c = col + KNIGHT_JUMPS[k][1];
+                } else {
+                    int step = (k < 4) ? k : k + 1;
+                    r = row + step / 3 - 1;
+                    c = col + step % 3 - 1;
+                }
+                if (onBoard(r, c) && board.square[r * 8 + c] == 0)
+                    origins[originCount++] = (short)(r * 8 + c);
+            }
+        } else if (absCode == 1) {
+            int back = white ? 1 : -1;
+            int originRow = row + back;
+            if (originRow >= 1 && originRow <= 6 && board.square[originRow * 8 + col] == 0) {
+                origins[originCount++] = (short)(originRow * 8 + col);
+                bool doublePushed = white ? row == 4 : row == 3;
+                if (doublePushed && board.square[(originRow + back) * 8 + col] == 0)
+                    origins[originCount++] = (short)((originRow + back) * 8 + col);
+            }
+        } else {
+            for (int d = 0; d < 8; d++) {
+                const int* direction = (d < 4) ? ROOK_DIRECTIONS[d] : BISHOP_DIRECTIONS[d - 4];
+                if ((absCode == 5 && d >= 4) || (absCode == 6 && d < 4))
+                    continue;
+                int r = row + direction[0], c = col + direction[1];
+                while (onBoard(r, c) && board.square[r * 8 + c] == 0) {
+                    origins[originCount++] = (short)(r * 8 + c);
+                    r += direction[0];
+                    c += direction[1];
+                }
+            }
+        }
+        for (int o = 0; o < originCount; o++) {
+            TbPosition parent = position;
+            parent.square[i] = origins[o];
+            parent.whiteToMove = white;
+            // The side to move in 'position' must not have been left in check.
+            if (!inCheck(parent, SmallBoard(parent), !white))
+                parents[count++] = parent;
+        }
+    }
+    return count;
+}
+
+// Canonical name of a set of piece codes.
+std::string canonicalName(const std::vector<short>& codes) {
+    TbPosition position;
+    position.count = (int)codes.size();
+    for (int i = 0; i < position.count; i++) {
+        position.square[i] = (short)(16 + i);
+        position.piece[i] = codes[i];
+    }
+    position.whiteToMove = true;
+    std::string table;
+    size_t index;
+    tbLocate(position, table, index);
+    return table;
+}
+
+// Piece codes of a table name, or an empty vector if the name is malformed.
+std::vector<short> parseTableName(const std::string& name) {
+    std::vector<short> codes;
+    int kings = 0;
+    for (char letter : name) {
+        short code;
+        switch (letter) {
+            case 'K': code = 127; kings++; break;
+            case 'Q': code = 9; break;
+            case 'R': code = 5; break;
+            case 'B': code = 6; break;
+            case 'N': code = 3; break;
+            case 'P': code = 1; break;
+            default: return std::vector<short>();
+        }
+        codes.push_back(kings == 2 ? -code : code);
+    }
+    if (name.empty() || name[0] != 'K' || kings != 2 || codes.size() > (size_t)TB_MAX_PIECES)
+        return std::vector<short>();
+    return codes;
+}
+
+class GENERATOR {
+public:
+    GENERATOR(const std::string& outDir, size_t threads) : outDir(outDir), pool(threads) {}
+
+    // Make a table available, generating or loading everything it depends on first.
+    bool ensure(const std::string& name);
+
+private:
+    // True if a successor stays in the table being generated.
+    static bool locatesIn(const TbPosition& child, const std::string& table);
+    // Result of a successor position, from the table it belongs to.
+    uint8_t lookup(const TbPosition& child, const std::string& current, const std::vector<uint8_t>& db) const;
+    bool load(const std::string& name);
+    void generate(const std::string& name);
+    bool write(const std::string& name, const std::vector<uint8_t>& db) const;
+    // Run 'job' over all indices of the table in chunks on the pool.
+    void parallelFor(size_t size, const std::function<void(size_t index, size_t worker)>& job);
+
+    std::string outDir;
+    THREADPOOL pool;
+    std::map<std::string, std::vector<uint8_t>> tables;
+};
+
+bool GENERATOR::ensure(const std::string& name) {
+    if (tables.count(name) || name.size() <= 2)
+        return true;
+    std::vector<short> codes = parseTableName(name);
+    if (codes.empty())
+        return false;
+    if (load(name))
+        return true;
+
+    // Captures lead to tables with one piece less, promotions to tables with a queen.
+    for (size_t i = 0; i < codes.size(); i++) {
+        if (std::abs(codes[i]) == 127)
+            continue;
+        std::vector<short> captured = codes;
+        captured.erase(captured.begin() + i);
+        if (!ensure(canonicalName(captured)))
+            return false;
+        if (std::abs(codes[i]) == 1) {
+            std::vector<short> promoted = codes;
+            promoted[i] = codes[i] > 0 ? 9 : -9;
+            if (!ensure(canonicalName(promoted)))
+                return false;
+        }
+    }
+    generate(name);
+    return true;
+}
+
+bool GENERATOR::locatesIn(const TbPosition& child, const std::string& table) {
+    std::string childTable;
+    size_t index;
+    return child.count > 2 && tbLocate(child, childTable, index) && childTable == table;
+}
+
+uint8_t GENERATOR::lookup(const TbPosition& child, const std::string& current,
+                          const std::vector<uint8_t>& db) const {
+    std::string table;
+    size_t index;
+    if (child.count <= 2 || !tbLocate(child, table, index))
+        return TB_DRAW;
+    if (table == current)
+        return db[index];
+    auto found = tables.find(table);
+    return (found != tables.end()) ? found->second[index] : TB_DRAW;
+}
+
+void GENERATOR::parallelFor(size_t size, const std::function<void(size_t index, size_t worker)>& job) {
+    const size_t chunk = 1 << 12;
+    for (size_t start = 0; start < size; start += chunk) {
+        size_t end = std::min(size, start + chunk);
+        pool.submit([start, end, &job](size_t worker) {
+            for (size_t index = start; index < end; index++)
+                job(index, worker);
+        });
+    }
+    pool.wait();
+}
+
+void GENERATOR::generate(const std::string& name) {
+    auto startTime = std::chrono::steady_clock::now();
+    size_t size = tbTableSize(name);
+    std::vector<uint8_t> db(size, TB_INVALID);
+
+    // Positions waiting to be settled, by distance to mate in moves. A position may be
+    // queued more than once; only its first (shortest) settlement counts.
+    std::vector<std::vector<size_t>> winQueue(TB_MAX_MOVES + 2), lossQueue(TB_MAX_MOVES + 2);
+    struct Found { size_t index; int level; bool win; };
+    std::vector<std::vector<Found>> found(pool.size());
+    // Workers only read 'db'; what they find is applied here, between parallel phases.
+    auto applyFound = [&]() {
+        for (auto& list : found) {
+            for (const Found& entry : list) {
+                if (entry.level <= TB_MAX_MOVES)
+                    (entry.win ? winQueue : lossQueue)[entry.level].push_back(entry.index);
+            }
+            list.clear();
+        }
+    };
+
+    // Initial pass: mark illegal and duplicate placements, find mates and stalemates, and
+    // queue the results reached through captures and promotions into solved tables.
+    parallelFor(size, [&](size_t index, size_t worker) {
+        TbPosition position;
+        std::string table;
+        size_t canonical;
+        if (!tbDecode(name, index, position) || !tbLocate(position, table, canonical) || canonical != index)
+            return;
+        SmallBoard board(position);
+        if (inCheck(position, board, !position.whiteToMove))
+            return;
+        TbPosition children[128];
+        int count = generateChildren(position, children);
+        db[index] = TB_UNKNOWN;
+        if (count == 0) {
+            if (inCheck(position, board, position.whiteToMove))
+                found[worker].push_back(Found{index, 0, false});
+            else
+                db[index] = TB_DRAW;
+            return;
+        }
+        int fastestWin = 0, slowestLoss = 0;
+        bool allLost = true;
+        for (int i = 0; i < count; i++) {
+            if (locatesIn(children[i], name)) {
+                allLost = false;
+                continue;
+            }
+            uint8_t value = lookup(children[i], name, db);
+            if (tbIsLoss(value)) {
+                int win = value - 128 + 1;
+                fastestWin = (fastestWin == 0) ? win : std::min(fastestWin, win);
+            }
+            if (tbIsWin(value))
+                slowestLoss = std::max(slowestLoss, (int)value);
+            else
+                allLost = false;
+        }
+        if (fastestWin > 0)
+            found[worker].push_back(Found{index, fastestWin, true});
+        else if (allLost)
+            found[worker].push_back(Found{index, slowestLoss, false});
+    });
+    applyFound();
+
+    // Level n settles the wins in n moves, then the losses in n moves. A new win makes its
+    // parents candidates for a loss (confirmed by looking at all their moves); a new loss
+    // makes its parents wins one move later.
+    for (int n = 0; n <= TB_MAX_MOVES; n++) {
+        for (int half = 0; half < 2; half++) {
+            bool wins = (half == 0);
+            std::vector<size_t> settled;
+            for (size_t index : (wins ? winQueue : lossQueue)[n]) {
+                if (db[index] == TB_UNKNOWN) {
+                    db[index] = (uint8_t)(wins ? n : 128 + n);
+                    settled.push_back(index);
+                }
+            }
+            std::vector<size_t>().swap((wins ? winQueue : lossQueue)[n]);
+            parallelFor(settled.size(), [&](size_t item, size_t worker) {
+                TbPosition position;
+                tbDecode(name, settled[item], position);
+                TbPosition parents[128];
+                int parentCount = generateParents(position, parents);
+                for (int p = 0; p < parentCount; p++) {
+                    std::string table;
+                    size_t parentIndex;
+                    tbLocate(parents[p], table, parentIndex);
+                    if (db[parentIndex] != TB_UNKNOWN)
+                        continue;
+                    if (!wins) {
+                        found[worker].push_back(Found{parentIndex, n + 1, true});
+                        continue;
+                    }
+                    // Lost only if every move leads to a win for the opponent.
+                    TbPosition children[128];
+                    int count = generateChildren(parents[p], children);
+                    int slowest = 0;
+                    bool allLost = true;
+                    for (int i = 0; i < count && allLost; i++) {
+                        uint8_t value = lookup(children[i], name, db);
+                        allLost = tbIsWin(value);
+                        slowest = std::max(slowest, (int)value);
+                    }
+                    if (allLost)
+                        found[worker].push_back(Found{parentIndex, slowest, false});
+                }
+            });
+            applyFound();
+        }
+        bool pending = false;
+        for (int level = n + 1; level <= TB_MAX_MOVES && !pending; level++)
+            pending = !winQueue[level].empty() || !lossQueue[level].empty();
+        if (!pending)
+            break;
+    }
+
+    // Everything still open is a draw; report the result and store the table.
+    long long wins = 0, draws = 0, losses = 0;
+    int longest = 0;
+    for (uint8_t& value : db) {
+        if (value == TB_INVALID || value == TB_UNKNOWN) {
+            if (value == TB_UNKNOWN)
+                draws++;
+            value = TB_DRAW;
+        } else if (tbIsWin(value)) {
+            wins++;
+            longest = std::max(longest, (int)value);
+        } else if (tbIsLoss(value)) {
+            losses++;
+        } else {
+            draws++;
+        }
+    }
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+    std::cout << name << ": " << wins << " wins, " << draws << " draws, " << losses
+              << " losses, longest mate " << longest << " moves, " << elapsed << " ms" << std::endl;
+    write(name, db);
+    tables[name].swap(db);
+}
+
+bool GENERATOR::load(const std::string& name) {
+    std::ifstream file((outDir + "/" + name + ".tb").c_str(), std::ios::binary);
+    if (!file)
+        return false;
+    char magic[sizeof(TB_MAGIC)];
+    std::vector<uint8_t> db(tbTableSize(name));
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(db.data()), db.size());
+    if (!file || !std::equal(magic, magic + sizeof(magic), TB_MAGIC))
+        return false;
+    std::cout << name << ": loaded" << std::endl;
+    tables[name].swap(db);
+    return true;
+}
+
+bool GENERATOR::write(const std::string& name, const std::vector<uint8_t>& db) const {
+    std::ofstream file((outDir + "/" + name + ".tb").c_str(), std::ios::binary);
+    file.write(TB_MAGIC, sizeof(TB_MAGIC));
+    file.write(reinterpret_cast<const char*>(db.data()), db.size());
+    if (!file)
+        std::cerr << "cannot write " << outDir << "/" << name << ".tb" << std::endl;
+    return (bool)file;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string outDir = ".";
+    size_t threads = THREADPOOL::hardwareThreads();
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc)
+            outDir = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else
+            names.push_back(arg);
+    }
+    if (names.empty()) {
+        std::cerr << "usage: chess_tbgen [--out DIR] [--threads N] TABLE...  (e.g. KQK KRK KBNK KRKP)\n";
+        return 1;
+    }
+
+    GENERATOR generator(outDir, threads);
+    for (const std::string& name : names) {
+        std::vector<short> codes = parseTableName(name);
+        if (codes.empty() || !generator.ensure(canonicalName(codes))) {
+            std::cerr << "bad table name " << name << " (at most " << TB_MAX_PIECES << " pieces)\n";
+            return 1;
+        }
+    }
+    return 0;
+}
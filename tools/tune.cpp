@@ -0,0 +1,372 @@
+// tune.cpp
+// Texel tuning of the classical evaluation weights (see evalweights.h). Every labelled
+// position is first resolved to a quiet one by a capture-only quiescence search with the
+// starting weights, and the game result is predicted from its score as
+//     sigmoid(score) = 1 / (1 + 10^(-K * score / 400))
+// The weights are fitted to minimise the mean squared error of these predictions by
+// full-batch gradient descent (Adam). The evaluation is linear in the weights, so each quiet
+// position is reduced once to its term counts and an epoch is a pass of small dot products;
+// the loading and every pass are split over all cores.
+//
+// Usage: chess_tune [--weights FILE] [--out FILE] [--epochs N] [--rate R] [--k K]
+//                   [--threads N] [--freeze NAME,...] [--qdepth N] FILE...
+// Each data line is a FEN or EPD position followed by the game result: 1-0, 0-1 or
+// 1/2-1/2 (quoted or not, e.g. c9 "1-0";) or [1.0], [0.5], [0.0]. Results are from White's
+// point of view. --weights gives the starting weights (default: the engine's own), --out
+// where the tuned ones are written (default evalweights.txt); --k fixes the sigmoid scale
+// instead of fitting it to the starting weights; --freeze keeps the named terms unchanged.
+
+#include "../ai/evalweights.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include "../utils/score.h"
+#include "../utils/threadpool.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+
+// Quiet position reduced to its term counts (White minus Black) and its result.
+struct Sample {
+    int16_t features[EVAL_TERM_COUNT];
+    float result;        // 1 White won, 0.5 draw, 0 Black won.
+};
+
+struct TuneOptions {
+    std::string weightsFile;
+    std::string outFile;
+    int epochs;
+    double rate;           // Adam step size, in centipawns.
+    double k;              // Sigmoid scale; 0 fits it to the starting weights.
+    size_t threads;
+    int quiescenceDepth;
+    std::vector<bool> frozen;
+
+    TuneOptions()
+        : outFile("evalweights.txt"), epochs(1000), rate(1.0), k(0), threads(THREADPOOL::hardwareThreads()),
+          quiescenceDepth(8), frozen(EVAL_TERM_COUNT, false) {}
+};
+
+// ---------------- Data ----------------
+
+// Result token after the position fields: 1-0 / 0-1 / 1/2-1/2 in any quoting, or [x].
+static bool parseResult(std::string token, float& result) {
+    token.erase(std::remove_if(token.begin(), token.end(), [](char c) {
+        return c == '"' || c == ';' || c == '[' || c == ']';
+    }), token.end());
+    if (token == "1-0" || token == "1" || token == "1.0") result = 1.0f;
+    else if (token == "0-1" || token == "0" || token == "0.0") result = 0.0f;
+    else if (token == "1/2-1/2" || token == "0.5" || token == ".5") result = 0.5f;
+    else return false;
+    return true;
+}
+
+// Splits a data line into a FEN (the four position fields, plus the clocks if present) and
+// its result.
+static bool parseLine(const std::string& line, std::string& fen, float& result) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement >> side >> castling >> enPassant))
+        return false;
+    fen = placement + " " + side + " " + castling + " " + enPassant;
+    std::string token;
+    std::vector<std::string> rest;
+    while (fields >> token)
+        rest.push_back(token);
+    size_t first = 0;
+    // Halfmove clock and fullmove number, when the line is a full FEN.
+    if (rest.size() >= 3 && std::isdigit((unsigned char)rest[0][0]) && std::isdigit((unsigned char)rest[1][0])
+        && rest[0].find('-') == std::string::npos && rest[1].find('-') == std::string::npos) {
+        fen += " " + rest[0] + " " + rest[1];
+        first = 2;
+    }
+    for (size_t i = first; i < rest.size(); i++) {
+        if (parseResult(rest[i], result))
+            return true;
+    }
+    return false;
+}
+
+// Capture-only alpha-beta search from 'state' with stand pat; returns the score for the side
+// to move and the position at the end of the line it settles on in 'leaf'.
+static int quiesce(CHESSLOGIC& logic, const std::vector<short>& state, int alpha, int beta, int depth,
+                   const EvalWeights& weights, std::vector<short>& leaf) {
+    std::vector<std::pair<short, short>> moves = logic.generateAllValidMoves(state);
+    int features[EVAL_TERM_COUNT];
+    evalFeatures(state, moves, features);
+    int standPat = weights.score(features) * (state[TURN_INDEX] > 0 ? 1 : -1);
+    leaf = state;
+    if (standPat >= beta || depth == 0)
+        return standPat;
+    alpha = std::max(alpha, standPat);
+
+    // Most valuable victim first, then least valuable attacker.
+    std::vector<std::pair<short, short>> captures;
+    for (const auto& move : moves) {
+        if (state[move.second] != 0)
+            captures.push_back(move);
+    }
+    std::sort(captures.begin(), captures.end(), [&](const std::pair<short, short>& a, const std::pair<short, short>& b) {
+        int victimA = std::abs(state[a.second]), victimB = std::abs(state[b.second]);
+        if (victimA != victimB)
+            return victimA > victimB;
+        return std::abs(state[a.first]) < std::abs(state[b.first]);
+    });
+    std::vector<short> child, childLeaf;
+    for (const auto& capture : captures) {
+        child = state;
+        CHESSLOGIC::applyMove(child, capture);
+        int score = -quiesce(logic, child, -beta, -alpha, depth - 1, weights, childLeaf);
+        if (score > alpha) {
+            alpha = score;
+            leaf = childLeaf;
+            if (alpha >= beta)
+                break;
+        }
+    }
+    return alpha;
+}
+
+// Parses, resolves and reduces the lines [begin, end) into samples.
+static void buildSamples(const std::vector<std::string>& lines, size_t begin, size_t end, CHESSLOGIC& logic,
+                         const EvalWeights& weights, int quiescenceDepth, std::vector<Sample>& samples) {
+    std::string fen;
+    std::vector<short> state, leaf;
+    for (size_t i = begin; i < end; i++) {
+        Sample sample;
+        int fullmove;
+        if (!parseLine(lines[i], fen, sample.result) || !parseFen(fen, state, fullmove))
+            continue;
+        quiesce(logic, state, -INFINITE_SCORE, INFINITE_SCORE, quiescenceDepth, weights, leaf);
+        int features[EVAL_TERM_COUNT];
+        evalFeatures(leaf, logic.generateAllValidMoves(leaf), features);
+        for (int t = 0; t < EVAL_TERM_COUNT; t++)
+            sample.features[t] = (int16_t)features[t];
+        samples.push_back(sample);
+    }
+}
+
+// ---------------- Error and gradient ----------------
+
+// Mean squared error of the predictions over all samples and, when 'gradient' is not null,
+// its gradient with respect to the weights. The samples are split into blocks summed on the
+// pool and added up in block order, so results do not depend on scheduling.
+static double meanError(THREADPOOL& pool, const std::vector<Sample>& samples, const double weights[EVAL_TERM_COUNT],
+                        double k, double gradient[EVAL_TERM_COUNT]) {
+    const double scale = k * std::log(10.0) / 400.0;
+    size_t blocks = pool.size() * 4;
+    size_t blockSize = (samples.size() + blocks - 1) / blocks;
+    std::vector<double> errors(blocks, 0.0);
+    std::vector<double> gradients(blocks * EVAL_TERM_COUNT, 0.0);
+    bool wantGradient = gradient != nullptr;
+    for (size_t b = 0; b < blocks; b++) {
+        pool.submit([&, b](size_t) {
+            size_t begin = b * blockSize, end = std::min(samples.size(), begin + blockSize);
+            double error = 0;
+            double* blockGradient = &gradients[b * EVAL_TERM_COUNT];
+            for (size_t i = begin; i < end; i++) {
+                const Sample& sample = samples[i];
+                double score = 0;
+                for (int t = 0; t < EVAL_TERM_COUNT; t++)
+                    score += weights[t] * sample.features[t];
+                double predicted = 1.0 / (1.0 + std::exp(-scale * score));
+                double difference = sample.result - predicted;
+                error += difference * difference;
+                if (wantGradient) {
+                    double factor = -2.0 * difference * predicted * (1.0 - predicted) * scale;
+                    for (int t = 0; t < EVAL_TERM_COUNT; t++)
+                        blockGradient[t] += factor * sample.features[t];
+                }
+            }
+            errors[b] = error;
+        });
+    }
+    pool.wait();
+    double total = 0;
+    for (size_t b = 0; b < blocks; b++)
+        total += errors[b];
+    if (wantGradient) {
+        for (int t = 0; t < EVAL_TERM_COUNT; t++) {
+            gradient[t] = 0;
+            for (size_t b = 0; b < blocks; b++)
+                gradient[t] += gradients[b * EVAL_TERM_COUNT + t];
+            gradient[t] /= samples.size();
+        }
+    }
+    return total / samples.size();
+}
+
+// Sigmoid scale that best fits the starting weights (golden-section search; the error is
+// unimodal in K).
+static double fitScale(THREADPOOL& pool, const std::vector<Sample>& samples, const double weights[EVAL_TERM_COUNT]) {
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double low = 0.05, high = 5.0;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double errorA = meanError(pool, samples, weights, a, nullptr);
+    double errorB = meanError(pool, samples, weights, b, nullptr);
+    for (int i = 0; i < 40; i++) {
+        if (errorA < errorB) {
+            high = b;
+            b = a;
+            errorB = errorA;
+            a = high - ratio * (high - low);
+            errorA = meanError(pool, samples, weights, a, nullptr);
+        } else {
+            low = a;
+            a = b;
+            errorA = errorB;
+            b = low + ratio * (high - low);
+            errorB = meanError(pool, samples, weights, b, nullptr);
+        }
+    }
+    return (low + high) / 2;
+}
+
+static void printUsage() {
+    std::cerr << "usage: chess_tune [--weights FILE] [--out FILE] [--epochs N] [--rate R] [--k K]\n"
+                 "                  [--threads N] [--freeze NAME,...] [--qdepth N] FILE...\n";
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    TuneOptions options;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (arg.compare(0, 2, "--") == 0 && !hasValue) {
+            printUsage();
+            return 1;
+        }
+        if (arg == "--weights")       options.weightsFile = argv[++i];
+        else if (arg == "--out")      options.outFile = argv[++i];
+        else if (arg == "--epochs")   options.epochs = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--rate")     options.rate = std::atof(argv[++i]);
+        else if (arg == "--k")        options.k = std::atof(argv[++i]);
+        else if (arg == "--threads")  options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--qdepth")   options.quiescenceDepth = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--freeze") {
+            std::stringstream names(argv[++i]);
+            std::string name;
+            while (std::getline(names, name, ',')) {
+                int term = 0;
+                while (term < EVAL_TERM_COUNT && name != evalTermName(term))
+                    term++;
+                if (term == EVAL_TERM_COUNT) {
+                    std::cerr << "unknown term " << name << "\n";
+                    return 1;
+                }
+                options.frozen[term] = true;
+            }
+        } else if (arg.compare(0, 2, "--") == 0) {
+            printUsage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        printUsage();
+        return 1;
+    }
+    EvalWeights start;
+    if (!options.weightsFile.empty() && !loadEvalWeights(options.weightsFile, start)) {
+        std::cerr << "cannot read weights " << options.weightsFile << "\n";
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::string> lines;
+    for (const std::string& file : files) {
+        std::ifstream in(file.c_str());
+        if (!in) {
+            std::cerr << "cannot read " << file << "\n";
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line))
+            lines.push_back(line);
+    }
+
+    // Resolve the positions in blocks on every core, one move generator per worker.
+    THREADPOOL pool(options.threads);
+    std::vector<std::unique_ptr<CHESSLOGIC>> logics;
+    for (size_t i = 0; i < pool.size(); i++)
+        logics.push_back(std::unique_ptr<CHESSLOGIC>(new CHESSLOGIC()));
+    const size_t LINES_PER_BLOCK = 4096;
+    size_t blockCount = (lines.size() + LINES_PER_BLOCK - 1) / LINES_PER_BLOCK;
+    std::vector<std::vector<Sample>> blocks(blockCount);
+    for (size_t b = 0; b < blockCount; b++) {
+        pool.submit([&, b](size_t worker) {
+            buildSamples(lines, b * LINES_PER_BLOCK, std::min(lines.size(), (b + 1) * LINES_PER_BLOCK),
+                         *logics[worker], start, options.quiescenceDepth, blocks[b]);
+        });
+    }
+    pool.wait();
+    std::vector<Sample> samples;
+    for (const std::vector<Sample>& block : blocks)
+        samples.insert(samples.end(), block.begin(), block.end());
+    std::vector<std::string>().swap(lines);
+    std::vector<std::vector<Sample>>().swap(blocks);
+    if (samples.empty()) {
+        std::cerr << "no labelled positions read\n";
+        return 1;
+    }
+    std::printf("%zu positions resolved in %.1f s on %zu threads\n", samples.size(), secondsSince(startTime), pool.size());
+
+    double weights[EVAL_TERM_COUNT];
+    for (int t = 0; t < EVAL_TERM_COUNT; t++)
+        weights[t] = start.terms[t];
+    double k = options.k > 0 ? options.k : fitScale(pool, samples, weights);
+    double initialError = meanError(pool, samples, weights, k, nullptr);
+    std::printf("K = %.4f, starting error %.6f\n", k, initialError);
+
+    // Adam: per-weight step sizes adapt to the very different scales of the term counts.
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    double moment[EVAL_TERM_COUNT] = {0}, velocity[EVAL_TERM_COUNT] = {0};
+    double gradient[EVAL_TERM_COUNT];
+    auto tuneStart = std::chrono::steady_clock::now();
+    for (int epoch = 1; epoch <= options.epochs; epoch++) {
+        double error = meanError(pool, samples, weights, k, gradient);
+        for (int t = 0; t < EVAL_TERM_COUNT; t++) {
+            if (options.frozen[t])
+                continue;
+            moment[t] = beta1 * moment[t] + (1 - beta1) * gradient[t];
+            velocity[t] = beta2 * velocity[t] + (1 - beta2) * gradient[t] * gradient[t];
+            double momentHat = moment[t] / (1 - std::pow(beta1, epoch));
+            double velocityHat = velocity[t] / (1 - std::pow(beta2, epoch));
+            weights[t] -= options.rate * momentHat / (std::sqrt(velocityHat) + epsilon);
+        }
+        if (epoch % 100 == 0 || epoch == options.epochs)
+            std::printf("epoch %5d  error %.6f  %.1f s\n", epoch, error, secondsSince(tuneStart));
+    }
+
+    // The engine's weights are whole centipawns; report the error of the rounded ones.
+    EvalWeights tuned = start;
+    for (int t = 0; t < EVAL_TERM_COUNT; t++) {
+        tuned.terms[t] = (int)std::lround(weights[t]);
+        weights[t] = tuned.terms[t];
+    }
+    double finalError = meanError(pool, samples, weights, k, nullptr);
+    std::printf("final error %.6f (from %.6f)\n", finalError, initialError);
+    for (int t = 0; t < EVAL_TERM_COUNT; t++)
+        std::printf("  %-16s %5d -> %5d\n", evalTermName(t), start.terms[t], tuned.terms[t]);
+    if (!saveEvalWeights(options.outFile, tuned)) {
+        std::cerr << "cannot write " << options.outFile << "\n";
+        return 1;
+    }
+    std::printf("weights written to %s\n", options.outFile.c_str());
+    return 0;
+}
@@ -0,0 +1,256 @@
+// uci.cpp
+// Headless front-end that speaks the UCI protocol over stdin/stdout. It links only the
+// engine code (no ncurses), so GUIs and match runners can drive the engine at full speed.
+
+#include "../ai/chessAI.h"
+#include "../logic/chesslogic.h"
+#include "../logic/notation.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+
+class UCI {
+public:
+    UCI();
+    // Reads commands until "quit" or end of input.
+    int run(std::istream& in);
+
+private:
+    void handlePosition(std::istringstream& args);
+    void handleGo(std::istringstream& args);
+    void handleSetOption(std::istringstream& args);
+    void waitForSearch();
+    void send(const std::string& line);
+    void reportIteration(const SearchInfo& info);
+
+    ChessAI ai;
+    std::unique_ptr<CHESSLOGIC> game;
+    std::thread searchThread;
+    std::mutex outputMutex;
+};
+
+UCI::UCI() : game(new CHESSLOGIC()) {
+    ai.onIteration = [this](const SearchInfo& info) { reportIteration(info); };
+}
+
+void UCI::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << line << std::endl;
+}
+
+void UCI::waitForSearch() {
+    if (searchThread.joinable())
+        searchThread.join();
+}
+
+// Formats a side-to-move relative score the way UCI expects it.
+static std::string uciScore(int score) {
+    if (isMateScore(score))
+        return "mate " + std::to_string(mateDistanceInMoves(score));
+    return "cp " + std::to_string(score);
+}
+
+// Converts a move sequence from a given state into space-separated UCI moves.
+static std::string uciLine(std::vector<short> state, const std::vector<std::pair<short, short>>& moves) {
+    std::string line;
+    for (const auto &move : moves) {
+        if (!line.empty())
+            line += " ";
+        line += moveToUci(state, move);
+        CHESSLOGIC::applyMove(state, move);
+    }
+    return line;
+}
+
+void UCI::reportIteration(const SearchInfo& info) {
+    long long nps = info.timeMs > 0 ? info.nodes * 1000 / info.timeMs : info.nodes;
+    // With MultiPV every ranked line gets its own info line, tagged with its rank.
+    bool multiPV = info.lines.size() > 1;
+    size_t count = multiPV ? info.lines.size() : 1;
+    for (size_t i = 0; i < count; i++) {
+        std::ostringstream out;
+        out << "info depth " << info.depth;
+        if (SEARCH_STATS_ENABLED)
+            out << " seldepth " << info.seldepth;
+        if (multiPV)
+            out << " multipv " << (i + 1);
+        out << " score " << uciScore(multiPV ? info.lines[i].score : info.score)
+            << " nodes " << info.nodes
+            << " nps " << nps
+            << " time " << info.timeMs
+            << " hashfull " << info.hashfull
+            << " pv " << uciLine(game->getState(), multiPV ? info.lines[i].pv : info.pv);
+        send(out.str());
+    }
+}
+
+void UCI::handlePosition(std::istringstream& args) {
+    // position (startpos | fen <fen>) [moves <move>...]
+    std::string token;
+    args >> token;
+    std::unique_ptr<CHESSLOGIC> position(new CHESSLOGIC());
+    if (token == "fen") {
+        std::string fen;
+        while (args >> token && token != "moves")
+            fen += (fen.empty() ? "" : " ") + token;
+        if (!position->setFen(fen)) {
+            send("info string invalid fen " + fen);
+            return;
+        }
+    } else if (token == "startpos") {
+        args >> token;
+    } else {
+        send("info string expected 'startpos' or 'fen'");
+        return;
+    }
+    game = std::move(position);
+    if (token != "moves")
+        return;
+    while (args >> token) {
+        std::pair<short, short> move;
+        if (!parseUciMove(token, move) || !game->move(move)) {
+            send("info string illegal move " + token);
+            return;
+        }
+    }
+}
+
+void UCI::handleGo(std::istringstream& args) {
+    SearchLimits limits;
+    std::string token;
+    while (args >> token) {
+        if (token == "depth")          args >> limits.depth;
+        else if (token == "nodes")     args >> limits.nodes;
+        else if (token == "movetime")  args >> limits.movetime;
+        else if (token == "wtime")     args >> limits.wtime;
+        else if (token == "btime")     args >> limits.btime;
+        else if (token == "winc")      args >> limits.winc;
+        else if (token == "binc")      args >> limits.binc;
+        else if (token == "movestogo") args >> limits.movestogo;
+        else if (token == "infinite")  limits.infinite = true;
+        else if (token == "ponder")    limits.ponder = true;
+    }
+    waitForSearch();
+    std::vector<short> rootState = game->getState();
+    limits.history = game->getPositionKeys();
+    searchThread = std::thread([this, rootState, limits]() {
+        std::pair<short, short> best = ai.search(rootState, limits);
+        if (SEARCH_STATS_ENABLED)
+            send("info string " + ai.getSearchStats().summary());
+        std::string reply = "bestmove " + moveToUci(rootState, best);
+        // Suggest the expected reply from the principal variation for pondering.
+        std::vector<std::pair<short, short>> pv = ai.getPrincipalVariation();
+        if (pv.size() >= 2) {
+            std::vector<short> afterBest = rootState;
+            CHESSLOGIC::applyMove(afterBest, best);
+            reply += " ponder " + moveToUci(afterBest, pv[1]);
+        }
+        send(reply);
+    });
+}
+
+void UCI::handleSetOption(std::istringstream& args) {
+    // setoption name <id> value <x>
+    std::string token, name, value;
+    args >> token;
+    while (args >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+    // The value may contain spaces (file names).
+    std::getline(args >> std::ws, value);
+    waitForSearch();
+    if (name == "Hash")
+        ai.setHashSize(std::atoi(value.c_str()));
+    else if (name == "Threads")
+        ai.setThreads(std::atoi(value.c_str()));
+    else if (name == "MultiPV")
+        ai.multiPV = std::max(1, std::min(std::atoi(value.c_str()), MAX_MOVES));
+    else if (name == "Ponder")
+        ;  // Pondering is driven by "go ponder"; nothing to configure.
+    else if (name == "BookFile") {
+        if (!ai.setBook(value == "<empty>" ? "" : value))
+            send("info string cannot open book " + value);
+    } else if (name == "BookBestMove")
+        ai.bookBestOnly = (value == "true");
+    else if (name == "TablebasePath") {
+        int tables = ai.setTablebasePath(value == "<empty>" ? "" : value);
+        send("info string " + std::to_string(tables) + " tablebase files found");
+    } else if (name == "TraceFile") {
+        if (!ai.setTraceFile(value == "<empty>" ? "" : value))
+            send("info string cannot write trace " + value);
+    } else if (name == "EvalFile") {
+        if (!ai.setEvalFile(value == "<empty>" ? "" : value))
+            send("info string cannot load network " + value);
+    } else if (name == "EvalWeights") {
+        if (!ai.setEvalWeights(value == "<empty>" ? "" : value))
+            send("info string cannot read weights " + value);
+    } else if (name == "UseNNUE")
+        ai.useNetwork = (value == "true");
+    else if (name == "AnalysisCache") {
+        if (!ai.setAnalysisCache(value == "<empty>" ? "" : value, CACHE_DEFAULT_MEGABYTES))
+            send("info string cannot map analysis cache " + value);
+    } else if (name == "TracePly")
+        ai.tracePly = std::max(0, std::atoi(value.c_str()));
+    else
+        send("info string unknown option " + name);
+}
+
+int UCI::run(std::istream& in) {
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream args(line);
+        std::string command;
+        args >> command;
+        if (command == "uci") {
+            send("id name terminalChessAI");
+            send("id author donessie94");
+            send("option name Hash type spin default 16 min 1 max 4096");
+            send("option name Threads type spin default 1 min 1 max 256");
+            send("option name MultiPV type spin default 1 min 1 max " + std::to_string(MAX_MOVES));
+            send("option name Ponder type check default false");
+            send("option name BookFile type string default <empty>");
+            send("option name BookBestMove type check default false");
+            send("option name TablebasePath type string default <empty>");
+            send("option name EvalFile type string default <empty>");
+            send("option name UseNNUE type check default true");
+            send("option name EvalWeights type string default <empty>");
+            send("option name AnalysisCache type string default <empty>");
+            send("option name TraceFile type string default <empty>");
+            send("option name TracePly type spin default 2 min 0 max " + std::to_string(MAX_SEARCH_DEPTH));
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            waitForSearch();
+            ai.clearHash();
+            game.reset(new CHESSLOGIC());
+        } else if (command == "position") {
+            waitForSearch();
+            handlePosition(args);
+        } else if (command == "go") {
+            handleGo(args);
+        } else if (command == "ponderhit") {
+            ai.ponderHit();
+        } else if (command == "stop") {
+            ai.stop();
+            waitForSearch();
+        } else if (command == "setoption") {
+            handleSetOption(args);
+        } else if (command == "quit") {
+            break;
+        }
+    }
+    ai.stop();
+    waitForSearch();
+    return 0;
+}
+
+int main() {
+    std::ios::sync_with_stdio(false);
+    UCI uci;
+    return uci.run(std::cin);
+}
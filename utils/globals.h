@@ -1,9 +0,0 @@
-// globals.h
-#ifndef GLOBALS_H
-#define GLOBALS_H
-
-#include "../logic/chesslogic.h"
-
-extern CHESSLOGIC* chessLogicPtr;  // Declaration of the global pointer
-
-#endif // GLOBALS_H
\ No newline at end of file
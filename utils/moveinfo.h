@@ -10,8 +10,6 @@ struct MoveInfo {
     short lastKingWhitePos;
     short lastKingBlackPos;
     // New fields:
-    bool whiteCanCastle;
-    bool blackCanCastle;
     short movedPiece;
     short capturedPiece;
 };
@@ -0,0 +1,55 @@
+// score.h
+#ifndef SCORE_H
+#define SCORE_H
+
+#include <cstdlib>
+#include <string>
+#include <cstdio>
+
+// Search scores are 32-bit integer centipawns from the point of view of the side to move.
+// A forced mate is encoded as MATE_SCORE minus its distance in plies from the root, so a
+// shorter mate always compares better than a longer one and the score fits in 16 bits.
+const int MATE_SCORE      = 32000;
+const int INFINITE_SCORE  = 32001;
+const int MAX_PLY         = 128;
+const int MATE_IN_MAX_PLY = MATE_SCORE - MAX_PLY;
+// Base score of a position known to be won without a mate in sight (e.g. from an endgame
+// bitbase); far above any material balance and far below the mate range.
+const int KNOWN_WIN       = 10000;
+
+// Score for giving mate at the given ply.
+inline int mateIn(int ply) { return MATE_SCORE - ply; }
+// Score for being mated at the given ply.
+inline int matedIn(int ply) { return -MATE_SCORE + ply; }
+// True if the score encodes a forced mate for either side.
+inline bool isMateScore(int score) { return std::abs(score) >= MATE_IN_MAX_PLY; }
+
+// Mate scores are stored relative to the node rather than the root, so an entry stays valid
+// when the same position is reached at a different ply.
+inline int scoreToStorage(int score, int ply) {
+    if (score >= MATE_IN_MAX_PLY) return score + ply;
+    if (score <= -MATE_IN_MAX_PLY) return score - ply;
+    return score;
+}
+inline int scoreFromStorage(int score, int ply) {
+    if (score >= MATE_IN_MAX_PLY) return score - ply;
+    if (score <= -MATE_IN_MAX_PLY) return score + ply;
+    return score;
+}
+
+// Full moves until mate (positive: side to move mates, negative: side to move is mated).
+inline int mateDistanceInMoves(int score) {
+    return (score > 0) ? (MATE_SCORE - score + 1) / 2 : -(MATE_SCORE + score) / 2;
+}
+
+// Human-readable score: "+1.25" for centipawns, "#3" / "#-2" for mates.
+inline std::string formatScore(int score) {
+    char buffer[32];
+    if (isMateScore(score))
+        std::snprintf(buffer, sizeof(buffer), "#%d", mateDistanceInMoves(score));
+    else
+        std::snprintf(buffer, sizeof(buffer), "%+.2f", score / 100.0);
+    return std::string(buffer);
+}
+
+#endif // SCORE_H
@@ -0,0 +1,78 @@
+// searchstats.h
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+
+// ------------------ Search Statistics ------------------
+// Every search thread keeps its own counters, so updating them costs no synchronisation;
+// they are summed once the search has finished. The counters only exist in builds with
+// SEARCH_STATS defined (CMake option CHESS_SEARCH_STATS, on by default except in Release
+// builds): otherwise SEARCH_STAT() expands to nothing and the search carries no trace of them.
+#ifdef SEARCH_STATS
+#define SEARCH_STAT(statement) do { statement; } while (0)
+const bool SEARCH_STATS_ENABLED = true;
+#else
+#define SEARCH_STAT(statement) do { } while (0)
+const bool SEARCH_STATS_ENABLED = false;
+#endif
+
+struct SearchStats {
+    long long nodes;             // Nodes entered by search().
+    long long qnodes;            // Static evaluations at the horizon (the leaf nodes).
+    int seldepth;                // Deepest ply reached.
+    long long expanded;          // Nodes whose moves were searched.
+    long long betaCutoffs;       // Expanded nodes that failed high...
+    long long firstMoveCutoffs;  // ...on their first move.
+    long long ttProbes, ttHits, ttCutoffs;
+    long long timeMs;            // Wall-clock time of the whole search.
+    std::vector<long long> iterationMs;   // Duration of each completed iteration (main thread).
+
+    SearchStats() { clear(); }
+
+    void clear() {
+        nodes = qnodes = expanded = betaCutoffs = firstMoveCutoffs = 0;
+        ttProbes = ttHits = ttCutoffs = timeMs = 0;
+        seldepth = 0;
+        iterationMs.clear();
+    }
+
+    // Adds the counters of another thread (its iteration times are not merged).
+    void merge(const SearchStats& other) {
+        nodes += other.nodes;
+        qnodes += other.qnodes;
+        seldepth = seldepth > other.seldepth ? seldepth : other.seldepth;
+        expanded += other.expanded;
+        betaCutoffs += other.betaCutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        ttProbes += other.ttProbes;
+        ttHits += other.ttHits;
+        ttCutoffs += other.ttCutoffs;
+    }
+
+    static double percent(long long part, long long whole) {
+        return whole > 0 ? 100.0 * part / whole : 0.0;
+    }
+
+    // One-line summary for logs and the UCI "info string".
+    std::string summary() const {
+        char line[320];
+        std::snprintf(line, sizeof(line),
+                      "nodes %lld qnodes %lld nps %lld seldepth %d cutoffs %.1f%% first-move %.1f%% "
+                      "tt probes %lld hits %.1f%% cutoffs %.1f%%",
+                      nodes, qnodes, timeMs > 0 ? nodes * 1000 / timeMs : nodes, seldepth,
+                      percent(betaCutoffs, expanded), percent(firstMoveCutoffs, betaCutoffs),
+                      ttProbes, percent(ttHits, ttProbes), percent(ttCutoffs, ttProbes));
+        std::string text = line;
+        if (!iterationMs.empty()) {
+            text += " iterations(ms)";
+            for (long long ms : iterationMs)
+                text += " " + std::to_string(ms);
+        }
+        return text;
+    }
+};
+
+#endif // SEARCHSTATS_H
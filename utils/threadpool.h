@@ -0,0 +1,94 @@
+// threadpool.h
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// THREADPOOL runs queued jobs on a fixed set of worker threads. Each job receives the index
+// of the worker running it, so callers can keep per-worker resources (engines, move
+// generators) in a plain vector without any locking.
+class THREADPOOL {
+public:
+    explicit THREADPOOL(size_t workerCount)
+        : pending(0), shuttingDown(false)
+    {
+        if (workerCount == 0)
+            workerCount = 1;
+        for (size_t i = 0; i < workerCount; i++)
+            workers.push_back(std::thread([this, i]() { workerLoop(i); }));
+    }
+
+    ~THREADPOOL() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shuttingDown = true;
+        }
+        jobAvailable.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    THREADPOOL(const THREADPOOL&) = delete;
+    THREADPOOL& operator=(const THREADPOOL&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Queue a job; it runs on the next idle worker.
+    void submit(std::function<void(size_t worker)> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            pending++;
+        }
+        jobAvailable.notify_one();
+    }
+
+    // Block until every submitted job has finished.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this]() { return pending == 0; });
+    }
+
+    // Default worker count: one per hardware thread.
+    static size_t hardwareThreads() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+private:
+    void workerLoop(size_t index) {
+        while (true) {
+            std::function<void(size_t)> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobAvailable.wait(lock, [this]() { return shuttingDown || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+                if (pending == 0)
+                    allDone.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void(size_t)>> jobs;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable allDone;
+    size_t pending;
+    bool shuttingDown;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,87 @@
+// tracelog.h
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// TRACE_LOG appends text to a file from a background thread. Producers hand over whole
+// chunks (many JSON lines gathered in a thread-local buffer), so a search thread only takes
+// the lock once per chunk and never waits for the disk.
+class TRACE_LOG {
+public:
+    TRACE_LOG() : file(nullptr), closing(false) {}
+    ~TRACE_LOG() { close(); }
+    TRACE_LOG(const TRACE_LOG&) = delete;
+    TRACE_LOG& operator=(const TRACE_LOG&) = delete;
+
+    // Start a new log file (truncating it); returns false if it cannot be created.
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "w");
+        if (!file)
+            return false;
+        closing = false;
+        writer = std::thread([this]() { writerLoop(); });
+        return true;
+    }
+
+    // Write everything queued so far and close the file.
+    void close() {
+        if (!file)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        chunkQueued.notify_one();
+        writer.join();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    bool isOpen() const { return file != nullptr; }
+
+    // Queue a chunk of complete lines; 'chunk' is left empty for reuse.
+    void write(std::string& chunk) {
+        if (chunk.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::string());
+            queue.back().swap(chunk);
+        }
+        chunkQueued.notify_one();
+    }
+
+private:
+    void writerLoop() {
+        std::vector<std::string> pending;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkQueued.wait(lock, [this]() { return closing || !queue.empty(); });
+                pending.swap(queue);
+                if (pending.empty() && closing)
+                    return;
+            }
+            for (const std::string& chunk : pending)
+                std::fwrite(chunk.data(), 1, chunk.size(), file);
+            std::fflush(file);
+            pending.clear();
+        }
+    }
+
+    std::FILE* file;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable chunkQueued;
+    std::vector<std::string> queue;
+    bool closing;
+};
+
+#endif // TRACELOG_H
@@ -0,0 +1,47 @@
+// wakeup.h
+#ifndef WAKEUP_H
+#define WAKEUP_H
+
+#include <unistd.h>
+#include <fcntl.h>
+
+// WAKEUP_PIPE lets another thread interrupt a poll() on the UI thread: the UI polls
+// readFd() next to stdin, and notify() makes it readable. Both ends are non-blocking, so
+// notify() never stalls a worker and drain() never stalls the UI.
+class WAKEUP_PIPE {
+public:
+    WAKEUP_PIPE() {
+        fds[0] = fds[1] = -1;
+        if (pipe(fds) == 0) {
+            fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+        }
+    }
+    ~WAKEUP_PIPE() {
+        if (fds[0] >= 0) close(fds[0]);
+        if (fds[1] >= 0) close(fds[1]);
+    }
+    WAKEUP_PIPE(const WAKEUP_PIPE&) = delete;
+    WAKEUP_PIPE& operator=(const WAKEUP_PIPE&) = delete;
+
+    int readFd() const { return fds[0]; }
+
+    // Safe to call from any thread; a full pipe already means a wakeup is pending.
+    void notify() {
+        char byte = 1;
+        ssize_t written = write(fds[1], &byte, 1);
+        (void)written;
+    }
+
+    // Consume all pending notifications.
+    void drain() {
+        char buffer[64];
+        while (read(fds[0], buffer, sizeof(buffer)) > 0) {
+        }
+    }
+
+private:
+    int fds[2];
+};
+
+#endif // WAKEUP_H